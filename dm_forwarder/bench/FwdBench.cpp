@@ -0,0 +1,439 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <boost/filesystem.hpp>
+#include <ims/Stripe.hh>
+#include <ims/SourceMetadata.hh>
+#include <rms/InstructionList.hh>
+#include <rms/Instruction.hh>
+#include <core/IIPBase.h>
+#include <core/Exceptions.h>
+#include <core/Metrics.h>
+#include <daq/Data.h>
+#include <daq/DAQFetcher.h>
+#include <forwarder/Board.h>
+#include <forwarder/FileSender.h>
+#include <forwarder/ImageCost.h>
+#include <forwarder/Pipeline.h>
+#include <forwarder/ReadoutPattern.h>
+#include <forwarder/Scoreboard.h>
+#include <forwarder/YAMLFormatter.h>
+
+/**
+ * End-to-end pipeline throughput on synthetic focal plane loads
+ *
+ * Drives the forwarder's own fetch, format and transfer stages with the
+ * in-memory Scoreboard: DAQFetcher declutters and writes pixel fitsfiles
+ * from synthetic DAQ data, YAMLFormatter merges a synthetic header into them
+ * and FileSender copies them into a local sink directory. Only reading the
+ * DAQ is left out. Prints one JSON object per configuration with images/s,
+ * MB/s and latency percentiles of every stage.
+ *
+ * usage: fwd_bench [latiss|comcam|lsstcam|all] [images] [rows] [work dir]
+ */
+
+namespace fs = boost::filesystem;
+namespace chr = std::chrono;
+
+// DAQDecoder hands pixels over in chunks of this many samples
+const int64_t CHUNK = 195072;
+
+// serial register of a science sensor segment, readrows are configurable
+const uint32_t UNDERCOLS = 3;
+const uint32_t READCOLS = 509;
+const uint32_t OVERCOLS = 64;
+const uint32_t OVERROWS = 48;
+
+struct bench_config {
+    std::string name;
+    std::vector<std::string> locations;
+    int ccds;
+    int images_in_flight;
+};
+
+const std::vector<bench_config> CONFIGS {
+    // LATISS has a single ccd behind the ats board
+    { "latiss", { "00/0" }, 1, 1 },
+    { "comcam", { "22/0", "22/1", "22/2" }, 3, 1 },
+    // every LSSTCam forwarder node takes one science raft and the next
+    // image is read out while the previous one is still being written
+    { "lsstcam", { "13/0", "13/1", "13/2" }, 3, 3 },
+};
+
+class FwdBench : public IIPBase {
+    public:
+        FwdBench(const fs::path& work_dir, const int rows);
+
+        /**
+         * Push images through the pipeline with config's load
+         *
+         * @return one line of JSON
+         */
+        std::string run(const bench_config& config, const int images);
+
+    private:
+        fs::path _work_dir;
+        uint32_t _rows;
+        ReadoutPattern _pattern;
+
+        std::vector<Data> synthetic(const int ccds, const uint64_t samples);
+        std::string write_header(const bench_config& config);
+};
+
+FwdBench::FwdBench(const fs::path& work_dir, const int rows) :
+        IIPBase("ForwarderCfg.yaml", "fwd_bench"),
+        _work_dir(work_dir),
+        _rows(rows),
+        _pattern(_config_root["PATTERN"]) {
+}
+
+std::vector<Data> FwdBench::synthetic(const int ccds,
+                                      const uint64_t samples) {
+    IMS::SourceMetadata meta;
+    RMS::InstructionList list = meta.instructions();
+    const uint32_t registers[] = {
+        UNDERCOLS, 0, READCOLS, 0, 0, OVERCOLS, 0, _rows, 0, OVERROWS
+    };
+    for (int i = 0; i < 10; i++) {
+        list.insert(RMS::Instruction::Opcode::PUT, i, registers[i]);
+    }
+    meta = list;
+
+    std::vector<Data> data;
+    for (uint64_t offset = 0; offset < samples; offset += CHUNK) {
+        int64_t n = std::min<uint64_t>(CHUNK, samples - offset);
+        std::vector<std::vector<IMS::Stripe>> stripes(ccds,
+                std::vector<IMS::Stripe>(n));
+        std::vector<IMS::Stripe*> ptrs;
+        for (int i = 0; i < ccds; i++) {
+            for (int64_t j = 0; j < n; j++) {
+                for (int k = 0; k < 16; k++) {
+                    stripes[i][j].segment[k] = ((offset + j) * 31 + k * 7 +
+                        i) & 0x3FFFF;
+                }
+            }
+            ptrs.push_back(stripes[i].data());
+        }
+        data.push_back(Data(ccds, n, ptrs.data(), meta));
+    }
+    return data;
+}
+
+std::string FwdBench::write_header(const bench_config& config) {
+    const fs::path path = _work_dir / (config.name + "_header.yaml");
+    std::ofstream out(path.string(), std::ios::trunc);
+    if (!out) {
+        std::ostringstream err;
+        err << "Cannot open header file " << path.string();
+        throw L1::CannotOpenFile(err.str());
+    }
+
+    out << "PRIMARY:\n"
+        << "  - {keyword: TELESCOP, value: LSST, comment: bench}\n"
+        << "  - {keyword: EXPTIME, value: 15.0, comment: bench}\n";
+    for (auto&& location : config.locations) {
+        DAQ::Sensor::Type sensor = ReadoutPattern::sensor(location);
+        L1::Board board = L1::Board::decode_location(location);
+        for (int i = 0; i < config.ccds; i++) {
+            const std::string name = "R" + board.raft + "S" + board.ccd +
+                std::to_string(i);
+            out << name << "_PRIMARY:\n"
+                << "  - {keyword: CCDSLOT, value: " << name
+                << ", comment: bench}\n";
+            for (auto&& segment : _pattern.data_segment_name(sensor)) {
+                out << name << "_Segment" << segment << ":\n"
+                    << "  - {keyword: EXTNAME, value: Segment" << segment
+                    << ", comment: bench}\n"
+                    << "  - {keyword: DATASEC, value: '[4:512,1:"
+                    << _rows << "]', comment: bench}\n";
+            }
+        }
+    }
+    return path.string();
+}
+
+std::string FwdBench::run(const bench_config& config, const int images) {
+    Metrics& metrics = Metrics::instance();
+    metrics.clear();
+
+    const fs::path fits_dir = _work_dir / config.name / "fits";
+    const fs::path sink_dir = _work_dir / config.name / "sink";
+    fs::create_directories(fits_dir);
+    fs::create_directories(sink_dir);
+
+    const uint64_t samples = (UNDERCOLS + READCOLS + OVERCOLS) *
+        (_rows + OVERROWS);
+    std::vector<Data> data = synthetic(config.ccds, samples);
+    const std::string header = write_header(config);
+
+    std::vector<std::unique_ptr<DAQFetcher>> fetchers;
+    std::map<std::string, std::vector<std::string>> segment_names;
+    for (auto&& location : config.locations) {
+        DAQ::Sensor::Type sensor = ReadoutPattern::sensor(location);
+        fetchers.push_back(std::unique_ptr<DAQFetcher>(new DAQFetcher(
+                    _pattern.data_segment(sensor),
+                    _pattern.get_xor(sensor))));
+        segment_names[DAQ::Sensor::encode(sensor)] =
+            _pattern.data_segment_name(sensor);
+    }
+
+    xfer_info xfer;
+    xfer.target = "localhost:" + sink_dir.string();
+    xfer.session_id = "bench";
+    xfer.job_num = config.name;
+    xfer.locations = config.locations;
+
+    Scoreboard db(60 * 60);
+    FileSender sender("cp -f");
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    int done = 0;
+    uint64_t sent_bytes = 0;
+    uint64_t cpu_us = 0;
+
+    auto fetch = [&](const std::string& image_id) {
+        StageTimer timer(metrics.latency("fetch"));
+        std::vector<std::future<std::vector<std::string>>> tasks;
+        for (size_t i = 0; i < config.locations.size(); i++) {
+            tasks.push_back(std::async(std::launch::async,
+                        &DAQFetcher::process, fetchers[i].get(), fits_dir,
+                        image_id, config.locations[i], std::ref(data),
+                        samples));
+        }
+        for (auto&& task : tasks) {
+            try {
+                for (auto&& ccd : task.get()) {
+                    db.add_ccd(image_id, ccd);
+                }
+            }
+            catch (L1::CannotFetchPixel& e) {
+                metrics.counter("errors", "fetch").add();
+            }
+        }
+    };
+
+    auto format = [&](const std::string& image_id) {
+        StageTimer timer(metrics.latency("format"));
+        const std::string hdr = db.header(image_id);
+        std::vector<std::future<void>> tasks;
+        for (auto&& ccd : db.ccds(image_id)) {
+            L1::Board board = L1::Board::decode_filename(ccd);
+            const std::string sensor = DAQ::Sensor::encode(
+                    ReadoutPattern::sensor(board.bay_board));
+            Histogram& latency = metrics.latency("write_header", sensor,
+                    board.bay_board);
+            const std::vector<std::string>& names = segment_names[sensor];
+            tasks.push_back(std::async(std::launch::async,
+                        [&names, ccd, hdr, board, &latency]() {
+                            StageTimer timer(latency);
+                            CpuTimer cpu(board.obsid);
+                            YAMLFormatter fmt(names);
+                            fmt.write_header(fs::path(ccd), fs::path(hdr));
+                        }));
+        }
+        for (auto&& task : tasks) {
+            try {
+                task.get();
+            }
+            catch (L1::CannotFormatFitsfile& e) {
+                metrics.counter("errors", "write_header").add();
+            }
+        }
+    };
+
+    auto transfer = [&](const std::string& image_id) -> uint64_t {
+        StageTimer timer(metrics.latency("transfer"));
+        std::vector<std::string> ccds = db.ccds(image_id);
+        const std::string target = db.get_xfer(image_id).target;
+        const fs::path to(target.substr(target.find(":") + 1));
+        uint64_t bytes = 0;
+        try {
+            StageTimer send_timer(metrics.latency("send"));
+            sender.send(ccds, to);
+        }
+        catch (L1::CannotCopyFile& e) {
+            metrics.counter("errors", "send").add();
+        }
+
+        for (auto&& ccd : ccds) {
+            const fs::path copy = to / fs::path(ccd).filename();
+            boost::system::error_code ec;
+            uintmax_t size = fs::file_size(copy, ec);
+            if (!ec) {
+                bytes += size;
+            }
+            fs::remove(copy, ec);
+            fs::remove(ccd, ec);
+        }
+        db.remove(image_id);
+        timer.stop();
+        return bytes;
+    };
+
+    // every image has to reach the end of the pipeline or run never returns
+    auto guarded = [&](const char* stage, std::function<void ()> job) {
+        try {
+            job();
+        }
+        catch (std::exception& e) {
+            metrics.counter("errors", stage).add();
+        }
+    };
+
+    auto complete = [&](const std::string& image_id, const uint64_t bytes,
+                        const chr::steady_clock::time_point start) {
+        metrics.latency("image").record(chr::duration_cast<
+                chr::microseconds>(chr::steady_clock::now() - start).count());
+
+        const image_cost cost = ImageCost::instance().get(image_id);
+        ImageCost::instance().remove(image_id);
+
+        std::lock_guard<std::mutex> lk(mutex);
+        sent_bytes += bytes;
+        cpu_us += cost.cpu_us;
+        done++;
+        finished.notify_one();
+    };
+
+    const auto start = chr::steady_clock::now();
+    {
+        Pipeline pipeline(config.images_in_flight);
+        for (int i = 0; i < images; i++) {
+            std::ostringstream id;
+            id << "BM_O_20201018_" << std::setw(6) << std::setfill('0') << i;
+            const std::string image_id = id.str();
+
+            db.add_xfer(image_id, xfer);
+            db.add_header(image_id, header);
+            pipeline.fetch([&, image_id]() {
+                const auto image_start = chr::steady_clock::now();
+                guarded("fetch", [&]() { fetch(image_id); });
+                pipeline.format([&, image_id, image_start]() {
+                    guarded("format", [&]() { format(image_id); });
+                    pipeline.transfer([&, image_id, image_start]() {
+                        uint64_t bytes = 0;
+                        guarded("transfer", [&]() {
+                            bytes = transfer(image_id);
+                        });
+                        complete(image_id, bytes, image_start);
+                    });
+                });
+            });
+        }
+
+        std::unique_lock<std::mutex> lk(mutex);
+        finished.wait(lk, [&]() { return done == images; });
+    }
+    const double seconds = chr::duration<double>(
+            chr::steady_clock::now() - start).count();
+
+    boost::system::error_code ec;
+    fs::remove_all(_work_dir / config.name, ec);
+    fs::remove(header, ec);
+
+    uint64_t errors = 0;
+    for (auto&& stage : { "fetch", "format", "write_header", "transfer",
+            "send" }) {
+        errors += metrics.counter("errors", stage).value();
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << "{\"config\":\"" << config.name << "\""
+        << ",\"images\":" << images
+        << ",\"ccds\":" << config.locations.size() * config.ccds
+        << ",\"rows\":" << _rows + OVERROWS
+        << ",\"images_in_flight\":" << config.images_in_flight
+        << ",\"errors\":" << errors
+        << ",\"seconds\":" << seconds
+        << ",\"images_per_s\":" << images / seconds
+        << ",\"mb_per_s\":" << sent_bytes / seconds / 1e6
+        << ",\"cpu_us_per_image\":" << cpu_us / std::max(images, 1)
+        << ",\"stages\":[";
+    bool first = true;
+    for (auto&& series : metrics.latencies()) {
+        const Histogram* hist = series.second;
+        out << (first ? "" : ",")
+            << "{\"stage\":\"" << series.first.stage << "\""
+            << ",\"sensor\":\"" << series.first.sensor << "\""
+            << ",\"location\":\"" << series.first.location << "\""
+            << ",\"count\":" << hist->count()
+            << ",\"p50_us\":" << hist->percentile(0.5)
+            << ",\"p90_us\":" << hist->percentile(0.9)
+            << ",\"p99_us\":" << hist->percentile(0.99)
+            << ",\"max_us\":" << hist->max()
+            << "}";
+        first = false;
+    }
+    out << "]}";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    const std::string which = argc > 1 ? argv[1] : "all";
+    const int images = argc > 2 ? std::atoi(argv[2]) : 10;
+    const int rows = argc > 3 ? std::atoi(argv[3]) : 2000;
+    const fs::path work_dir = argc > 4 ? argv[4] : "/tmp/fwd_bench";
+
+    fs::create_directories(work_dir);
+    FwdBench bench(work_dir, rows);
+
+    bool ran = false;
+    for (auto&& config : CONFIGS) {
+        if (which != "all" && which != config.name) {
+            continue;
+        }
+        ran = true;
+        try {
+            std::cout << bench.run(config, images) << std::endl;
+        }
+        catch (std::exception& e) {
+            std::cout << "{\"config\":\"" << config.name << "\",\"error\":\""
+                      << e.what() << "\"}" << std::endl;
+        }
+    }
+
+    if (!ran) {
+        std::cerr << "usage: fwd_bench [latiss|comcam|lsstcam|all] [images] "
+                  << "[rows] [work dir]" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,482 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <yaml-cpp/yaml.h>
+#include <core/IIPBase.h>
+#include <core/LocalBroker.h>
+#include <core/Metrics.h>
+#include <forwarder/Board.h>
+#include <forwarder/ReadoutPattern.h>
+#include <forwarder/miniforwarder.h>
+
+/**
+ * Replay message timelines against miniforwarder::on_message
+ *
+ * The forwarder publishes through a LocalBroker instead of RabbitMQ, and the
+ * tool plays ASSOCIATED, XFER_PARAMS, HEADER_READY and END_READOUT either
+ * from a recorded timeline or synthesized at a cadence, with jitter,
+ * reordered and duplicated messages. It measures the latency from sending a
+ * message to its ack and from END_READOUT to the final
+ * IMAGE_RETRIEVAL_FOR_ARCHIVING of the image, which is the one carrying
+ * CPU_US. The forwarder still needs its DAQ partition and redis, and images
+ * only complete if they exist in the DAQ.
+ *
+ * A recorded timeline is a YAML list of {TIME: seconds, MESSAGE: {...}}.
+ * ACK_ID is filled in when missing and REPLY_QUEUE is replaced.
+ *
+ * usage: fwd_replay --help
+ */
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+namespace chr = std::chrono;
+
+const std::string CONSUME_QUEUE = "fwd_replay_consume";
+const std::string REPLY_QUEUE = "fwd_replay_reply";
+
+struct replay_options {
+    std::string timeline;
+    std::string prefix;
+    std::string image_prefix;
+    int first;
+    int images;
+    int cadence_ms;
+    int readout_ms;
+    int header_ms;
+    int jitter_ms;
+    double reorder;
+    double duplicate;
+    int timeout_s;
+    unsigned seed;
+};
+
+struct replay_event {
+    double time;
+    YAML::Node message;
+};
+
+class FwdReplay : public IIPBase {
+    public:
+        FwdReplay(const replay_options& opts);
+
+        /**
+         * Play the timeline and wait for images to complete
+         *
+         * @return one line of JSON
+         */
+        std::string run();
+
+    private:
+        replay_options _opts;
+        std::mt19937 _random;
+        std::vector<replay_event> _events;
+        std::set<std::string> _images;
+        int _duplicates;
+        int _reordered;
+        fs::path _header;
+
+        std::shared_ptr<LocalBroker> _broker;
+        std::unique_ptr<miniforwarder> _fwd;
+
+        std::mutex _mutex;
+        std::map<std::string, chr::steady_clock::time_point> _pending_acks;
+        std::map<std::string, chr::steady_clock::time_point> _end_readout;
+        std::map<std::string, std::unique_ptr<Histogram>> _ack_latency;
+        Histogram _completion;
+        std::set<std::string> _completed;
+        int _failures;
+
+        void load(const std::string& path);
+        void synthesize();
+        std::string write_header();
+        void send(const YAML::Node& message);
+        void on_reply(const std::string& body);
+        void on_archive(const std::string& body);
+};
+
+FwdReplay::FwdReplay(const replay_options& opts) :
+        IIPBase("ForwarderCfg.yaml", "fwd_replay"),
+        _opts(opts),
+        _random(opts.seed),
+        _duplicates(0),
+        _reordered(0),
+        _broker(std::make_shared<LocalBroker>()),
+        _failures(0) {
+    if (_opts.timeline.empty()) {
+        synthesize();
+    }
+    else {
+        load(_opts.timeline);
+    }
+
+    std::stable_sort(_events.begin(), _events.end(),
+            [](const replay_event& a, const replay_event& b) {
+        return a.time < b.time;
+    });
+    _fwd = std::unique_ptr<miniforwarder>(new miniforwarder(
+                "ForwarderCfg.yaml", "fwd_replay", _broker));
+}
+
+void FwdReplay::load(const std::string& path) {
+    YAML::Node timeline = YAML::LoadFile(path);
+    int ack = 0;
+    for (auto&& entry : timeline) {
+        YAML::Node message = YAML::Clone(entry["MESSAGE"]);
+        if (!message["ACK_ID"]) {
+            message["ACK_ID"] = "replay_" + std::to_string(ack++);
+        }
+        // acks have to come back to the tool to be timed
+        message["REPLY_QUEUE"] = REPLY_QUEUE;
+        const std::string type = message["MSG_TYPE"].as<std::string>();
+        if (type.find("END_READOUT") != std::string::npos) {
+            _images.insert(message["IMAGE_ID"].as<std::string>());
+        }
+        _events.push_back(replay_event{ entry["TIME"].as<double>(),
+                message });
+    }
+}
+
+std::string FwdReplay::write_header() {
+    const fs::path work_dir = _config_root["WORK_DIR"].as<std::string>();
+    _header = work_dir / "fwd_replay_header.yaml";
+    std::ofstream out(_header.string(), std::ios::trunc);
+
+    ReadoutPattern pattern(_config_root["PATTERN"]);
+    const std::string partition = _config_root["PARTITION"].as<std::string>();
+    out << "PRIMARY:\n"
+        << "  - {keyword: TELESCOP, value: LSST, comment: replay}\n";
+    for (auto&& location : _config_root[partition]
+            .as<std::vector<std::string>>()) {
+        DAQ::Sensor::Type sensor = ReadoutPattern::sensor(location);
+        L1::Board board = L1::Board::decode_location(location);
+
+        // the sensor type is the number of ccds of the board
+        for (int i = 0; i < sensor; i++) {
+            const std::string name = "R" + board.raft + "S" + board.ccd +
+                std::to_string(i);
+            out << name << "_PRIMARY:\n"
+                << "  - {keyword: CCDSLOT, value: " << name
+                << ", comment: replay}\n";
+            for (auto&& segment : pattern.data_segment_name(sensor)) {
+                out << name << "_Segment" << segment << ":\n"
+                    << "  - {keyword: EXTNAME, value: Segment" << segment
+                    << ", comment: replay}\n";
+            }
+        }
+    }
+    return "file://" + fs::absolute(_header).string();
+}
+
+void FwdReplay::synthesize() {
+    const std::string partition = _config_root["PARTITION"].as<std::string>();
+    const std::vector<std::string> locations = _config_root[partition]
+        .as<std::vector<std::string>>();
+    const std::string header_url = write_header();
+    const std::string prefix = _opts.prefix + "_FWDR_";
+    std::uniform_real_distribution<double> jitter(0, _opts.jitter_ms / 1e3);
+    std::uniform_real_distribution<double> chance(0, 1);
+    int ack = 0;
+
+    YAML::Node associated;
+    associated["MSG_TYPE"] = "ASSOCIATED";
+    associated["ASSOCIATION_KEY"] = "fwd_replay";
+    associated["ACK_ID"] = "replay_" + std::to_string(ack++);
+    associated["REPLY_QUEUE"] = REPLY_QUEUE;
+    _events.push_back(replay_event{ 0, associated });
+
+    for (int i = 0; i < _opts.images; i++) {
+        std::ostringstream id;
+        id << _opts.image_prefix << std::setw(6) << std::setfill('0')
+           << _opts.first + i;
+        const std::string image_id = id.str();
+        _images.insert(image_id);
+
+        YAML::Node xfer;
+        xfer["MSG_TYPE"] = prefix + "XFER_PARAMS";
+        xfer["TARGET_LOCATION"] = "localhost:/tmp/fwd_replay";
+        xfer["SESSION_ID"] = "replay";
+        xfer["JOB_NUM"] = std::to_string(i);
+        xfer["XFER_PARAMS"]["RAFT_CCD_LIST"] = locations;
+
+        YAML::Node end;
+        end["MSG_TYPE"] = prefix + "END_READOUT";
+
+        YAML::Node header;
+        header["MSG_TYPE"] = prefix + "HEADER_READY";
+        header["FILENAME"] = header_url;
+
+        const double start = i * _opts.cadence_ms / 1e3;
+        std::vector<replay_event> image {
+            { start, xfer },
+            { start + _opts.readout_ms / 1e3, end },
+            { start + (_opts.readout_ms + _opts.header_ms) / 1e3, header },
+        };
+        for (auto&& e : image) {
+            e.message["IMAGE_ID"] = image_id;
+            e.message["ACK_ID"] = "replay_" + std::to_string(ack++);
+            e.message["REPLY_QUEUE"] = REPLY_QUEUE;
+            e.time += jitter(_random);
+        }
+
+        if (chance(_random) < _opts.reorder) {
+            std::uniform_int_distribution<size_t> pick(0, image.size() - 1);
+            size_t a = pick(_random);
+            size_t b = (a + 1 + pick(_random) % (image.size() - 1)) %
+                image.size();
+            std::swap(image[a].time, image[b].time);
+            _reordered++;
+        }
+
+        for (auto&& e : image) {
+            _events.push_back(e);
+            if (chance(_random) < _opts.duplicate) {
+                // redelivered with the same ACK_ID, as after a reconnect
+                _events.push_back(replay_event{ e.time + jitter(_random) +
+                        0.001, e.message });
+                _duplicates++;
+            }
+        }
+    }
+}
+
+void FwdReplay::send(const YAML::Node& message) {
+    const auto now = chr::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        const std::string ack_id = message["ACK_ID"].as<std::string>();
+        if (!_pending_acks.count(ack_id)) {
+            _pending_acks[ack_id] = now;
+        }
+
+        const std::string type = message["MSG_TYPE"].as<std::string>();
+        if (type.find("END_READOUT") != std::string::npos) {
+            const std::string image_id = message["IMAGE_ID"]
+                .as<std::string>();
+            if (!_end_readout.count(image_id)) {
+                _end_readout[image_id] = now;
+            }
+        }
+    }
+
+    YAML::Emitter msg;
+    msg << YAML::DoubleQuoted << YAML::Flow << message;
+    _broker->publish_message(CONSUME_QUEUE, msg.c_str());
+}
+
+void FwdReplay::on_reply(const std::string& body) {
+    const auto now = chr::steady_clock::now();
+    YAML::Node n = YAML::Load(body);
+    const std::string ack_id = n["ACK_ID"] ? n["ACK_ID"].as<std::string>()
+        : "";
+    const std::string type = n["MSG_TYPE"].as<std::string>();
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _pending_acks.find(ack_id);
+    if (it == _pending_acks.end()) {
+        return;
+    }
+    std::unique_ptr<Histogram>& hist = _ack_latency[type];
+    if (!hist) {
+        hist = std::unique_ptr<Histogram>(new Histogram());
+    }
+    hist->record(chr::duration_cast<chr::microseconds>(
+                now - it->second).count());
+    _pending_acks.erase(it);
+}
+
+void FwdReplay::on_archive(const std::string& body) {
+    const auto now = chr::steady_clock::now();
+    YAML::Node n = YAML::Load(body);
+    if (n["MSG_TYPE"].as<std::string>() != "IMAGE_RETRIEVAL_FOR_ARCHIVING") {
+        return;
+    }
+    const std::string image_id = n["OBSID"].as<std::string>();
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (n["STATUS_CODE"].as<int>() != 0) {
+        _failures++;
+    }
+    if (!n["CPU_US"] || _completed.count(image_id)) {
+        return;
+    }
+    _completed.insert(image_id);
+    auto it = _end_readout.find(image_id);
+    if (it != _end_readout.end()) {
+        _completion.record(chr::duration_cast<chr::microseconds>(
+                    now - it->second).count());
+    }
+}
+
+std::string FwdReplay::run() {
+    const std::string archive_q = _config_root["ARCHIVE_QUEUE"]
+        .as<std::string>();
+    std::vector<std::thread> consumers;
+    consumers.push_back(std::thread([this]() {
+        _broker->run(CONSUME_QUEUE, [this](const std::string& body) {
+            _fwd->on_message(body);
+        });
+    }));
+    consumers.push_back(std::thread([this]() {
+        _broker->run(REPLY_QUEUE, [this](const std::string& body) {
+            on_reply(body);
+        });
+    }));
+    consumers.push_back(std::thread([this, archive_q]() {
+        _broker->run(archive_q, [this](const std::string& body) {
+            on_archive(body);
+        });
+    }));
+
+    const auto start = chr::steady_clock::now();
+    for (auto&& e : _events) {
+        std::this_thread::sleep_until(start + chr::duration_cast<
+                chr::steady_clock::duration>(chr::duration<double>(e.time)));
+        send(e.message);
+    }
+
+    // sustained load ends with the last message, then wait for stragglers
+    const double sending = chr::duration<double>(
+            chr::steady_clock::now() - start).count();
+    const auto deadline = chr::steady_clock::now() +
+        chr::seconds(_opts.timeout_s);
+    while (chr::steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (_completed.size() >= _images.size() &&
+                    _pending_acks.empty()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(chr::milliseconds(100));
+    }
+    const double seconds = chr::duration<double>(
+            chr::steady_clock::now() - start).count();
+
+    _broker->stop();
+    for (auto&& t : consumers) {
+        t.join();
+    }
+    _fwd.reset();
+    boost::system::error_code ec;
+    fs::remove(_header, ec);
+
+    auto write = [](std::ostream& out, const Histogram& hist) {
+        out << "\"count\":" << hist.count()
+            << ",\"p50_us\":" << hist.percentile(0.5)
+            << ",\"p90_us\":" << hist.percentile(0.9)
+            << ",\"p99_us\":" << hist.percentile(0.99)
+            << ",\"max_us\":" << hist.max();
+    };
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << "{\"messages\":" << _events.size()
+        << ",\"images\":" << _images.size()
+        << ",\"duplicates\":" << _duplicates
+        << ",\"reordered\":" << _reordered
+        << ",\"send_seconds\":" << sending
+        << ",\"seconds\":" << seconds
+        << ",\"missing_acks\":" << _pending_acks.size()
+        << ",\"completed\":" << _completed.size()
+        << ",\"failures\":" << _failures
+        << ",\"completion\":{";
+    write(out, _completion);
+    out << "},\"acks\":[";
+    bool first = true;
+    for (auto&& series : _ack_latency) {
+        out << (first ? "" : ",") << "{\"type\":\"" << series.first << "\",";
+        write(out, *series.second);
+        out << "}";
+        first = false;
+    }
+    out << "]}";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    replay_options opts;
+    po::options_description desc("fwd_replay options");
+    desc.add_options()
+        ("help", "print options")
+        ("timeline", po::value<std::string>(&opts.timeline),
+            "recorded timeline, synthetic if not given")
+        ("prefix", po::value<std::string>(&opts.prefix)->default_value("AT"),
+            "message type prefix, AT, CC or CATCHUP")
+        ("image-prefix", po::value<std::string>(&opts.image_prefix)
+            ->default_value("AT_O_20201018_"), "synthetic image id prefix")
+        ("first", po::value<int>(&opts.first)->default_value(1),
+            "sequence number of the first synthetic image")
+        ("images", po::value<int>(&opts.images)->default_value(100),
+            "synthetic images")
+        ("cadence-ms", po::value<int>(&opts.cadence_ms)->default_value(2000),
+            "milliseconds between synthetic images")
+        ("readout-ms", po::value<int>(&opts.readout_ms)->default_value(500),
+            "XFER_PARAMS to END_READOUT")
+        ("header-ms", po::value<int>(&opts.header_ms)->default_value(100),
+            "END_READOUT to HEADER_READY")
+        ("jitter-ms", po::value<int>(&opts.jitter_ms)->default_value(0),
+            "uniform random delay added to every message")
+        ("reorder", po::value<double>(&opts.reorder)->default_value(0),
+            "probability that two messages of an image swap")
+        ("duplicate", po::value<double>(&opts.duplicate)->default_value(0),
+            "probability that a message is delivered twice")
+        ("timeout", po::value<int>(&opts.timeout_s)->default_value(60),
+            "seconds to wait for images after the last message")
+        ("seed", po::value<unsigned>(&opts.seed)->default_value(1),
+            "random seed");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e) {
+        std::cerr << e.what() << std::endl << desc << std::endl;
+        return 1;
+    }
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    FwdReplay replay(opts);
+    std::cout << replay.run() << std::endl;
+    return 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <fitsio.h>
+#include <yaml-cpp/yaml.h>
+#include <boost/filesystem.hpp>
+#include <core/WorkerPool.h>
+#include <daq/Declutter.h>
+#include <daq/Pixel3d.h>
+#include <daq/PixelPool.h>
+#include <forwarder/Board.h>
+#include <forwarder/Formatter.h>
+#include <forwarder/YAMLFormatter.h>
+
+/**
+ * Time and allocations of the innermost pixel kernels
+ *
+ * Covers declutter for every sensor type with its specialized kernel and the
+ * generic loop, a science board split across pools of threads, Pixel3d
+ * allocation, writing one ccd's pixel fitsfile to tmpfs
+ * and to disk, writing header keywords and decoding fitsfile names. Stripes are synthetic and the kernels are built
+ * from source without the DAQ SDK, so it runs on any machine with cfitsio
+ * and yaml-cpp. Allocations are counted by replacing global operator new.
+ *
+ * usage: kernel_bench [iterations] [rows] [disk dir] [tmpfs dir]
+ */
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t n) {
+    allocations++;
+    void* p = std::malloc(n ? n : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+namespace fs = boost::filesystem;
+namespace chr = std::chrono;
+
+// DAQDecoder hands pixels over in chunks of this many samples
+const int64_t CHUNK = 195072;
+
+// columns of a science segment including prescan and overscan
+const int COLUMNS = 576;
+const int OVERROWS = 48;
+
+struct sensor_type {
+    const char* name;
+    int ccds;
+};
+
+// ccds per board, equal to the values of DAQ::Sensor::Type
+const sensor_type SENSORS[] = {
+    { "WAVEFRONT", 1 },
+    { "GUIDE", 2 },
+    { "SCIENCE", 3 },
+};
+
+struct result {
+    double allocs;
+    double ns;
+};
+
+result measure(const int iterations, std::function<void ()> f) {
+    // warm up caches and page in buffers
+    f();
+
+    uint64_t before = allocations.load();
+    auto start = chr::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+    auto end = chr::steady_clock::now();
+
+    result r;
+    r.allocs = double(allocations.load() - before) / iterations;
+    r.ns = chr::duration<double, std::nano>(end - start).count() / iterations;
+    return r;
+}
+
+void report(const std::string& name, const result& r) {
+    std::cout << name
+              << " allocs_per_op=" << r.allocs
+              << " ns_per_op=" << r.ns
+              << std::endl;
+}
+
+// pixels of 4 bytes handled per op
+void report(const std::string& name, const result& r, const uint64_t pixels) {
+    std::cout << name
+              << " allocs_per_op=" << r.allocs
+              << " ns_per_op=" << r.ns
+              << " ns_per_pixel=" << r.ns / pixels
+              << " gb_per_s=" << pixels * sizeof(int32_t) / r.ns
+              << std::endl;
+}
+
+/**
+ * Synthetic stripes of ccds split into DAQ sized chunks
+ */
+struct stripes {
+    std::vector<std::vector<std::vector<int32_t>>> chunks;
+
+    stripes(const int ccds, const uint64_t samples) {
+        for (uint64_t offset = 0; offset < samples; offset += CHUNK) {
+            uint64_t n = std::min<uint64_t>(CHUNK, samples - offset);
+            std::vector<std::vector<int32_t>> chunk(ccds,
+                    std::vector<int32_t>(n * DECLUTTER_SEGMENTS));
+            for (auto&& ccd : chunk) {
+                for (size_t j = 0; j < ccd.size(); j++) {
+                    ccd[j] = ((offset * DECLUTTER_SEGMENTS + j) * 31) &
+                        0x3FFFF;
+                }
+            }
+            chunks.push_back(chunk);
+        }
+    }
+};
+
+void declutter(const int iterations, const uint64_t samples) {
+    for (auto&& sensor : SENSORS) {
+        stripes data(sensor.ccds, samples);
+        Pixel3d pixels(sensor.ccds, DECLUTTER_SEGMENTS, samples);
+        std::vector<const int32_t*> ptrs(sensor.ccds);
+        declutter_kernel kernel = declutter_for(sensor.ccds);
+
+        // sensor kernel against the loop with ccds bound at runtime
+        for (int generic = 0; generic < 2; generic++) {
+            result r = measure(iterations, [&]() {
+                uint64_t offset = 0;
+                for (auto&& chunk : data.chunks) {
+                    for (int i = 0; i < sensor.ccds; i++) {
+                        ptrs[i] = chunk[i].data();
+                    }
+                    int64_t n = chunk[0].size() / DECLUTTER_SEGMENTS;
+                    if (generic) {
+                        declutter_stripes(pixels.get(), ptrs.data(),
+                                sensor.ccds, n, offset, 0x1FFFF);
+                    }
+                    else {
+                        kernel(pixels.get(), ptrs.data(), n, offset, 0x1FFFF);
+                    }
+                    offset += n;
+                }
+            });
+            report(std::string("declutter_") + sensor.name +
+                    (generic ? "_generic" : ""), r,
+                    sensor.ccds * DECLUTTER_SEGMENTS * samples);
+        }
+    }
+}
+
+void declutter_parallel(const int iterations, const uint64_t samples) {
+    const int ccds = 3;
+    stripes data(ccds, samples);
+    Pixel3d pixels(ccds, DECLUTTER_SEGMENTS, samples);
+
+    std::vector<stripe_chunk> chunks;
+    for (auto&& chunk : data.chunks) {
+        stripe_chunk c;
+        for (auto&& ccd : chunk) {
+            c.stripes.push_back(ccd.data());
+        }
+        c.samples = chunk[0].size() / DECLUTTER_SEGMENTS;
+        chunks.push_back(c);
+    }
+
+    // threads including the caller, up to the cores of the machine
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= cores; threads *= 2) {
+        WorkerPool pool("declutter", threads - 1);
+        result r = measure(iterations, [&]() {
+            declutter_chunks(pixels.get(), chunks, ccds, 0x1FFFF, &pool);
+        });
+        report("declutter_parallel_" + std::to_string(threads), r,
+                ccds * DECLUTTER_SEGMENTS * samples);
+    }
+}
+
+void pixel3d(const int iterations, const uint64_t samples) {
+    const uint64_t pixels = 3 * DECLUTTER_SEGMENTS * samples;
+    report("pixel3d_alloc", measure(iterations, [&]() {
+        Pixel3d p(3, DECLUTTER_SEGMENTS, samples);
+    }));
+
+    // first touch pays the page faults that declutter otherwise takes
+    report("pixel3d_alloc_touch", measure(iterations, [&]() {
+        Pixel3d p(3, DECLUTTER_SEGMENTS, samples);
+        int32_t*** arr = p.get();
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < DECLUTTER_SEGMENTS; j++) {
+                std::memset(arr[i][j], 0, samples * sizeof(int32_t));
+            }
+        }
+    }), pixels);
+
+    // recycled buffers are faulted in once, on the warm up op
+    PixelPool pool(uint64_t(1) << 32, PixelPages::TRANSPARENT);
+    report("pixel3d_pool_touch", measure(iterations, [&]() {
+        Pixel3d p(3, DECLUTTER_SEGMENTS, samples, &pool);
+        int32_t*** arr = p.get();
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < DECLUTTER_SEGMENTS; j++) {
+                std::memset(arr[i][j], 0, samples * sizeof(int32_t));
+            }
+        }
+    }), pixels);
+}
+
+void write_pix_file(const int iterations, const uint64_t samples,
+                    const int rows, const std::string& name,
+                    const fs::path& dir) {
+    fs::create_directories(dir);
+    const fs::path path = dir / "BM_O_20201018_000001-R22S00.fits";
+
+    std::vector<int> segments;
+    for (int i = 0; i < DECLUTTER_SEGMENTS; i++) {
+        segments.push_back(i);
+    }
+    Formatter fmt(segments);
+
+    Pixel3d pixels(1, DECLUTTER_SEGMENTS, samples);
+    int32_t** ccd = pixels.get()[0];
+    for (int j = 0; j < DECLUTTER_SEGMENTS; j++) {
+        for (uint64_t k = 0; k < samples; k++) {
+            ccd[j][k] = (k * 31 + j) & 0x3FFFF;
+        }
+    }
+    int32_t len = samples;
+    long naxes[2] = { COLUMNS, rows + OVERROWS };
+
+    result r = measure(iterations, [&]() {
+        fmt.write_pix_file(ccd, len, naxes, path);
+    });
+    report("write_pix_file_" + name, r, DECLUTTER_SEGMENTS * samples);
+    std::remove(path.string().c_str());
+}
+
+void write_key(const int iterations) {
+    YAMLFormatter fmt(std::vector<std::string>{});
+    YAML::Node keys = YAML::Load(
+        "- {keyword: TELESCOP, value: LSST, comment: Telescope}\n"
+        "- {keyword: EXPTIME, value: 15.0, comment: Exposure time}\n"
+        "- {keyword: SEQNUM, value: 42, comment: Sequence number}\n"
+        "- {keyword: OBSID, value: !!str 20201018, comment: Observation}\n"
+        "- {keyword: SHUTTER, value: true, comment: Shutter closed}\n"
+        "- {keyword: DATASEC, value: '[4:512,1:2000]', comment: Data}\n"
+        "- {keyword: TEMP, value: .nan, comment: Unknown}\n"
+        "- {keyword: DARKTIME, value: 15.2, comment: Dark time}\n");
+    const int per_file = 100;
+
+    // one op is a header of per_file keywords in an in-memory fitsfile
+    result r = measure(iterations, [&]() {
+        fitsfile* fptr;
+        int status = 0;
+        fits_create_file(&fptr, "mem://", &status);
+        fits_create_img(fptr, LONG_IMG, 0, nullptr, &status);
+        for (int i = 0; i < per_file; i++) {
+            fmt.write_key(fptr, keys[i % keys.size()]);
+        }
+        fits_close_file(fptr, &status);
+    });
+    r.allocs /= per_file;
+    r.ns /= per_file;
+    report("write_key", r);
+}
+
+void decode_filename(const int iterations) {
+    const std::string filename =
+        "/data/fits/BM_O_20201018_000001-R22S01.fits";
+    report("decode_filename", measure(iterations, [&]() {
+        L1::Board board = L1::Board::decode_filename(filename);
+    }));
+}
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+    const int rows = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const fs::path disk = argc > 3 ? argv[3] : "/var/tmp/kernel_bench";
+    const fs::path tmpfs = argc > 4 ? argv[4] : "/dev/shm/kernel_bench";
+
+    const uint64_t samples = uint64_t(COLUMNS) * (rows + OVERROWS);
+
+    declutter(iterations, samples);
+    declutter_parallel(iterations, samples);
+    pixel3d(iterations, samples);
+    write_pix_file(iterations, samples, rows, "tmpfs", tmpfs);
+    write_pix_file(iterations, samples, rows, "disk", disk);
+    write_key(iterations * 100);
+    decode_filename(iterations * 100000);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <core/SimpleLogger.h>
+
+/**
+ * Time spent in the calling thread per log statement
+ *
+ * Logs a per-ccd style statement in bursts that fit a thread ring and lets
+ * the writer drain between bursts, so that the numbers are for accepted
+ * records and not for the drop path. The log file goes to the given
+ * directory, /tmp by default.
+ *
+ * usage: logger_bench [bursts] [log dir]
+ */
+
+namespace chr = std::chrono;
+
+int main(int argc, char* argv[]) {
+    int bursts = argc > 1 ? std::atoi(argv[1]) : 1000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    init_log(dir, "logger_bench");
+
+    const std::string path = "/data/fits/AT_O_20190101_000001-R22S01.fits";
+    const int burst = LOG_RING_SLOTS / 2;
+
+    std::vector<double> ns;
+    std::vector<double> dbg;
+    for (int b = 0; b < bursts; b++) {
+        auto start = chr::steady_clock::now();
+        for (int i = 0; i < burst; i++) {
+            LOG_INF << "Finished writing pixel fitsfile at " << path
+                    << " ccd " << i;
+        }
+        auto mid = chr::steady_clock::now();
+        for (int i = 0; i < burst; i++) {
+            LOG_DBG << "Finished writing pixel fitsfile at " << path
+                    << " ccd " << i;
+        }
+        auto end = chr::steady_clock::now();
+
+        ns.push_back(chr::duration<double, std::nano>(mid - start).count()
+                / burst);
+        dbg.push_back(chr::duration<double, std::nano>(end - mid).count()
+                / burst);
+        flush_log();
+    }
+
+    for (auto&& r : { std::make_pair("info", &ns),
+                      std::make_pair("debug", &dbg) }) {
+        std::vector<double>& v = *r.second;
+        std::sort(v.begin(), v.end());
+        std::cout << r.first
+                  << " p50_ns=" << v[v.size() / 2]
+                  << " p99_ns=" << v[v.size() * 99 / 100]
+                  << std::endl;
+    }
+    return 0;
+}
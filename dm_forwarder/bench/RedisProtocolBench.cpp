@@ -0,0 +1,163 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <core/RedisProtocol.h>
+
+/**
+ * Allocations and time per redis command on the encode and parse paths
+ *
+ * Compares building arguments as vectors of strings and copying replies into
+ * a tree of Reply, as RedisConnection used to, against RedisEncoder and
+ * RedisReplies. Replies are synthetic redisReply objects, so no redis server
+ * is needed. Allocations are counted by replacing global operator new.
+ *
+ * usage: redis_protocol_bench [iterations]
+ */
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t n) {
+    allocations++;
+    void* p = std::malloc(n ? n : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+namespace chr = std::chrono;
+
+struct result {
+    double allocs;
+    double ns;
+};
+
+template <typename F>
+result measure(const int iterations, F f) {
+    // warm up reusable buffers
+    f();
+
+    uint64_t before = allocations.load();
+    auto start = chr::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+    auto end = chr::steady_clock::now();
+
+    result r;
+    r.allocs = double(allocations.load() - before) / iterations;
+    r.ns = chr::duration<double, std::nano>(end - start).count() / iterations;
+    return r;
+}
+
+void report(const std::string& name, const result& r) {
+    std::cout << name
+              << " allocs_per_op=" << r.allocs
+              << " ns_per_op=" << r.ns
+              << std::endl;
+}
+
+redisReply make_string(const char* s) {
+    redisReply r;
+    std::memset(&r, 0, sizeof(r));
+    r.type = REDIS_REPLY_STRING;
+    r.str = const_cast<char*>(s);
+    r.len = std::strlen(s);
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    const std::string key = "AT_O_20190101_000001:ccd";
+    const std::string value =
+        "/data/fits/AT_O_20190101_000001-R00S00.fits";
+
+    // encode: one lpush with one value
+    std::vector<std::vector<std::string>> queued;
+    queued.reserve(1);
+    report("encode_vector", measure(iterations, [&]() {
+        std::vector<std::string> v{ "lpush", key };
+        std::vector<std::string> values{ value };
+        std::copy(values.begin(), values.end(), std::back_inserter(v));
+        queued.push_back(v);
+        queued.clear();
+    }));
+
+    RedisEncoder encoder;
+    report("encode_resp", measure(iterations, [&]() {
+        encoder.command(3);
+        encoder.arg("lpush");
+        encoder.arg(key);
+        encoder.arg(value);
+        encoder.clear();
+    }));
+
+    // parse: smembers reply with 9 fitsfiles
+    std::vector<std::string> paths;
+    for (int i = 0; i < 9; i++) {
+        paths.push_back(value + std::to_string(i));
+    }
+    std::vector<redisReply> elements;
+    for (auto&& p : paths) {
+        elements.push_back(make_string(p.c_str()));
+    }
+    std::vector<redisReply*> element_ptrs;
+    for (auto&& e : elements) {
+        element_ptrs.push_back(&e);
+    }
+    redisReply array;
+    std::memset(&array, 0, sizeof(array));
+    array.type = REDIS_REPLY_ARRAY;
+    array.elements = element_ptrs.size();
+    array.element = element_ptrs.data();
+
+    RedisReplies copier;
+    report("parse_copy", measure(iterations, [&]() {
+        copier.parse(&array);
+        Reply r = copier.copy(copier[0]);
+        copier.clear();
+    }));
+
+    RedisReplies replies;
+    size_t total = 0;
+    report("parse_view", measure(iterations, [&]() {
+        replies.parse(&array);
+        total += replies.element(replies[0], 8).str.size();
+        replies.clear();
+    }));
+
+    return total ? 0 : 1;
+}
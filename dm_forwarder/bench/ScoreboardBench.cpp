@@ -0,0 +1,208 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <core/Exceptions.h>
+#include <core/RedisConnection.h>
+#include <forwarder/Scoreboard.h>
+
+/**
+ * Per-image scoreboard bookkeeping latency
+ *
+ * Runs the calls one image goes through in the forwarder (XFER_PARAMS,
+ * HEADER_READY, one fitsfile per ccd, assemble, format, transfer, cleanup)
+ * against the in-memory Scoreboard, the in-memory Scoreboard with redis
+ * write-behind, and the previous implementation that made a redis round-trip
+ * per call.
+ *
+ * usage: scoreboard_bench [images] [redis host] [redis port] [redis db]
+ */
+
+namespace chr = std::chrono;
+
+const int CCDS = 9;
+
+xfer_info make_xfer() {
+    xfer_info xfer;
+    xfer.target = "ARC@141.142.238.10:/data/staging";
+    xfer.session_id = "session_1";
+    xfer.job_num = "job_1";
+    for (int i = 0; i < CCDS / 3; i++) {
+        xfer.locations.push_back("22/" + std::to_string(i));
+    }
+    return xfer;
+}
+
+void image_scoreboard(Scoreboard& db, const std::string& image_id,
+                      const xfer_info& xfer) {
+    db.add_xfer(image_id, xfer);
+    db.add_header(image_id, "/tmp/header/" + image_id);
+    db.locations(image_id);
+    for (int i = 0; i < CCDS; i++) {
+        db.add_ccd(image_id, "/tmp/fits/" + image_id + "-R22S0" +
+                std::to_string(i) + ".fits");
+    }
+    db.ready(image_id);
+    db.header(image_id);
+    db.ccds(image_id);
+    db.get_xfer(image_id);
+    db.header(image_id);
+    db.ccds(image_id);
+    db.remove(image_id);
+}
+
+// same calls as image_scoreboard, one redis round-trip each
+void image_redis(RedisConnection& con, const std::string& image_id,
+                 const xfer_info& xfer) {
+    con.set(image_id + ":target", xfer.target);
+    con.set(image_id + ":session_id", xfer.session_id);
+    con.set(image_id + ":job_num", xfer.job_num);
+    con.lpush(image_id + ":locations", xfer.locations);
+    con.exec();
+
+    con.set(image_id + ":header", "/tmp/header/" + image_id);
+    con.exec();
+
+    con.lrange(image_id + ":locations", "0", "-1");
+    con.exec();
+
+    for (int i = 0; i < CCDS; i++) {
+        con.lpush(image_id + ":ccd", { "/tmp/fits/" + image_id + "-R22S0" +
+                std::to_string(i) + ".fits" });
+        con.exec();
+    }
+
+    con.exists(image_id + ":ccd");
+    con.exists(image_id + ":header");
+    con.exec();
+
+    for (int i = 0; i < 2; i++) {
+        if (i == 1) {
+            con.get(image_id + ":session_id");
+            con.get(image_id + ":job_num");
+            con.get(image_id + ":target");
+            con.lrange(image_id + ":locations", "0", "-1");
+            con.exec();
+        }
+        con.get(image_id + ":header");
+        con.exec();
+        con.lrange(image_id + ":ccd", "0", "-1");
+        con.exec();
+    }
+
+    con.keys(image_id + "*");
+    std::vector<Reply> r = con.exec();
+    std::vector<std::string> keys;
+    for (auto&& val : r[0].elements) {
+        keys.push_back(val.str);
+    }
+    con.del(keys);
+    con.exec();
+}
+
+void report(const std::string& name, std::vector<double>& us) {
+    std::sort(us.begin(), us.end());
+    double sum = 0;
+    for (auto&& x : us) {
+        sum += x;
+    }
+    std::cout << name
+              << " images=" << us.size()
+              << " mean_us=" << sum / us.size()
+              << " p50_us=" << us[us.size() / 2]
+              << " p99_us=" << us[us.size() * 99 / 100]
+              << " max_us=" << us.back()
+              << std::endl;
+}
+
+std::vector<double> run(int images,
+        std::function<void (const std::string&)> image) {
+    std::vector<double> us;
+    for (int i = 0; i < images; i++) {
+        const std::string image_id = "AT_O_20190101_" + std::to_string(i);
+        auto start = chr::steady_clock::now();
+        image(image_id);
+        auto end = chr::steady_clock::now();
+        us.push_back(chr::duration<double, std::micro>(end - start).count());
+    }
+    return us;
+}
+
+int main(int argc, char* argv[]) {
+    int images = argc > 1 ? std::atoi(argv[1]) : 10000;
+    std::string host = argc > 2 ? argv[2] : "localhost";
+    int port = argc > 3 ? std::atoi(argv[3]) : 6379;
+    int db = argc > 4 ? std::atoi(argv[4]) : 15;
+
+    const xfer_info xfer = make_xfer();
+
+    {
+        Scoreboard board(60);
+        std::vector<double> us = run(images, [&](const std::string& id) {
+            image_scoreboard(board, id, xfer);
+        });
+        report("memory", us);
+    }
+
+    redis_connection_params params;
+    params.host = host;
+    params.port = port;
+    params.db = db;
+
+    try {
+        AsyncRedis(params).call({ "ping" }).get();
+
+        Scoreboard board(params, 60);
+        std::vector<double> us = run(images, [&](const std::string& id) {
+            image_scoreboard(board, id, xfer);
+        });
+        report("memory+write_behind", us);
+
+        auto start = chr::steady_clock::now();
+        board.flush();
+        auto end = chr::steady_clock::now();
+        std::cout << "write_behind drain_ms="
+                  << chr::duration<double, std::milli>(end - start).count()
+                  << std::endl;
+    }
+    catch (L1::RedisError& e) {
+        std::cout << "skipping redis runs: " << e.what() << std::endl;
+        return 0;
+    }
+
+    RedisConnection con(host, port, db);
+    con.flushdb();
+    con.exec();
+    std::vector<double> us = run(images, [&](const std::string& id) {
+        image_redis(con, id, xfer);
+    });
+    report("redis", us);
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNCREDIS_H
+#define ASYNCREDIS_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <hiredis/async.h>
+#include <core/RedisConnection.h>
+
+/**
+ * Non-blocking redis client running on its own event loop thread
+ *
+ * Commands can be queued from any thread and return immediately. The loop
+ * thread owns the hiredis async context, connects lazily with the connect
+ * timeout of redis_connection_params, pipelines everything queued since the
+ * last iteration and hands replies to callbacks or futures. A slow or
+ * unreachable server therefore only delays the callbacks, never the caller.
+ *
+ * Callbacks run on the loop thread and must not block.
+ */
+class AsyncRedis {
+    public:
+        /**
+         * Called with an empty error and the reply on success, or with the
+         * error and an empty reply on failure
+         */
+        typedef std::function<void (const std::string& error,
+                                    const Reply& reply)> callback;
+
+        /**
+         * Construct AsyncRedis and start its event loop
+         *
+         * @param params redis server, AUTH is sent only if passwd is set
+         */
+        AsyncRedis(const redis_connection_params& params);
+
+        /**
+         * Wait for queued commands up to the connect timeout, then stop
+         */
+        ~AsyncRedis();
+
+        /**
+         * Queue command, first element is the command name
+         *
+         * @param args command and arguments
+         * @param cb called from the loop thread, may be empty
+         */
+        void send(std::vector<std::string> args, callback cb = nullptr);
+
+        /**
+         * Queue command and get a future of its reply
+         *
+         * The future throws L1::RedisError if the command failed.
+         */
+        std::future<Reply> call(std::vector<std::string> args);
+
+        /**
+         * Block until every command queued so far has a reply or failed
+         */
+        void flush();
+
+    private:
+        struct op {
+            std::vector<std::string> args;
+            callback cb;
+        };
+
+        redis_connection_params _params;
+        std::chrono::milliseconds _connect_timeout;
+
+        // commands waiting for the loop thread
+        std::deque<op*> _queue;
+        // commands queued or sent without a reply yet
+        size_t _outstanding;
+        std::mutex _mutex;
+        std::condition_variable _idle;
+
+        // owned by the loop thread
+        redisAsyncContext* _ac;
+        bool _connected;
+        bool _want_read;
+        bool _want_write;
+        std::chrono::steady_clock::time_point _connect_deadline;
+        std::chrono::steady_clock::time_point _retry_at;
+
+        int _wake[2];
+        std::atomic<bool> _stop;
+        std::thread _loop;
+
+        void run();
+        void connect();
+        void disconnected(const std::string& error);
+        void issue(op* o);
+        void fail_queued(const std::string& error);
+        void done(op* o, const std::string& error, const Reply& reply);
+        void wake();
+
+        // hiredis callbacks and event hooks
+        static void on_connect(const redisAsyncContext* ac, int status);
+        static void on_disconnect(const redisAsyncContext* ac, int status);
+        static void on_reply(redisAsyncContext* ac, void* r, void* privdata);
+        static void add_read(void* data);
+        static void del_read(void* data);
+        static void add_write(void* data);
+        static void del_write(void* data);
+        static void cleanup(void* data);
+};
+
+#endif
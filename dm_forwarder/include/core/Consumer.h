@@ -24,6 +24,7 @@
 #ifndef CONSUMER_H
 #define CONSUMER_H
 
+#include <functional>
 #include "core/RabbitConnection.h"
 
 /**
@@ -193,6 +193,11 @@ namespace L1 {
         public:
             ScannerError(const std::string& msg) : L1Exception(msg) {}
     };
+
+    class MetricsError: public L1Exception {
+        public:
+            MetricsError(const std::string& msg) : L1Exception(msg) {}
+    };
 };
 
 #endif
@@ -24,11 +24,11 @@
 #ifndef HEARTBEAT_H
 #define HEARTBEAT_H
 
-#include <atomic>
-#include <functional>
 #include <mutex>
-#include <condition_variable>
-#include <core/RedisConnection.h>
+#include <cstdint>
+#include <functional>
+#include <core/AsyncRedis.h>
+#include <core/Scheduler.h>
 
 struct heartbeat_params {
     redis_connection_params redis_params;
@@ -38,30 +38,53 @@ struct heartbeat_params {
     std::function<void ()> action;
 };
 
+/**
+ * Check that the associated CSC keeps its heartbeat key alive
+ *
+ * The key is checked on start and every seconds_to_expire on the scheduler
+ * thread. When it is gone, action is run once and the watch stops.
+ */
 class Watcher {
     public:
+        Watcher(Scheduler& scheduler, AsyncRedis& redis);
+        ~Watcher();
+
+        /**
+         * Watch a new association, replacing the previous one
+         */
         void start(const heartbeat_params params);
         void clear();
 
     private:
-        std::atomic<bool> _stop;
-        std::condition_variable _cond;
+        Scheduler& _scheduler;
+        AsyncRedis& _redis;
+        Scheduler::timer_id _timer;
+
+        // bumped on every start and clear so that replies to checks of a
+        // previous association are ignored
+        uint64_t _generation;
         std::mutex _mutex;
 
-        void check(const heartbeat_params params);
+        void check(const heartbeat_params& params, const uint64_t generation);
 };
 
+/**
+ * Keep the forwarder heartbeat key alive
+ *
+ * The key is set with seconds_to_expire on construction and every
+ * seconds_to_update on the scheduler thread.
+ */
 class Beacon {
     public:
-        Beacon(const heartbeat_params params);
+        Beacon(Scheduler& scheduler,
+               AsyncRedis& redis,
+               const heartbeat_params params);
+        ~Beacon();
         void clear();
 
     private:
-        std::atomic<bool> _stop;
-        std::condition_variable _cond;
-        std::mutex _mutex;
-
-        void ping(const heartbeat_params& params);
+        Scheduler& _scheduler;
+        Scheduler::timer_id _timer;
 };
 
 #endif
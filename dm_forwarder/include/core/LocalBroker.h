@@ -0,0 +1,83 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCAL_BROKER_H
+#define LOCAL_BROKER_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <functional>
+#include <condition_variable>
+#include <core/Publisher.h>
+
+/**
+ * In-process stand-in for RabbitMQ
+ *
+ * Named queues are created on first use and hold messages until they are
+ * taken, in publish order. Messages of a queue go to one consumer at a time,
+ * like a RabbitMQ queue with a single consumer.
+ */
+class LocalBroker : public Publisher {
+    public:
+        LocalBroker();
+
+        void publish_message(const std::string& queue,
+                             const std::string& body);
+
+        /**
+         * Take the oldest message of queue, waiting up to timeout
+         *
+         * @return false if queue stayed empty or the broker was stopped
+         */
+        bool get(const std::string& queue,
+                 std::string& body,
+                 const std::chrono::milliseconds timeout);
+
+        /**
+         * Call on_message for every message of queue until stop, as
+         * Consumer::run does
+         */
+        void run(const std::string& queue,
+                 std::function<void (const std::string&)> on_message);
+
+        /**
+         * Messages waiting in queue
+         */
+        size_t size(const std::string& queue);
+
+        /**
+         * Wake up and end get and run calls
+         */
+        void stop();
+
+    private:
+        bool _stop;
+        std::map<std::string, std::deque<std::string>> _queues;
+        std::mutex _mutex;
+        std::condition_variable _published;
+};
+
+#endif
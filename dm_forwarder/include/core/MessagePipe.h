@@ -0,0 +1,75 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MESSAGE_PIPE_H
+#define MESSAGE_PIPE_H
+
+#include <mutex>
+#include <string>
+#include <core/Publisher.h>
+
+/**
+ * Messages between the supervisor and a worker process over a stream socket
+ *
+ * Each message is a queue and a body framed by their lengths. The supervisor
+ * hands consumed messages to a worker and the worker publishes through its
+ * end, the supervisor relays what it reads to RabbitMQ. Publishing is safe
+ * from several threads, reading is done by one thread.
+ */
+class MessagePipe : public Publisher {
+    public:
+        /**
+         * Take over socket fd, which is closed on destruction
+         */
+        MessagePipe(const int fd);
+        ~MessagePipe();
+
+        /**
+         * Send body for queue to the other end
+         *
+         * @throws L1::PublisherError if the other end is gone
+         */
+        void publish_message(const std::string& queue,
+                             const std::string& body);
+
+        /**
+         * Wait for the next message from the other end
+         *
+         * @return false once the other end closed the socket
+         */
+        bool get(std::string& queue, std::string& body);
+
+        /**
+         * Send no more messages, get of the other end returns false once it
+         * read the rest while it can still publish back
+         */
+        void shutdown();
+
+    private:
+        int _fd;
+        std::mutex _mutex;
+
+        bool read_all(char* buf, size_t n);
+};
+
+#endif
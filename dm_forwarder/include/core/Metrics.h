@@ -0,0 +1,265 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+// linear sub buckets per power of two, 8 keeps the relative error of a
+// recorded value under 12.5%
+#define METRICS_SUB_BITS 3
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BITS)
+#define METRICS_BUCKETS ((64 - METRICS_SUB_BITS + 1) * METRICS_SUB_BUCKETS)
+
+// prefix of every exported metric name
+#define METRICS_PREFIX "dm_forwarder_"
+
+// milliseconds the metrics server waits for a scraper to send its request
+#define METRICS_READ_TIMEOUT 1000
+
+/**
+ * Monotonic counter, safe to add to from any thread
+ */
+class Counter {
+    public:
+        Counter();
+        void add(const uint64_t n = 1);
+        uint64_t value() const;
+
+    private:
+        std::atomic<uint64_t> _value;
+};
+
+/**
+ * Value that goes up and down, safe to set from any thread
+ */
+class Gauge {
+    public:
+        Gauge();
+        void set(const int64_t value);
+        void add(const int64_t n);
+        int64_t value() const;
+
+    private:
+        std::atomic<int64_t> _value;
+};
+
+/**
+ * HDR style histogram of microsecond latencies
+ *
+ * Values below METRICS_SUB_BUCKETS get a bucket each, above that every power
+ * of two is split into METRICS_SUB_BUCKETS linear buckets. Recording is a
+ * handful of relaxed atomic adds and never allocates or locks, so it can be
+ * called on the pixel path. Readers see a consistent enough view for
+ * percentiles without stopping writers.
+ */
+class Histogram {
+    public:
+        Histogram();
+
+        /**
+         * Record one value in microseconds
+         */
+        void record(const uint64_t us);
+
+        uint64_t count() const;
+        uint64_t sum() const;
+        uint64_t max() const;
+
+        /**
+         * Number of recorded values up to the end of the bucket holding us,
+         * exact when us is the upper bound of a bucket
+         */
+        uint64_t count_below(const uint64_t us) const;
+
+        /**
+         * Upper bound of the bucket holding quantile q, 0 when empty
+         *
+         * @param q quantile between 0 and 1
+         */
+        uint64_t percentile(const double q) const;
+
+        static size_t bucket(const uint64_t us);
+
+        /**
+         * Largest value that falls into bucket
+         */
+        static uint64_t upper(const size_t bucket);
+
+    private:
+        std::atomic<uint64_t> _buckets[METRICS_BUCKETS];
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint64_t> _max;
+};
+
+/**
+ * Labels of a pipeline stage series
+ */
+struct metric_labels {
+    std::string stage;
+    std::string sensor;
+    std::string location;
+};
+
+bool operator<(const metric_labels& lhs, const metric_labels& rhs);
+
+/**
+ * Process wide registry of stage latencies and counters
+ *
+ * Series are keyed by stage, sensor type and location. Looking up a series
+ * takes a lock the first time the labels are seen, the returned reference
+ * stays valid for the life of the process so hot paths can keep it.
+ */
+class Metrics {
+    public:
+        static Metrics& instance();
+
+        /**
+         * Latency histogram of a stage
+         */
+        Histogram& latency(const std::string& stage,
+                           const std::string& sensor = "",
+                           const std::string& location = "");
+
+        /**
+         * Counter exported as METRICS_PREFIX + name + "_total"
+         */
+        Counter& counter(const std::string& name,
+                         const std::string& stage,
+                         const std::string& sensor = "",
+                         const std::string& location = "");
+
+        /**
+         * Gauge exported as METRICS_PREFIX + name
+         */
+        Gauge& gauge(const std::string& name,
+                     const std::string& stage,
+                     const std::string& sensor = "",
+                     const std::string& location = "");
+
+        /**
+         * All series in Prometheus text exposition format
+         */
+        std::string render();
+
+        /**
+         * Latency histograms recorded so far, for reports that are not
+         * Prometheus text such as the benchmarks
+         *
+         * Histograms live as long as the series, that is until clear().
+         */
+        std::vector<std::pair<metric_labels, const Histogram*>> latencies();
+
+        /**
+         * Write render() to path, replacing it atomically so that readers
+         * such as the node exporter textfile collector never see a partial
+         * file
+         *
+         * @throws L1::MetricsError if file cannot be written
+         */
+        void dump(const std::string& path);
+
+        /**
+         * Drop all series, for tests
+         */
+        void clear();
+
+    private:
+        Metrics() = default;
+
+        std::mutex _mutex;
+        std::map<metric_labels, std::unique_ptr<Histogram>> _latency;
+        std::map<std::string, std::map<metric_labels,
+            std::unique_ptr<Counter>>> _counters;
+        std::map<std::string, std::map<metric_labels,
+            std::unique_ptr<Gauge>>> _gauges;
+};
+
+/**
+ * Record lifetime of the scope into a histogram
+ */
+class StageTimer {
+    public:
+        StageTimer(Histogram& hist);
+
+        /**
+         * Record elapsed time unless stop was called
+         */
+        ~StageTimer();
+
+        /**
+         * Microseconds since construction
+         */
+        uint64_t elapsed() const;
+
+        /**
+         * Record elapsed time now, for stages that end before the scope
+         */
+        void stop();
+
+    private:
+        Histogram& _hist;
+        std::chrono::steady_clock::time_point _start;
+        bool _stopped;
+};
+
+/**
+ * Minimal HTTP endpoint answering every request with Metrics::render()
+ *
+ * One connection is served at a time on the server thread, which is plenty
+ * for a scraper polling every few seconds.
+ */
+class MetricsServer {
+    public:
+        /**
+         * Listen on port, 0 picks a free one
+         *
+         * @throws L1::MetricsError if port cannot be bound
+         */
+        MetricsServer(const int port);
+        ~MetricsServer();
+
+        int port() const;
+
+    private:
+        int _fd;
+        int _port;
+        int _wake[2];
+        std::atomic<bool> _stop;
+        std::thread _worker;
+
+        void run();
+        void serve(const int client);
+};
+
+#endif
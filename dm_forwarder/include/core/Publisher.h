@@ -21,34 +21,28 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#ifndef REDISRESPONSE_H
-#define REDISRESPONSE_H
+#ifndef PUBLISHER_H
+#define PUBLISHER_H
 
 #include <string>
-#include <vector>
-#include <hiredis/hiredis.h>
 
-struct Reply {
-    long long integer;
-    std::string str;
-    std::vector<Reply> elements;
-};
-
-struct RedisArg {
-    std::vector<std::string> arg;
-};
-
-class RedisResponse {
+/**
+ * Transport the forwarder publishes its messages through
+ *
+ * SimplePublisher talks to RabbitMQ, LocalBroker keeps messages in process
+ * for load tools and tests.
+ */
+class Publisher {
     public:
-        RedisResponse(redisContext* context,
-                      RedisArg arg);
-        ~RedisResponse();
-        Reply get();
-        Reply reply(redisReply* r);
+        virtual ~Publisher() { }
 
-    private:
-        redisContext* _context;
-        RedisArg _arg;
+        /**
+         * Publish body to queue
+         *
+         * @throws L1::PublisherError if message cannot be published
+         */
+        virtual void publish_message(const std::string& queue,
+                                     const std::string& body) = 0;
 };
 
 #endif
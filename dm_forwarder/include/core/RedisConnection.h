@@ -24,27 +24,61 @@
 #ifndef REDIS_CONNECTION_H
 #define REDIS_CONNECTION_H
 
+#include <map>
+#include <mutex>
+#include <memory>
 #include <vector>
+#include <cstdint>
 #include <hiredis/hiredis.h>
+#include <boost/utility/string_view.hpp>
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
-#include <core/RedisResponse.h>
+#include <core/RedisProtocol.h>
 
 /**
  * Wrapper class for creating a redis connection
  *
- * RedisConnection is a higher level abstraction for hiredis API calls. It
- * implements one method called `command`, which should be used for sending
- * command to redis database.
+ * RedisConnection is a higher level abstraction for hiredis API calls.
+ * Commands are encoded into a reusable buffer as they are queued and sent in
+ * one pipeline by `exec`.
  *
  * Note: redisContext is not thread-safe.
  */
 
+// milliseconds to wait for the connection handshake
+#define REDIS_CONNECT_TIMEOUT 2000
+
 struct redis_connection_params {
     std::string host;
     int port;
     int db;
     std::string passwd;
+    int connect_timeout = REDIS_CONNECT_TIMEOUT;
+};
+
+/**
+ * Latency of one redis command name
+ *
+ * Latency is measured from the time a pipeline is sent until the reply of
+ * the command is read back, in microseconds.
+ */
+struct redis_command_stats {
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+};
+
+/**
+ * Thread-safe per-command latency stats shared by connections
+ */
+class RedisStats {
+    public:
+        void record(const std::string& command, const uint64_t us);
+        std::map<std::string, redis_command_stats> get();
+
+    private:
+        std::map<std::string, redis_command_stats> _stats;
+        std::mutex _mutex;
 };
 
 class RedisConnection {
@@ -58,29 +92,83 @@ class RedisConnection {
                         const std::string passwd);
         RedisConnection(redis_connection_params params);
         ~RedisConnection();
-        void auth(const std::string passwd);
-        void select(const std::string index);
-        void lpush(const std::string key,
-                   std::vector<std::string> values);
-        void setex(const std::string key,
-                   const std::string seconds,
-                   const std::string value);
-        void exists(const std::string key);
-        void set(const std::string key,
-                 const std::string value);
-        void get(const std::string key);
-        void lrange(const std::string key,
-                    const std::string start,
-                    const std::string stop);
+        void auth(const boost::string_view passwd);
+        void select(const boost::string_view index);
+        void lpush(const boost::string_view key,
+                   const std::vector<std::string>& values);
+        void setex(const boost::string_view key,
+                   const boost::string_view seconds,
+                   const boost::string_view value);
+        void exists(const boost::string_view key);
+        void set(const boost::string_view key,
+                 const boost::string_view value);
+        void get(const boost::string_view key);
+        void lrange(const boost::string_view key,
+                    const boost::string_view start,
+                    const boost::string_view stop);
         void flushdb();
-        void keys(const std::string pattern);
-        void del(std::vector<std::string> keys);
+        void keys(const boost::string_view pattern);
+        void del(const std::vector<std::string>& keys);
+        void hgetall(const boost::string_view key);
+        void smembers(const boost::string_view key);
+        void srem(const boost::string_view key,
+                  const std::vector<std::string>& members);
+
+        /**
+         * Queue arbitrary command, first element is the command name
+         */
+        void command(const std::vector<std::string>& args);
+
+        /**
+         * Send queued commands in one pipeline and read all replies
+         *
+         * @throws L1::RedisError after all replies are read if any command
+         *      failed, so the connection stays in sync
+         */
         std::vector<Reply> exec();
 
+        /**
+         * Same as `exec` without copying the replies
+         *
+         * @return views valid until the next call on this connection
+         */
+        const RedisReplies& exec_view();
+
+        /**
+         * Send queued commands wrapped in MULTI/EXEC
+         *
+         * @return replies of the queued commands
+         * @throws L1::RedisError if the transaction was not executed
+         */
+        std::vector<Reply> transaction();
+
+        /**
+         * Check that the connection can still be used
+         */
+        bool ok();
+
+        /**
+         * Record latency of every command sent from now on
+         */
+        void set_stats(std::shared_ptr<RedisStats> stats);
+
     private:
         std::string _host;
         redisContext* _context;
-        std::vector<RedisArg> _commands;
+        std::shared_ptr<RedisStats> _stats;
+
+        // queued commands in RESP, names of queued commands for stats and
+        // errors. Both are reused across pipelines.
+        RedisEncoder _encoder;
+        std::vector<std::string> _pending;
+        size_t _num_pending;
+
+        // replies of the last pipeline
+        RedisReplies _replies;
+        std::vector<redisReply*> _raw;
+
+        void begin(const boost::string_view name, const size_t argc);
+        void free_replies();
 };
 
 #endif
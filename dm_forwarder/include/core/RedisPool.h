@@ -0,0 +1,109 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef REDISPOOL_H
+#define REDISPOOL_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <core/RedisConnection.h>
+
+/**
+ * Process wide pool of warm redis connections
+ *
+ * Connections are keyed by redis_connection_params and handed out as leases.
+ * A lease returns its connection to the pool when it goes out of scope, so
+ * callers only pay for connect, AUTH and SELECT the first time. Connections
+ * that failed are dropped instead of being returned. All connections of a key
+ * record per-command latency into the same RedisStats.
+ */
+class RedisPool {
+    public:
+        class Lease {
+            public:
+                Lease(RedisPool* pool,
+                      const std::string& key,
+                      std::unique_ptr<RedisConnection> con);
+                Lease(Lease&& other);
+                Lease(const Lease&) = delete;
+                Lease& operator=(const Lease&) = delete;
+
+                /**
+                 * Return connection to the pool
+                 */
+                ~Lease();
+
+                RedisConnection* operator->();
+                RedisConnection& operator*();
+
+            private:
+                RedisPool* _pool;
+                std::string _key;
+                std::unique_ptr<RedisConnection> _con;
+        };
+
+        /**
+         * Pool shared by the whole process
+         */
+        static RedisPool& instance();
+
+        /**
+         * Lease a connection, connecting if no idle one is available
+         *
+         * @param params redis server to connect to
+         * @throws L1::RedisError if a new connection cannot be made
+         */
+        Lease lease(const redis_connection_params& params);
+
+        /**
+         * Per-command latency stats of every redis server, keyed by
+         * `host:port/db`
+         */
+        std::map<std::string, std::map<std::string, redis_command_stats>>
+            stats();
+
+        /**
+         * Log per-command latency stats
+         */
+        void report();
+
+    private:
+        struct server {
+            std::string name;
+            std::vector<std::unique_ptr<RedisConnection>> idle;
+            std::shared_ptr<RedisStats> stats;
+        };
+
+        size_t _max_idle;
+        std::map<std::string, server> _servers;
+        std::mutex _mutex;
+
+        RedisPool(const size_t max_idle);
+        void release(const std::string& key,
+                     std::unique_ptr<RedisConnection> con);
+};
+
+#endif
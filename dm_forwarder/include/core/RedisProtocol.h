@@ -0,0 +1,118 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef REDISPROTOCOL_H
+#define REDISPROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <hiredis/hiredis.h>
+#include <boost/utility/string_view.hpp>
+
+/**
+ * Owning copy of a redis reply
+ */
+struct Reply {
+    long long integer;
+    std::string str;
+    std::vector<Reply> elements;
+};
+
+/**
+ * Encodes redis commands in RESP into a reusable buffer
+ *
+ * Arguments are copied straight from the views into the buffer. The buffer
+ * keeps its capacity across `clear`, so encoding does not allocate once it
+ * has grown to the size of the largest pipeline.
+ */
+class RedisEncoder {
+    public:
+        RedisEncoder();
+
+        /**
+         * Start a command with `argc` arguments, including the command name
+         */
+        void command(const size_t argc);
+        void arg(const boost::string_view arg);
+
+        boost::string_view data() const;
+        void clear();
+
+    private:
+        std::string _buf;
+
+        void number(const char prefix, size_t n);
+};
+
+/**
+ * Non-owning view of a redis reply
+ *
+ * `str` points into the parsed redisReply, elements of an array live in the
+ * RedisReplies arena that produced the view.
+ */
+struct ReplyView {
+    int type;
+    long long integer;
+    boost::string_view str;
+    size_t first;
+    size_t size;
+};
+
+/**
+ * Arena of views over the replies of one pipeline
+ *
+ * Parsing writes into a vector that keeps its capacity across `clear`, so
+ * reading replies back does not allocate. Views are valid until `clear` and
+ * as long as the parsed redisReply objects are alive.
+ */
+class RedisReplies {
+    public:
+        /**
+         * Add top-level reply
+         */
+        void parse(const redisReply* r);
+        void clear();
+
+        size_t size() const;
+        const ReplyView& operator[](const size_t i) const;
+
+        /**
+         * i-th element of an array reply
+         */
+        const ReplyView& element(const ReplyView& r, const size_t i) const;
+
+        /**
+         * Make an owning copy of a reply
+         */
+        Reply copy(const ReplyView& r) const;
+
+    private:
+        // top-level replies, in order
+        std::vector<size_t> _top;
+        // every view, elements of an array are contiguous
+        std::vector<ReplyView> _views;
+
+        void fill(const size_t idx, const redisReply* r);
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+// milliseconds per tick of the timer wheel
+#define SCHEDULER_TICK 10
+
+// slots per wheel level, power of two
+#define SCHEDULER_SLOT_BITS 6
+#define SCHEDULER_SLOTS (1 << SCHEDULER_SLOT_BITS)
+
+// wheel levels, with 10 ms ticks the top level spans about 46 hours
+#define SCHEDULER_LEVELS 4
+
+/**
+ * Single thread running timed and periodic tasks
+ *
+ * Timers are kept in a hierarchical timing wheel so that adding, cancelling
+ * and expiring a timer is constant time regardless of how many are pending.
+ * Level 0 has one slot per tick, every higher level has one slot per
+ * rotation of the level below and its timers are cascaded down when the
+ * lower level wraps around. Timers further out than the top level are
+ * parked in its last slot and re-inserted until they are due.
+ *
+ * Periodic timers are rescheduled from their previous deadline, not from
+ * the time the task finished, so they do not drift. Tasks run on the
+ * scheduler thread without its lock held and may add or cancel timers, but
+ * must not block.
+ */
+class Scheduler {
+    public:
+        typedef uint64_t timer_id;
+
+        /**
+         * Construct Scheduler and start its thread
+         *
+         * @param tick resolution of the wheel
+         */
+        Scheduler(const std::chrono::milliseconds tick =
+                std::chrono::milliseconds(SCHEDULER_TICK));
+
+        /**
+         * Stop thread, pending timers are dropped
+         */
+        ~Scheduler();
+
+        /**
+         * Run task once after delay
+         */
+        timer_id after(const std::chrono::milliseconds delay,
+                       std::function<void ()> task);
+
+        /**
+         * Run task every period, first after one period
+         */
+        timer_id every(const std::chrono::milliseconds period,
+                       std::function<void ()> task);
+
+        /**
+         * Run task every period, first after delay
+         */
+        timer_id every(const std::chrono::milliseconds period,
+                       std::function<void ()> task,
+                       const std::chrono::milliseconds delay);
+
+        /**
+         * Cancel timer
+         *
+         * Waits for the task if it is running, unless called from the task
+         * itself, so the task does not run once this returns.
+         *
+         * @param id timer returned by after or every
+         */
+        void cancel(const timer_id id);
+
+        /**
+         * Number of pending timers
+         */
+        size_t size();
+
+    private:
+        struct timer {
+            std::function<void ()> task;
+            uint64_t expires;
+            uint64_t period;
+        };
+
+        std::chrono::milliseconds _tick;
+        std::chrono::steady_clock::time_point _start;
+
+        // ticks processed so far
+        uint64_t _now;
+        timer_id _next_id;
+        std::unordered_map<timer_id, timer> _timers;
+        std::vector<timer_id> _wheel[SCHEDULER_LEVELS][SCHEDULER_SLOTS];
+
+        // timer whose task runs now, 0 if none
+        timer_id _running;
+
+        bool _stop;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::condition_variable _task_done;
+        std::thread _worker;
+
+        uint64_t ticks(const std::chrono::milliseconds duration);
+        timer_id add(std::function<void ()> task,
+                     const uint64_t delay,
+                     const uint64_t period);
+
+        // caller holds the lock
+        void insert(const timer_id id,
+                    const uint64_t expires,
+                    const uint64_t earliest);
+        void advance(std::vector<timer_id>& due);
+        void run();
+};
+
+#endif
@@ -24,25 +24,26 @@
 #ifndef SIMPLE_LOGGER_H
 #define SIMPLE_LOGGER_H
 
+#include <atomic>
 #include <string>
-#include <boost/smart_ptr/shared_ptr.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/log/support/date_time.hpp>
-#include <boost/log/common.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/attributes.hpp>
-#include <boost/log/sinks.hpp>
-#include <boost/log/sources/severity_logger.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-
-namespace logging = boost::log;
-namespace attrs = boost::log::attributes;
-namespace src = boost::log::sources;
-namespace sinks = boost::log::sinks;
-namespace expr = boost::log::expressions;
-namespace keywords = boost::log::keywords;
-
-typedef sinks::asynchronous_sink< sinks::text_file_backend > file_sink;
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+
+// bytes of message text kept per record, longer messages are truncated
+#define LOG_MESSAGE_SIZE 472
+
+// records a thread can have waiting for the writer, further ones are dropped
+#define LOG_RING_SLOTS 256
+
+// milliseconds between writer passes over the rings
+#define LOG_FLUSH_MS 20
+
+// bytes written to a log file before moving on to the next one
+#define LOG_ROTATION_SIZE 16*1024*1024
+
+// log files kept in the log directory
+#define LOG_MAX_FILES 10
 
 enum severity_level {
     debug,
@@ -51,8 +52,22 @@ enum severity_level {
     warning
 };
 
-static src::severity_logger< severity_level > lg;
-BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", severity_level);
+/**
+ * Log statement as stored in the ring of the thread that made it
+ *
+ * Only the message text is rendered by the caller. Time, severity and call
+ * site are stored raw and formatted by the writer thread.
+ */
+struct log_record {
+    int64_t time;
+    const char* file;
+    const char* function;
+    int line;
+    severity_level level;
+    uint32_t size;
+    std::atomic<bool> ready;
+    char message[LOG_MESSAGE_SIZE];
+};
 
 /**
  * Overloaded operator << for log statements
@@ -66,27 +81,112 @@ std::ostream& operator<< (std::ostream& strm, severity_level level);
 /**
  * Initializes log file
  *
- * Creates logging sinks, set up filters and log statements output format
+ * Opens log file and starts the writer thread. Calling it again switches to
+ * the new file after writing out what was logged so far.
  *
  * @param filepath log file directory
  * @param filenaem log file name
  */
 void init_log(const std::string& filepath, const std::string& filename);
 
-#define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
-#define LOGGER(lg_, sev) BOOST_LOG_SEV(lg_, sev) \
-    << std::left\
-    << "    "\
-    << std::setw(30) << std::setfill(' ') << __FILENAME__\
-    << std::setw(30) << std::setfill(' ') << __FUNCTION__\
-    << std::setw(5) << std::setfill(' ') << __LINE__\
-    << "    "
-
-#define LOG_DBG LOGGER(lg, debug)
-#define LOG_INF LOGGER(lg, info)
-#define LOG_CRT LOGGER(lg, critical)
-#define LOG_WRN LOGGER(lg, warning)
-
-BOOST_LOG_INLINE_GLOBAL_LOGGER_DEFAULT(lg, src::severity_logger_mt< severity_level >);
+/**
+ * Write every record published so far to the log file
+ */
+void flush_log();
+
+/**
+ * One log statement
+ *
+ * Claims a slot in the ring of the calling thread on construction, appends
+ * message text into it without allocating or locking and publishes it on
+ * destruction at the end of the statement. If the ring is full the record is
+ * dropped and counted, logging never blocks the caller.
+ */
+class LogLine {
+    public:
+        LogLine(const severity_level level,
+                const char* file,
+                const char* function,
+                const int line);
+        ~LogLine();
+
+        LogLine& operator<<(const char* s);
+        LogLine& operator<<(const std::string& s);
+        LogLine& operator<<(const char c);
+        LogLine& operator<<(const bool b);
+        LogLine& operator<<(const int v);
+        LogLine& operator<<(const long v);
+        LogLine& operator<<(const long long v);
+        LogLine& operator<<(const unsigned int v);
+        LogLine& operator<<(const unsigned long v);
+        LogLine& operator<<(const unsigned long long v);
+        LogLine& operator<<(const double v);
+        LogLine& operator<<(const severity_level v);
+
+        // manipulators such as std::endl have no effect on a record
+        LogLine& operator<<(std::ostream& (*manip)(std::ostream&));
+
+        // anything else that can be streamed, slow path
+        template <typename T>
+        LogLine& operator<<(const T& v) {
+            if (_record) {
+                std::ostringstream s;
+                s << v;
+                *this << s.str();
+            }
+            return *this;
+        }
+
+    private:
+        log_record* _record;
+
+        void append(const char* s, const size_t n);
+        void append_integer(const unsigned long long v, const bool negative);
+};
+
+/**
+ * Sampling for LOG_EVERY_N, true on the first call and every n-th after
+ */
+bool log_every_n(std::atomic<uint64_t>& count, const uint64_t n);
+
+/**
+ * Rate limiting for LOG_EVERY_MS, true if ms passed since it last was
+ */
+bool log_every_ms(std::atomic<int64_t>& last, const int64_t ms);
+
+#define LOGGER(sev) LogLine(sev, __FILE__, __FUNCTION__, __LINE__)
+
+#define LOG_INF LOGGER(info)
+#define LOG_CRT LOGGER(critical)
+#define LOG_WRN LOGGER(warning)
+
+// debug statements are compiled out of release builds
+#ifdef NDEBUG
+#define LOG_DBG if (true) {} else LOGGER(debug)
+#else
+#define LOG_DBG LOGGER(debug)
+#endif
+
+/**
+ * Log only every n-th time the statement runs
+ *
+ * usage: LOG_EVERY_N(warning, 100) << "message";
+ */
+#define LOG_EVERY_N(sev, n) \
+    if (!log_every_n([]() -> std::atomic<uint64_t>& { \
+            static std::atomic<uint64_t> count(0); \
+            return count; }(), n)) {} \
+    else LOGGER(sev)
+
+/**
+ * Log at most once every ms milliseconds from the statement
+ *
+ * usage: LOG_EVERY_MS(critical, 1000) << "message";
+ */
+#define LOG_EVERY_MS(sev, ms) \
+    if (!log_every_ms([]() -> std::atomic<int64_t>& { \
+            static std::atomic<int64_t> last(0); \
+            return last; }(), ms)) {} \
+    else LOGGER(sev)
 
 #endif
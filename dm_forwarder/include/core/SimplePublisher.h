@@ -24,7 +24,9 @@
 #ifndef SIMPLE_PUBLISHER_H
 #define SIMPLE_PUBLISHER_H
 
+#include <mutex>
 #include "core/RabbitConnection.h"
+#include "core/Publisher.h"
 
 /**
  * Message Publisher interface to RabbitMQ Server
@@ -32,7 +34,7 @@
  * SimplePublisher is amqp message publishing object to RabbitMQ Server. It
  * extends connection to RabbitMQ server from RabbitConnection object.
  */
-class SimplePublisher : public RabbitConnection {
+class SimplePublisher : public RabbitConnection, public Publisher {
     public:
         /**
          * Creates connection to RabbitMQ Server
@@ -64,6 +66,11 @@ class SimplePublisher : public RabbitConnection {
          * @exceptsafe Strong exception guarantee
          */
         void publish_message(const std::string& queue, const std::string& body);
+
+    private:
+        // Amqp channel is not thread-safe and messages are published from
+        // several pipeline threads
+        std::mutex _mutex;
 };
 
 #endif
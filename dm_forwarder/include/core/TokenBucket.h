@@ -0,0 +1,72 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Pace a stream of work to an average rate
+ *
+ * Tokens, typically bytes, accrue at `rate` per second up to `burst`. Taking
+ * more tokens than the bucket holds puts it in debt and the caller sleeps
+ * until the debt is paid off, so a large file is paced as a whole and later
+ * callers wait behind it.
+ */
+class TokenBucket {
+    public:
+        /**
+         * Construct a full TokenBucket
+         *
+         * @param rate tokens per second, 0 for no limit
+         * @param burst tokens the bucket holds at most
+         */
+        TokenBucket(const uint64_t rate, const uint64_t burst);
+
+        /**
+         * Take tokens, blocks until the rate allows them
+         *
+         * @param tokens tokens to take
+         * @return microseconds the caller waited
+         */
+        uint64_t take(const uint64_t tokens);
+
+        /**
+         * Tokens per second, 0 for no limit
+         */
+        uint64_t rate();
+
+    private:
+        uint64_t _rate;
+        uint64_t _burst;
+
+        // negative while in debt
+        double _tokens;
+        std::chrono::steady_clock::time_point _last;
+        std::mutex _mutex;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// events kept per thread while tracing, later ones are dropped
+#define TRACE_MAX_EVENTS 100000
+
+/**
+ * Completed span on one thread
+ */
+struct trace_event {
+    const char* name;
+    std::string image;
+    std::string location;
+    uint64_t start;
+    uint64_t duration;
+};
+
+/**
+ * Events recorded by one thread
+ */
+struct trace_buffer {
+    int tid;
+    std::string name;
+    bool exited;
+    uint64_t dropped;
+    std::vector<trace_event> events;
+
+    // taken by the owning thread to append and by dump to read
+    std::mutex mutex;
+};
+
+/**
+ * On demand capture of pipeline spans as Chrome trace event JSON
+ *
+ * While tracing, every TraceSpan appends a complete event to a buffer owned
+ * by its thread, so threads never contend with each other. dump writes all
+ * buffers in the trace event format read by chrome://tracing and Perfetto,
+ * one track per thread. When tracing is off a span costs one relaxed atomic
+ * load.
+ */
+class Tracer {
+    public:
+        static Tracer& instance();
+
+        /**
+         * Drop previous events and start recording
+         */
+        void start();
+
+        /**
+         * Stop recording, recorded events are kept until the next start
+         */
+        void stop();
+
+        bool enabled() const {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Name the calling thread's track
+         */
+        void name_thread(const std::string& name);
+
+        /**
+         * Append event to the calling thread's buffer
+         */
+        void record(trace_event&& event);
+
+        /**
+         * Microseconds since the tracer was created
+         */
+        uint64_t now() const;
+
+        /**
+         * Write recorded events as trace event JSON
+         *
+         * @throws L1::CannotOpenFile if path cannot be written
+         */
+        void dump(const std::string& path);
+
+    private:
+        Tracer();
+
+        std::atomic<bool> _enabled;
+        std::chrono::steady_clock::time_point _epoch;
+
+        int _next_tid;
+        std::mutex _mutex;
+        std::list<std::shared_ptr<trace_buffer>> _buffers;
+
+        trace_buffer& local();
+};
+
+/**
+ * Record lifetime of the scope as a span while tracing
+ */
+class TraceSpan {
+    public:
+        /**
+         * @param name span name, must outlive the tracer such as a literal
+         * @param image image the work belongs to
+         * @param location raft/board or file the work belongs to
+         */
+        TraceSpan(const char* name,
+                  const std::string& image = "",
+                  const std::string& location = "");
+        ~TraceSpan();
+
+        /**
+         * End span now, for work that ends before the scope
+         */
+        void stop();
+
+    private:
+        bool _on;
+        const char* _name;
+        std::string _image;
+        std::string _location;
+        uint64_t _start;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * Fixed set of threads running short CPU bound tasks
+ *
+ * Used to split work on one image, like decluttering the pixels of a ccd,
+ * across cores. The caller of `run` works on the queue too until its own
+ * tasks are done, so callers never wait on a pool that is busy with the
+ * tasks of other callers and nested use cannot deadlock.
+ */
+class WorkerPool {
+    public:
+        /**
+         * Construct WorkerPool and start its threads
+         *
+         * @param name Name of the pool used in log statements and traces
+         * @param threads Number of worker threads, 0 runs every task on
+         *      the caller
+         */
+        WorkerPool(const std::string& name, const int threads);
+
+        /**
+         * Stop and join worker threads
+         */
+        ~WorkerPool();
+
+        /**
+         * Run tasks and wait until all of them finished
+         *
+         * @param tasks Functions to run, in any order and concurrently
+         * @throws first exception thrown by any of the tasks, after all
+         *      tasks finished
+         */
+        void run(std::vector<std::function<void ()>>& tasks);
+
+        /**
+         * Number of worker threads
+         */
+        int size();
+
+    private:
+        struct batch;
+
+        struct job {
+            std::function<void ()>* task;
+            batch* owner;
+        };
+
+        std::string _name;
+        bool _stop;
+
+        std::deque<job> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _done;
+        std::vector<std::thread> _workers;
+
+        // caller holds the lock, runs job without it
+        void execute(std::unique_lock<std::mutex>& lk, job& j);
+        void work();
+};
+
+#endif
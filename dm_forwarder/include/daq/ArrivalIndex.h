@@ -0,0 +1,103 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARRIVALINDEX_H
+#define ARRIVALINDEX_H
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <condition_variable>
+
+/**
+ * Bounded table of images seen on the DAQ stream
+ *
+ * The Notification listener records every image it reads off the stream,
+ * keyed by folder and name, so that END_READOUT for any of them is a lookup
+ * instead of a scan of the stream. Oldest entries are evicted once the table
+ * holds `capacity` images.
+ */
+class ArrivalIndex {
+    public:
+        enum class STATE {
+            ARRIVED,
+            COMPLETE,
+            FAILED
+        };
+
+        /**
+         * Construct ArrivalIndex
+         *
+         * @param capacity Maximum number of images remembered
+         */
+        ArrivalIndex(const size_t capacity);
+
+        /**
+         * Image metadata showed up on the stream, pixels are still arriving
+         */
+        void arrived(const std::string& image_id, const std::string& folder);
+
+        /**
+         * Barrier released for image, all pixels are in the DAQ
+         */
+        void complete(const std::string& image_id, const std::string& folder);
+
+        /**
+         * Barrier timed out for image
+         */
+        void failed(const std::string& image_id, const std::string& folder);
+
+        /**
+         * Check if image is complete without waiting
+         */
+        bool ready(const std::string& image_id, const std::string& folder);
+
+        /**
+         * Wait until image is complete
+         *
+         * @param timeout how long to wait for an image that is missing or
+         *      still arriving
+         * @return true if image completed, false if it failed or did not
+         *      complete within timeout
+         */
+        bool wait(const std::string& image_id,
+                  const std::string& folder,
+                  const std::chrono::microseconds timeout);
+
+        size_t size();
+
+    private:
+        size_t _capacity;
+        std::unordered_map<std::string, STATE> _images;
+        std::deque<std::string> _order;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+
+        void set(const std::string& key, const STATE state);
+        static std::string key(const std::string& image_id,
+                               const std::string& folder);
+};
+
+#endif
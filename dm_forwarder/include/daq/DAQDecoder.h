@@ -32,20 +32,33 @@
 #include <ims/guiding/Source.hh>
 #include <ims/wavefront/Source.hh>
 #include "daq/Data.h"
+#include "daq/PixelPool.h"
 
 class DAQDecoder : public IMS::Decoder {
   public:
-    DAQDecoder(IMS::Image& image, const DAQ::LocationSet& filter);
+    /**
+     * @param pool decode buffers are taken from, nullptr for the heap
+     */
+    DAQDecoder(IMS::Image& image,
+               const DAQ::LocationSet& filter,
+               PixelPool* pool = nullptr);
     void process(IMS::Science::Source&, uint64_t length, uint64_t offset);
     void process(IMS::Wavefront::Source&, uint64_t length, uint64_t offset);
     void process(IMS::Guiding::Source&, uint64_t length, uint64_t offset);
     uint64_t samples();
+
+    /**
+     * Bytes of source data read from the DAQ
+     */
+    uint64_t bytes();
     std::vector<Data> data();
     bool valid();
 
   private:
     std::vector<Data> _data;
     uint64_t _samples;
+    uint64_t _bytes;
+    PixelPool* _pool;
 };
 
 #endif
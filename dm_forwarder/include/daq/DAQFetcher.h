@@ -24,34 +24,89 @@
 #ifndef DAQFETCHER_H
 #define DAQFETCHER_H
 
+#include <memory>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include <ims/Store.hh>
+#include <daq/Sensor.hh>
 #include <daq/Data.h>
 #include <daq/Pixel3d.h>
+#include <daq/PixelPool.h>
+#include <core/WorkerPool.h>
 #include <forwarder/Formatter.h>
 
 class DAQFetcher {
     public:
+        /**
+         * @param pool workers to split declutter across, nullptr to
+         *      declutter on the calling thread
+         * @param pixels pool of decode and pixel buffers, nullptr to
+         *      allocate them for every image
+         */
         DAQFetcher(const std::string& partition,
                    const std::string& folder,
                    const std::vector<int>& data_segment,
-                   redis_connection_params params,
-                   const int xor_pattern);
-        void fetch(const boost::filesystem::path& prefix,
+                   const int xor_pattern,
+                   WorkerPool* pool = nullptr,
+                   PixelPool* pixels = nullptr);
+
+        /**
+         * Construct DAQFetcher that only processes pixels decoded elsewhere,
+         * without opening a DAQ store
+         */
+        DAQFetcher(const std::vector<int>& data_segment,
+                   const int xor_pattern,
+                   WorkerPool* pool = nullptr,
+                   PixelPool* pixels = nullptr);
+
+        /**
+         * Fetch pixels of location and write them as fitsfiles
+         *
+         * @return paths of the written fitsfiles
+         */
+        std::vector<std::string> fetch(const boost::filesystem::path& prefix,
                    const std::string& image,
                    const std::string& location);
-        Pixel3d declutter(std::vector<Data>& data,
-                          uint64_t samples,
-                          DAQ::Sensor::Type sensor);
+
+        /**
+         * Read pixels of location from the DAQ
+         *
+         * @param samples set to the number of samples per segment
+         * @throws L1::CannotFetchPixel if the DAQ has no data for location
+         */
+        std::vector<Data> decode(const std::string& image,
+                                 const std::string& location,
+                                 uint64_t& samples);
+
+        /**
+         * Declutter decoded pixels of location and write them as fitsfiles
+         *
+         * @return paths of the written fitsfiles
+         * @throws L1::CannotFetchPixel if fitsfiles cannot be written
+         */
+        std::vector<std::string> process(
+                const boost::filesystem::path& prefix,
+                const std::string& image,
+                const std::string& location,
+                std::vector<Data>& data,
+                const uint64_t samples);
+
+        /**
+         * Reorder pixels into ccd, segment, sample for each ccd of the data
+         */
+        Pixel3d declutter(std::vector<Data>& data, uint64_t samples);
         std::vector<long> naxes(Data& data, uint64_t samples);
 
     private:
-        IMS::Store _store;
+        std::unique_ptr<IMS::Store> _store;
         std::string _folder;
         int _xor;
+        WorkerPool* _pool;
+        PixelPool* _pixels;
         Formatter _fmt;
         boost::filesystem::path _prefix;
+
+        DAQ::Sensor::Type sensor_type(const std::string& location);
 };
 
 #endif
@@ -39,10 +39,21 @@ class Data {
 
         int32_t pixel(uint64_t index, int sensor, int segment);
 
+        /**
+         * Stripes of sensor as consecutive pixels, DECLUTTER_SEGMENTS per
+         * sample
+         */
+        const int32_t* stripes(int sensor);
+
         std::vector<long> naxes();
 
         int64_t samples();
 
+        /**
+         * Number of ccds the data holds pixels of
+         */
+        int ccds();
+
 
     private:
         IMS::SourceMetadata _meta;
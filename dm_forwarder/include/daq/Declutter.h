@@ -0,0 +1,113 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECLUTTER_H
+#define DECLUTTER_H
+
+#include <vector>
+#include <cstdint>
+
+class WorkerPool;
+
+// pixels per DAQ stripe, one per segment as DAQ::Sensor::Segment::NUMOF
+#define DECLUTTER_SEGMENTS 16
+
+// stripes transposed at a time by the sensor kernels
+#define DECLUTTER_TILE 8
+
+// fewest samples of every ccd handed to one pool task, boards with less than
+// twice as many are decluttered serially
+#define DECLUTTER_TASK_SAMPLES 65536
+
+/**
+ * Reorder one chunk of DAQ stripes into rows of segment pixels
+ *
+ * Kept apart from the DAQ types so that the kernel can be benchmarked
+ * without the DAQ SDK.
+ *
+ * @param pix destination indexed as pix[ccd][segment][sample]
+ * @param stripes per ccd, samples stripes of DECLUTTER_SEGMENTS pixels each
+ *      in the layout of IMS::Stripe
+ * @param ccds number of ccds in stripes
+ * @param samples number of stripes per ccd
+ * @param offset first sample of the chunk in pix
+ * @param xor_pattern xored into every pixel
+ */
+void declutter_stripes(int32_t*** pix,
+                       const int32_t* const* stripes,
+                       const int ccds,
+                       const int64_t samples,
+                       const uint64_t offset,
+                       const int32_t xor_pattern);
+
+/**
+ * declutter_stripes with the number of ccds fixed at compile time
+ */
+typedef void (*declutter_kernel)(int32_t*** pix,
+                                 const int32_t* const* stripes,
+                                 const int64_t samples,
+                                 const uint64_t offset,
+                                 const int32_t xor_pattern);
+
+/**
+ * Kernel specialized for the ccds of a sensor type, which equals the value
+ * of DAQ::Sensor::Type. Ccds, segments and the tile of stripes are constant
+ * so the transpose unrolls and vectorizes. Chosen once per location rather
+ * than per chunk.
+ *
+ * @return kernel, nullptr if no sensor type has ccds
+ */
+declutter_kernel declutter_for(const int ccds);
+
+/**
+ * Stripes of one chunk as handed over by the DAQ
+ *
+ * @param stripes first stripe of every ccd
+ * @param samples number of stripes per ccd
+ */
+struct stripe_chunk {
+    std::vector<const int32_t*> stripes;
+    int64_t samples;
+};
+
+/**
+ * Declutter all chunks of a board, splitting its samples across a pool
+ *
+ * Every task covers one block of samples of all ccds, so tasks write
+ * disjoint parts of pix. Blocks are whole tiles and no smaller than
+ * DECLUTTER_TASK_SAMPLES, so small frames such as guider stamps run on the
+ * caller alone.
+ *
+ * @param pix destination indexed as pix[ccd][segment][sample]
+ * @param chunks in order of their samples
+ * @param ccds number of ccds in every chunk
+ * @param xor_pattern xored into every pixel
+ * @param pool workers, nullptr to declutter on the caller
+ */
+void declutter_chunks(int32_t*** pix,
+                      const std::vector<stripe_chunk>& chunks,
+                      const int ccds,
+                      const int32_t xor_pattern,
+                      WorkerPool* pool);
+
+#endif
@@ -29,10 +29,14 @@
 #include <ims/guiding/Source.hh>
 #include <ims/Stripe.hh>
 #include "daq/Data.h"
+#include "daq/PixelPool.h"
 
 class GuidingBuffer {
   public:
-    GuidingBuffer(int64_t samples);
+    /**
+     * @param pool buffers are taken from, nullptr for the heap
+     */
+    GuidingBuffer(int64_t samples, PixelPool* pool = nullptr);
     ~GuidingBuffer();
     Data process(IMS::Guiding::Source& source);
 
@@ -42,6 +46,7 @@ class GuidingBuffer {
     IMS::Stripe* _ccds;
     IMS::Stripe* _ccd[2];
     int64_t _samples;
+    PixelPool* _pool;
 };
 
 #endif
@@ -24,24 +24,72 @@
 #ifndef NOTIFICATION_H
 #define NOTIFICATION_H
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <functional>
 #include <ims/Stream.hh>
 #include <ims/Store.hh>
+#include <daq/ArrivalIndex.h>
 #include <forwarder/Info.h>
 
 class Notification {
     public:
-        Notification(const std::string partition, int barrier_timeout);
+        /**
+         * Construct Notification
+         *
+         * @param partition DAQ partition to read the stream of
+         * @param barrier_timeout microseconds to wait for an image
+         * @param index_size number of images remembered by the listener
+         */
+        Notification(const std::string partition,
+                     int barrier_timeout,
+                     const size_t index_size);
+        ~Notification();
         void start();
+
+        /**
+         * Wait until the listener has seen image complete
+         *
+         * Images are looked up in the arrival index, so readouts that arrive
+         * out of order or back to back do not have to be read off the stream
+         * in END_READOUT order. Returns right away outside of live mode.
+         */
         void block(Info::MODE mode,
                    const std::string image_id,
                    const std::string folder);
-        
+
+        /**
+         * Start the listener thread that drains the stream into the arrival
+         * index
+         *
+         * @param on_image called from the listener thread with image name
+         *      and folder once the barrier for that image is released, may
+         *      be empty
+         */
+        void listen(std::function<void (const std::string&,
+                                        const std::string&)> on_image);
+
+        /**
+         * Check if listener has seen image complete
+         */
+        bool ready(const std::string image_id, const std::string folder);
 
     private:
         std::unique_ptr<IMS::Store> _store;
         std::unique_ptr<IMS::Stream> _stream;
         int _barrier_timeout;
+
+        // listener state
+        std::thread _listener;
+        std::atomic<bool> _listening;
+        std::atomic<bool> _restart;
+        std::atomic<bool> _stop;
+        std::function<void (const std::string&,
+                            const std::string&)> _on_image;
+        ArrivalIndex _index;
+
+        void run();
 };
 
 #endif
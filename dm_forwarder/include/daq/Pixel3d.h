@@ -26,9 +26,25 @@
 
 #include <cstdint>
 
+class PixelPool;
+
+/**
+ * Pixels indexed as [d1][d2][d3], all planes in one contiguous buffer
+ */
 class Pixel3d {
     public:
         Pixel3d(uint64_t d1, uint64_t d2, uint64_t d3);
+
+        /**
+         * Pixel3d backed by a buffer of pool, handed back when destroyed
+         *
+         * @param pool nullptr to allocate from the heap
+         */
+        Pixel3d(uint64_t d1, uint64_t d2, uint64_t d3, PixelPool* pool);
+
+        Pixel3d(Pixel3d&& other);
+        Pixel3d(const Pixel3d&) = delete;
+        Pixel3d& operator=(const Pixel3d&) = delete;
         ~Pixel3d();
 
         int32_t*** get();
@@ -38,7 +54,11 @@ class Pixel3d {
 
     private:
         int32_t*** _arr;
+        int32_t* _data;
+        PixelPool* _pool;
         uint64_t _d1, _d2, _d3;
+
+        uint64_t bytes();
 };
 
 #endif
@@ -0,0 +1,139 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIXELPOOL_H
+#define PIXELPOOL_H
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * Pages backing pooled buffers
+ *
+ * NORMAL uses base pages, TRANSPARENT asks for transparent huge pages with
+ * madvise(MADV_HUGEPAGE), HUGETLB maps pages reserved in hugetlbfs and falls
+ * back to TRANSPARENT if none are available.
+ */
+enum class PixelPages {
+    NORMAL,
+    TRANSPARENT,
+    HUGETLB
+};
+
+/**
+ * Recycles pixel and decode buffers across images
+ *
+ * A fresh buffer of a few hundred MB costs a page fault per page the first
+ * time every exposure touches it. Buffers handed back are kept and given to
+ * the next request of the same size, which repeats every image of a sensor
+ * type, so they are faulted in once for the life of the process. Buffers are
+ * prefaulted by the thread that first asks for them so their pages come
+ * from that thread's NUMA node, and they are only reused on the node they
+ * were made on.
+ *
+ * Resident bytes, buffers in use included, are capped. Idle buffers of
+ * other sizes are unmapped to make room, a request that still does not fit
+ * gets a buffer that is unmapped when released instead of kept.
+ *
+ * Exports counter pixel_pool_total{stage="hit"|"miss"} and gauge
+ * pixel_pool_bytes{stage="resident"}.
+ */
+class PixelPool {
+    public:
+        /**
+         * @param cap Most bytes of buffers to keep mapped
+         * @param pages Pages backing buffers
+         */
+        PixelPool(const uint64_t cap, const PixelPages pages);
+
+        /**
+         * Unmap idle buffers, buffers still in use are leaked
+         */
+        ~PixelPool();
+
+        /**
+         * Prefaulted buffer of at least bytes, contents are undefined
+         *
+         * @throws std::bad_alloc if memory cannot be mapped
+         */
+        void* acquire(const uint64_t bytes);
+
+        /**
+         * Hand back buffer returned by acquire for bytes
+         */
+        void release(void* buffer, const uint64_t bytes);
+
+        /**
+         * Bytes of buffers mapped, idle or in use
+         */
+        uint64_t resident();
+
+        /**
+         * Parse PixelPages from "normal", "transparent" or "hugetlb"
+         *
+         * @throws L1::YamlKeyError if name is none of them
+         */
+        static PixelPages pages(const std::string& name);
+
+    private:
+        struct block {
+            void* addr;
+            uint64_t length;
+            // NUMA node the pages were faulted on
+            int node;
+        };
+
+        // requested bytes and NUMA node
+        typedef std::tuple<uint64_t, int> key;
+
+        uint64_t _cap;
+        PixelPages _pages;
+        uint64_t _resident;
+        std::map<key, std::vector<block>> _idle;
+        std::map<void*, block> _used;
+        std::mutex _mutex;
+
+        block map(const uint64_t bytes);
+        void unmap(const block& b);
+
+        // caller holds the lock
+        void evict(const uint64_t bytes);
+
+        static int node();
+};
+
+/**
+ * Buffer of bytes from pool, or from the heap if pool is nullptr
+ */
+void* pixel_alloc(PixelPool* pool, const uint64_t bytes);
+
+/**
+ * Free buffer of bytes returned by pixel_alloc with the same pool
+ */
+void pixel_free(PixelPool* pool, void* buffer, const uint64_t bytes);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCANINDEX_H
+#define SCANINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * What a scan learned about one DAQ catalog entry
+ *
+ * @param seconds image timestamp in seconds since the epoch, rounded up
+ * @param name image name, empty if its metadata is corrupted
+ */
+struct scan_entry {
+    int64_t seconds;
+    std::string name;
+};
+
+/**
+ * Catalog entries already scanned, kept on local disk across restarts
+ *
+ * Reading the name and timestamp of an image means instantiating an
+ * IMS::Image, which is what makes a scan of a large folder slow. The index
+ * remembers both for every IMS::Id it has seen, so repeated scans only
+ * instantiate new entries. The high-water mark is the largest IMS::Id seen,
+ * anything above it is new without a lookup.
+ *
+ * The file holds one `high_water <id>` line followed by one
+ * `<id> <seconds> <name>` line per entry, `-` standing in for a corrupted
+ * name. It is rewritten whole on `save`. Not thread safe.
+ */
+class ScanIndex {
+    public:
+        /**
+         * Construct ScanIndex, loading path if it exists
+         *
+         * A file that cannot be read is logged and ignored, the next scan
+         * rebuilds it.
+         *
+         * @param path index file, memory only if empty
+         */
+        ScanIndex(const std::string& path = "");
+
+        /**
+         * Look up entry of id
+         *
+         * @return true if id was scanned before
+         */
+        bool find(const uint64_t id, scan_entry& entry) const;
+
+        void put(const uint64_t id, const scan_entry& entry);
+
+        /**
+         * Forget entries not in ids, e.g. images removed from the catalog
+         *
+         * @param ids every IMS::Id of a complete traversal
+         * @return number of entries forgotten
+         */
+        size_t retain(const std::vector<uint64_t>& ids);
+
+        /**
+         * Largest IMS::Id ever put, 0 if none
+         */
+        uint64_t high_water() const;
+
+        size_t size() const;
+
+        /**
+         * Write index to its file, nothing if memory only
+         *
+         * @throws L1::CannotOpenFile if the file cannot be written
+         */
+        void save();
+
+    private:
+        std::string _path;
+        uint64_t _high_water;
+        std::map<uint64_t, scan_entry> _entries;
+
+        void load();
+};
+
+#endif
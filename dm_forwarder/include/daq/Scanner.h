@@ -24,34 +24,78 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 
+#include <ctime>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <ims/Image.hh>
 #include <ims/Store.hh>
 #include <ims/Catalog.hh>
 #include <ims/Processor.hh>
 #include <osa/TimeStamp.hh>
+#include <daq/ScanIndex.h>
+
+class WorkerPool;
 
 /**
+ * Find images of a DAQ folder newer than a number of minutes
+ *
+ * Traversal only collects IMS::Ids, `get_images` then instantiates the
+ * IMS::Image of ids the ScanIndex has not seen, split in ranges across a
+ * WorkerPool, and answers from the index. Repeated scans cost a lookup per
+ * known id instead of an IMS::Image. Scan duration is recorded as the "scan"
+ * stage latency, along with counters of ids seen and instantiated.
+ *
  * Corrupted metadata images can have wrong timestamps and the behavior is
  * undefined for processing those images - meaning there is no guarantee
  * catchuparchiver will catchup those images or not.
  */
 class Scanner : public IMS::Processor {
     public:
-        Scanner(const std::string partition, const int minutes);
+        /**
+         * @param partition DAQ partition
+         * @param minutes images newer than this many minutes are returned
+         * @param index entries scanned before, a fresh one in memory if not
+         *      given
+         * @param pool threads to instantiate new images on, the caller
+         *      alone if not given
+         * @throws L1::ScannerError if minutes is negative
+         */
+        Scanner(const std::string partition,
+                const int minutes,
+                ScanIndex* index = nullptr,
+                WorkerPool* pool = nullptr);
         void process(const IMS::Id& id);
+
+        /**
+         * Images of the traversed folder newer than minutes, oldest first
+         *
+         * @throws L1::ScannerError if an IMS::Image cannot be instantiated
+         */
         std::vector<std::string> get_images();
 
+        /**
+         * Seconds since the epoch of timestamp, rounded up
+         */
+        static int64_t seconds(const OSA::TimeStamp& timestamp);
+
     private:
-        // DAQ images store
-        IMS::Store _store;
+        std::string _partition;
 
         // images older than this time are catchuped
-        OSA::TimeStamp _timestamp;
+        time_t _since;
+
+        ScanIndex _own_index;
+        ScanIndex* _index;
+        WorkerPool* _pool;
+
+        // every id of the traversal and the ones missing from the index
+        std::vector<uint64_t> _seen;
+        std::vector<uint64_t> _new;
 
-        // list of images to catchup
-        std::vector<std::string> _images;
+        // instantiate IMS::Image of ids
+        void open(const std::vector<uint64_t>& ids);
+        static scan_entry read(IMS::Store& store, const uint64_t id);
 };
 
 #endif
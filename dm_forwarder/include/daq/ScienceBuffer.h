@@ -28,10 +28,14 @@
 #include <ims/science/Source.hh>
 #include <ims/Stripe.hh>
 #include "daq/Data.h"
+#include "daq/PixelPool.h"
 
 class ScienceBuffer {
   public:
-    ScienceBuffer(int64_t samples);
+    /**
+     * @param pool buffers are taken from, nullptr for the heap
+     */
+    ScienceBuffer(int64_t samples, PixelPool* pool = nullptr);
     ~ScienceBuffer();
     Data process(IMS::Science::Source& source);
 
@@ -41,6 +45,7 @@ class ScienceBuffer {
     IMS::Stripe* _ccds;
     IMS::Stripe* _ccd[3];
     int64_t _samples;
+    PixelPool* _pool;
 };
 
 #endif
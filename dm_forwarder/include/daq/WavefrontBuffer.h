@@ -28,10 +28,14 @@
 #include <ims/wavefront/Source.hh>
 #include <ims/Stripe.hh>
 #include "daq/Data.h"
+#include "daq/PixelPool.h"
 
 class WavefrontBuffer {
   public:
-    WavefrontBuffer(int64_t samples);
+    /**
+     * @param pool buffers are taken from, nullptr for the heap
+     */
+    WavefrontBuffer(int64_t samples, PixelPool* pool = nullptr);
     ~WavefrontBuffer();
     Data process(IMS::Wavefront::Source& source);
 
@@ -41,6 +45,7 @@ class WavefrontBuffer {
     IMS::Stripe* _ccds;
     IMS::Stripe* _ccd[1];
     int64_t _samples;
+    PixelPool* _pool;
 };
 
 #endif
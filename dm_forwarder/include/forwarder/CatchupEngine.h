@@ -0,0 +1,130 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CATCHUPENGINE_H
+#define CATCHUPENGINE_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * Work through a backlog of catch-up images, several at a time
+ *
+ * Catch-up images do not go through the single-threaded pipeline stages.
+ * Their fetch, format and transfer jobs run on `concurrency` threads of
+ * their own, oldest image first, so a night of images left in the DAQ after
+ * an outage is archived in parallel while live images keep the pipeline.
+ * Age is the date and sequence number of the Image ID, e.g.
+ * `20201018_000042` of `MC_O_20201018_000042`.
+ *
+ * Every image the engine knows about is pending until `done`. Pending images
+ * are kept in a checkpoint file, one `+<Image ID>` line when added and one
+ * `-<Image ID>` line when done, which is compacted on startup. A restarted
+ * forwarder reads back `pending` to resume where it left off.
+ */
+class CatchupEngine {
+    public:
+        /**
+         * Construct CatchupEngine and start its threads
+         *
+         * @param concurrency Number of images worked on at the same time
+         * @param checkpoint Path of the checkpoint file, created if missing
+         * @throws L1::CannotOpenFile if checkpoint cannot be written
+         */
+        CatchupEngine(const int concurrency, const std::string& checkpoint);
+
+        /**
+         * Finish running jobs and join threads, queued jobs are dropped and
+         * their images stay pending in the checkpoint
+         */
+        ~CatchupEngine();
+
+        /**
+         * Record images as pending, e.g. the result of a DAQ catalog scan
+         *
+         * @param image_ids Image IDs, known ones are ignored
+         */
+        void add(const std::vector<std::string>& image_ids);
+
+        /**
+         * Queue job of image, adds image if it is not pending yet
+         *
+         * @param image_id Image ID the job works on
+         * @param job Function to run on an engine thread
+         */
+        void run(const std::string& image_id, std::function<void ()> job);
+
+        /**
+         * Image is archived or given up on
+         *
+         * @param image_id Image ID
+         */
+        void done(const std::string& image_id);
+
+        /**
+         * Pending Image IDs, oldest first
+         */
+        std::vector<std::string> pending();
+
+        /**
+         * Number of pending images
+         */
+        size_t size();
+
+        /**
+         * Date and sequence number part of Image ID images are ordered by
+         */
+        static std::string age(const std::string& image_id);
+
+    private:
+        std::string _checkpoint;
+        std::ofstream _log;
+        bool _stop;
+
+        // pending images by age, then Image ID
+        std::set<std::pair<std::string, std::string>> _pending;
+
+        // jobs by age of their image, equal ages in order of arrival
+        std::multimap<std::string, std::function<void ()>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::vector<std::thread> _workers;
+
+        // read checkpoint and rewrite it with pending images only
+        void load();
+
+        // caller holds the lock
+        void record(const char op, const std::string& image_id);
+        void report();
+
+        void work();
+};
+
+#endif
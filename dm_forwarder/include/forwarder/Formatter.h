@@ -28,30 +28,33 @@
 #include <fitsio.h>
 #include <boost/filesystem.hpp>
 #include <daq/Pixel3d.h>
-#include <core/RedisConnection.h>
 
 class Formatter {
     public:
-        Formatter(const std::vector<int>& data_segment, redis_connection_params params);
+        Formatter(const std::vector<int>& data_segment);
         std::string write_pix_file(int32_t**,
                                    int32_t&,
                                    long*,
                                    const boost::filesystem::path&);
-        void write(const std::string image,
-                   Pixel3d& ccds,
-                   long* naxes,
-                   const boost::filesystem::path& prefix);
+
+        /**
+         * Write one pixel fitsfile per ccd
+         *
+         * @return paths of the written fitsfiles
+         */
+        std::vector<std::string> write(const std::string image,
+                                       Pixel3d& ccds,
+                                       long* naxes,
+                                       const boost::filesystem::path& prefix);
 
     protected:
-        std::unique_ptr<RedisConnection> _db;
         std::vector<int> _data_segment;
 };
 
 class FitsFormatter : public Formatter {
     public:
         FitsFormatter(const std::vector<std::string>& daq_mapping,
-                      const std::vector<std::string>& hdr_mapping,
-                      redis_connection_params params);
+                      const std::vector<std::string>& hdr_mapping);
         void write_header(const boost::filesystem::path& pix_path,
                           const boost::filesystem::path& header_path);
         bool contains_excluded_key(const char*);
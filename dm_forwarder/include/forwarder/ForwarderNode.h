@@ -0,0 +1,121 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FORWARDERNODE_H
+#define FORWARDERNODE_H
+
+#include <map>
+#include <string>
+#include <functional>
+#include <yaml-cpp/yaml.h>
+
+#include <core/Publisher.h>
+#include <core/AsyncRedis.h>
+#include <core/HeartBeat.h>
+#include <forwarder/MessageBuilder.h>
+
+/**
+ * What a forwarder node tells the archiver about itself
+ *
+ * A standalone miniforwarder and the supervisor of its workers consume the
+ * same messages, ack them under the name of the node and register the node
+ * in the forwarder list of the remote redis.
+ */
+class ForwarderNode {
+    public:
+        typedef std::function<void (const YAML::Node&)> action;
+
+        /**
+         * Handlers of the messages consumed on CONSUME_QUEUE. Health check,
+         * XFER_PARAMS, HEADER_READY and END_READOUT come as AT_FWDR_,
+         * CC_FWDR_ and CATCHUP_FWDR_ messages.
+         */
+        struct handlers {
+            action health_check;
+            action xfer_params;
+            action header_ready;
+            action end_readout;
+            action process_ack;
+            action associated;
+            action scan;
+            action trace;
+        };
+
+        /**
+         * Read CONSUME_QUEUE, REDIS REMOTE and heartbeat timing and resolve
+         * hostname and ip address of the node
+         *
+         * @throws YAML::TypedBadConversion if config is malformed
+         * @throws L1::L1Exception if hostname cannot be resolved
+         */
+        ForwarderNode(const YAML::Node& config);
+
+        /**
+         * `<ip address>:<hostname>`, the component of acks
+         */
+        const std::string& name() const;
+        const std::string& consume_q() const;
+        const std::string& association_key() const;
+
+        /**
+         * Connection to the remote redis the node is registered in
+         */
+        const redis_connection_params& remote() const;
+
+        /**
+         * Heartbeat of the association, which registers the node again
+         * through remote when it expires
+         */
+        heartbeat_params heartbeat(AsyncRedis& remote);
+
+        /**
+         * Add the node to the forwarder list of the archiver
+         */
+        void register_fwd(AsyncRedis& remote);
+
+        /**
+         * Ack message n on its REPLY_QUEUE, False if not ok. Errors are
+         * logged.
+         */
+        void publish_ack(Publisher& pub,
+                         const YAML::Node& n,
+                         const bool ok = true);
+
+        /**
+         * Table of message types to handlers of h
+         */
+        static std::map<const std::string, action> actions(const handlers& h);
+
+    private:
+        std::string _name;
+        std::string _ip_addr;
+        std::string _hostname;
+        std::string _consume_q;
+        std::string _association_key;
+        std::string _forwarder_list;
+        heartbeat_params _hb_params;
+
+        MessageBuilder _builder;
+};
+
+#endif
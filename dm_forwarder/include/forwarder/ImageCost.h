@@ -0,0 +1,148 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGECOST_H
+#define IMAGECOST_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/**
+ * Resources spent on one image
+ *
+ * @param cpu_us thread CPU time of all tasks working on the image
+ * @param peak_pixel_bytes most pixel buffer bytes held at the same time
+ * @param daq_bytes bytes read from the DAQ
+ * @param written_bytes bytes of fitsfiles and header written to WORK_DIR
+ * @param sent_bytes bytes handed to the file transfer
+ */
+struct image_cost {
+    uint64_t cpu_us;
+    uint64_t peak_pixel_bytes;
+    uint64_t daq_bytes;
+    uint64_t written_bytes;
+    uint64_t sent_bytes;
+};
+
+/**
+ * Process wide accounting of what each image costs
+ *
+ * Tasks of an image run on pipeline stages and std::async threads, each of
+ * them adds what it used under the Image ID. The totals are attached to the
+ * final IMAGE_RETRIEVAL_FOR_ARCHIVING telemetry and dropped once the image
+ * is done.
+ */
+class ImageCost {
+    public:
+        static ImageCost& instance();
+
+        void add_cpu(const std::string& image_id, const uint64_t us);
+        void add_daq(const std::string& image_id, const uint64_t bytes);
+        void add_written(const std::string& image_id, const uint64_t bytes);
+        void add_sent(const std::string& image_id, const uint64_t bytes);
+
+        /**
+         * Pixel buffer of bytes is allocated for image
+         */
+        void alloc_pixels(const std::string& image_id, const uint64_t bytes);
+
+        /**
+         * Pixel buffer of bytes allocated for image is freed
+         */
+        void free_pixels(const std::string& image_id, const uint64_t bytes);
+
+        /**
+         * Cost of image so far, zero if nothing was recorded
+         */
+        image_cost get(const std::string& image_id);
+
+        /**
+         * Forget image
+         */
+        void remove(const std::string& image_id);
+
+        /**
+         * Forget images first seen longer than age ago, for images that
+         * never completed
+         */
+        void expire(const std::chrono::seconds age);
+
+        /**
+         * Thread CPU time of the calling thread in microseconds
+         */
+        static uint64_t thread_cpu();
+
+    private:
+        struct entry {
+            image_cost cost;
+            uint64_t pixel_bytes;
+            std::chrono::steady_clock::time_point created;
+        };
+
+        std::mutex _mutex;
+        std::map<std::string, entry> _images;
+
+        ImageCost() = default;
+        entry& at(const std::string& image_id);
+};
+
+/**
+ * Account a pixel buffer to an image for the life of the scope
+ */
+class PixelCharge {
+    public:
+        PixelCharge(const std::string& image_id, const uint64_t bytes);
+        ~PixelCharge();
+
+    private:
+        std::string _image_id;
+        uint64_t _bytes;
+};
+
+/**
+ * Add thread CPU time spent in the scope to an image
+ */
+class CpuTimer {
+    public:
+        CpuTimer(const std::string& image_id);
+
+        /**
+         * Add CPU time unless stop was called
+         */
+        ~CpuTimer();
+
+        /**
+         * Add CPU time now, for work that ends before the scope
+         */
+        void stop();
+
+    private:
+        std::string _image_id;
+        uint64_t _start;
+        bool _stopped;
+};
+
+#endif
@@ -35,6 +35,7 @@ class Info {
         };
 
         static MODE encode(std::string);
+        static std::string decode(const MODE mode);
 };
 
 #endif
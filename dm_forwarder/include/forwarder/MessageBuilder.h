@@ -24,6 +24,9 @@
 #ifndef MESSAGEBUILDER_H
 #define MESSAGEBUILDER_H
 
+#include <string>
+#include <forwarder/ImageCost.h>
+
 class MessageBuilder {
     public:
         std::string build_ack(const std::string& msg_type,
@@ -51,6 +54,19 @@ class MessageBuilder {
                 const std::string& ccd,
                 const std::string& filename,
                 const std::string& desc);
+
+        /**
+         * IMAGE_RETRIEVAL_FOR_ARCHIVING carrying the resources the image
+         * cost, for the last message of an image
+         */
+        std::string build_image_retrieval_for_archiving(
+                const int& code,
+                const std::string& obsid,
+                const std::string& raft,
+                const std::string& ccd,
+                const std::string& filename,
+                const std::string& desc,
+                const image_cost& cost);
 };
 
 #endif
@@ -0,0 +1,148 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * Single worker stage of the image pipeline
+ *
+ * Stage runs queued jobs on its own thread, earliest deadline first and in
+ * order of arrival among equal deadlines. Jobs without a deadline run after
+ * every job that has one, so live images overtake queued catch-up images
+ * whenever the worker picks its next job.
+ *
+ * `push` blocks the caller while `capacity` jobs due no later than the new
+ * one are queued, so a slow stage applies backpressure to the stages feeding
+ * it, while jobs of later deadlines cannot hold back earlier ones.
+ */
+class Stage {
+    public:
+        /**
+         * Construct Stage and start its worker thread
+         *
+         * @param name Name of the stage used in log statements
+         * @param capacity Maximum number of queued jobs
+         */
+        Stage(const std::string& name, const int capacity);
+
+        /**
+         * Drain remaining jobs and join worker thread
+         */
+        ~Stage();
+
+        /**
+         * Queue job for the worker, blocks while the stage is full
+         *
+         * @param job Function to run on the stage thread
+         * @param deadline when job is due, none if not given
+         */
+        void push(std::function<void ()> job,
+                  const std::chrono::steady_clock::time_point deadline =
+                      std::chrono::steady_clock::time_point::max());
+
+        /**
+         * Number of jobs waiting to run
+         */
+        size_t size();
+
+        /**
+         * Stop accepting jobs and wake up the worker
+         */
+        void stop();
+
+        /**
+         * Stop the stage and wait until queued jobs are drained
+         */
+        void join();
+
+    private:
+        std::string _name;
+        size_t _capacity;
+        bool _stop;
+
+        // equal deadlines keep their order of insertion
+        std::multimap<std::chrono::steady_clock::time_point,
+            std::function<void ()>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _not_full;
+        std::thread _worker;
+
+        // jobs due no later than deadline, caller holds the lock
+        size_t ahead(const std::chrono::steady_clock::time_point deadline);
+
+        void run();
+};
+
+/**
+ * Image level pipeline
+ *
+ * DAQ fetch, format and transfer of an image run on separate stages so that
+ * pixels of image N+1 can be read from the DAQ while image N is still being
+ * formatted or sent. Sustained cadence is bound by the slowest stage instead
+ * of the sum of all of them.
+ *
+ * Every job of an image is pushed with the image's deadline, none for
+ * catch-up images.
+ */
+class Pipeline {
+    public:
+        /**
+         * Construct Pipeline
+         *
+         * @param images_in_flight Number of images each stage can hold
+         */
+        Pipeline(const int images_in_flight);
+
+        /**
+         * Drain stages in pipeline order so that jobs handed downstream
+         * while shutting down are not dropped
+         */
+        ~Pipeline();
+
+        void fetch(std::function<void ()> job,
+                   const std::chrono::steady_clock::time_point deadline =
+                       std::chrono::steady_clock::time_point::max());
+        void format(std::function<void ()> job,
+                    const std::chrono::steady_clock::time_point deadline =
+                        std::chrono::steady_clock::time_point::max());
+        void transfer(std::function<void ()> job,
+                      const std::chrono::steady_clock::time_point deadline =
+                          std::chrono::steady_clock::time_point::max());
+
+    private:
+        Stage _fetch;
+        Stage _format;
+        Stage _transfer;
+};
+
+#endif
@@ -24,21 +24,75 @@
 #ifndef READOUT_PATTERN_H
 #define READOUT_PATTERN_H
 
+#include <string>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 #include <daq/Sensor.hh>
 
+/**
+ * Readout pattern of every sensor type compiled from the PATTERN config
+ *
+ * The pattern is read and validated once when constructed, lookups return
+ * the compiled values without touching YAML. A sensor type whose pattern is
+ * missing or invalid only throws InvalidReadoutPattern when it is looked up,
+ * so a partition that never reads it out still starts.
+ */
 class ReadoutPattern {
     public:
         ReadoutPattern(const YAML::Node& n);
-        std::vector<std::string> data_segment_name(DAQ::Sensor::Type& sensor);
-        std::vector<int> data_segment(DAQ::Sensor::Type& sensor);
-        std::vector<int> sensor_order(DAQ::Sensor::Type& sensor);
-        int get_xor(DAQ::Sensor::Type& sensor);
 
+        /**
+         * @throws L1::InvalidReadoutPattern if pattern of sensor is invalid
+         */
+        const std::vector<std::string>& data_segment_name(
+                const DAQ::Sensor::Type sensor) const;
+        const std::vector<int>& data_segment(
+                const DAQ::Sensor::Type sensor) const;
+        const std::vector<int>& sensor_order(
+                const DAQ::Sensor::Type sensor) const;
+        int get_xor(const DAQ::Sensor::Type sensor) const;
+
+        /**
+         * Sensor type of DAQ location, probed once per location and cached
+         *
+         * @throws L1::InvalidLocation if location is not a sensor
+         */
         static DAQ::Sensor::Type sensor(const std::string& location);
 
     private:
-        YAML::Node _root;
+        template <typename T>
+        struct compiled {
+            T value;
+            // empty if value is valid
+            std::string error;
+        };
+
+        struct sensor_pattern {
+            compiled<std::vector<std::string>> data_segment_name;
+            compiled<std::vector<int>> data_segment;
+            compiled<std::vector<int>> sensor_order;
+            compiled<int> xor_pattern;
+        };
+
+        // indexed by DAQ::Sensor::Type, which is WAVEFRONT=1 to SCIENCE=3
+        sensor_pattern _table[DAQ::Sensor::Type::SCIENCE + 1];
+
+        const sensor_pattern& at(const DAQ::Sensor::Type sensor) const;
+
+        template <typename T, typename F>
+        static void compile(compiled<T>& c, F read);
+
+        template <typename T>
+        static const T& get(const compiled<T>& c);
+
+        static std::vector<std::string> read_data_segment_name(
+                const YAML::Node& root, const std::string& sensor_name);
+        static std::vector<int> read_data_segment(
+                const YAML::Node& root, const std::string& sensor_name);
+        static std::vector<int> read_sensor_order(
+                const YAML::Node& root, const std::string& sensor_name);
+        static int read_xor(
+                const YAML::Node& root, const std::string& sensor_name);
 };
 
 #endif
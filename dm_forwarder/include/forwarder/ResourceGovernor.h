@@ -0,0 +1,127 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOURCEGOVERNOR_H
+#define RESOURCEGOVERNOR_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <condition_variable>
+#include <forwarder/Info.h>
+
+/**
+ * Admission control of images by memory and spool budget
+ *
+ * Every image reserves the pixel buffer bytes it needs while its pixels are
+ * fetched and the WORK_DIR bytes its fitsfiles take until they are cleaned
+ * up. A fetch is admitted only when its reservation fits in what is left of
+ * both budgets, otherwise it waits. Live images are admitted before
+ * catch-up images and in arrival order within each mode, so a catch-up
+ * backlog cannot starve the images being taken now. An image larger than
+ * a whole budget is admitted once nothing else is in flight.
+ *
+ * Time spent waiting is recorded as stage "admission" latency, reserved
+ * bytes are exported as gauge governor_bytes{stage="memory"|"spool"}.
+ */
+class ResourceGovernor {
+    public:
+        /**
+         * @param memory Most pixel buffer bytes in flight, 0 for no limit
+         * @param spool Most WORK_DIR bytes in flight, 0 for no limit
+         */
+        ResourceGovernor(const uint64_t memory, const uint64_t spool);
+
+        /**
+         * Wait until image fits in both budgets and reserve it
+         *
+         * Admitting an image that holds a reservation adds to it.
+         *
+         * @param mode LIVE images are admitted before CATCHUP images
+         * @return microseconds spent waiting
+         */
+        uint64_t admit(const std::string& image_id,
+                       const uint64_t memory,
+                       const uint64_t spool,
+                       const Info::MODE mode);
+
+        /**
+         * Pixel buffers of image are freed
+         */
+        void release_memory(const std::string& image_id);
+
+        /**
+         * Replace the spool reservation of image with bytes it actually
+         * wrote
+         */
+        void set_spool(const std::string& image_id, const uint64_t bytes);
+
+        /**
+         * Image is done and its files are removed
+         */
+        void release(const std::string& image_id);
+
+        /**
+         * Release images admitted longer than age ago, for images that
+         * never completed
+         */
+        void expire(const std::chrono::seconds age);
+
+        /**
+         * Bytes reserved by images in flight
+         */
+        uint64_t memory();
+        uint64_t spool();
+
+    private:
+        struct reservation {
+            uint64_t memory;
+            uint64_t spool;
+            std::chrono::steady_clock::time_point admitted;
+        };
+
+        uint64_t _memory_cap;
+        uint64_t _spool_cap;
+        uint64_t _memory;
+        uint64_t _spool;
+        uint64_t _next_ticket;
+
+        std::map<std::string, reservation> _images;
+
+        // tickets of waiting admissions in arrival order
+        std::deque<uint64_t> _live;
+        std::deque<uint64_t> _catchup;
+
+        std::mutex _mutex;
+        std::condition_variable _released;
+
+        // caller holds the lock
+        bool fits(const uint64_t memory, const uint64_t spool);
+        void erase(std::map<std::string, reservation>::iterator it);
+        void report();
+};
+
+#endif
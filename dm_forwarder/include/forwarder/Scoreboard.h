@@ -24,8 +24,17 @@
 #ifndef SCOREBOARD_H
 #define SCOREBOARD_H
 
+#include <chrono>
 #include <memory>
-#include <core/RedisConnection.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <core/AsyncRedis.h>
+#include <forwarder/Info.h>
+
+// number of independently locked partitions of the in-memory store
+#define SCOREBOARD_STRIPES 16
 
 /**
  * Information used for readout transfer of fits file
@@ -35,60 +44,92 @@
  * @param job_num Current running job
  * @param raft Raft number of the form "00"
  * @param ccds Name of ccds inside the raft to pull
+ * @param mode whether the image is read live or caught up
  */
 struct xfer_info {
     std::string target;
     std::string session_id;
     std::string job_num;
     std::vector<std::string> locations;
+    Info::MODE mode = Info::MODE::LIVE;
+};
+
+/**
+ * Everything the Scoreboard knows about one image
+ *
+ * @param xfer Transfer information from XFER_PARAMS
+ * @param header Path to header file, empty until HEADER_READY
+ * @param ccds Paths to pixel fitsfiles written so far
+ * @param fetched true once the fetch of every location has finished, ccds
+ *      are complete from then on
+ * @param deadline when a live image is due, none until END_READOUT and for
+ *      catch-up images
+ */
+struct readout_info {
+    xfer_info xfer;
+    std::string header;
+    std::vector<std::string> ccds;
+    bool fetched = false;
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
 };
 
 /**
  * Store information relating to readout details
+ *
+ * Scoreboard keeps readout state in memory, partitioned into lock stripes by
+ * Image ID so that the consumer thread, pipeline stages and fetch threads
+ * only contend when they work on images of the same stripe. When constructed
+ * with a redis server, every change is also sent to redis through AsyncRedis,
+ * so that redis reflects the state of the forwarder without being on the
+ * readout path.
+ *
+ * In redis each image is one hash keyed by Image ID, holding target,
+ * session_id, job_num, locations, mode, header and fetched, plus one set
+ * `<Image ID>:ccd` of fitsfiles. Both keys expire after `ttl` seconds so that images which
+ * never complete do not pile up, and Image IDs are tracked in the
+ * `scoreboard:images` set so that state can be restored after a restart
+ * without scanning the keyspace.
  */
 class Scoreboard {
     public:
         /**
-         * Constuct Scoreboard
+         * Construct in-memory Scoreboard without redis
          *
-         * @param host hostname of the redis server
-         * @param port port number of redis server(usually 6379)
-         * @param db_num database number to connect
-         * @param password password to authenticate
+         * @param ttl seconds an image is kept before it is dropped
          */
-        Scoreboard(const std::string& host,
-                   const int& port,
-                   const int& db_num,
-                   const std::string& password);
+        Scoreboard(const int ttl);
 
         /**
-         * Destruct Scoreboard
+         * Constuct Scoreboard with write-behind to redis
+         *
+         * Images left in redis by a previous run are loaded back into memory.
+         *
+         * @param params redis server to mirror to
+         * @param ttl seconds an image is kept before it is dropped
+         */
+        Scoreboard(const redis_connection_params& params, const int ttl);
+
+        /**
+         * Destruct Scoreboard, flushing pending writes to redis
          */
         ~Scoreboard();
 
         /**
          * Check if Image ID is ready to be assembled
          *
+         * An image is ready once its header arrived and all of its
+         * locations were fetched, not when the first ccd shows up.
+         *
          * @param image Image ID
          * @return true if Image ID is ready to be assembled
          */
         bool ready(const std::string& image_id);
 
-        /**
-         * Add Image ID with Event name to keep track
-         *
-         * @param image_id Image ID
-         * @param event custom event called `header_ready` and `end_readout`
-         *      used for tracking if image is ready to be assembled
-         */
-        void add(const std::string& image_id, const std::string& event);
-
         /**
          * Remove Image from storage
          *
          * @param image_id Image ID
-         *
-         * @throws L1::KeyNotFound if Image ID does not exist in storage
          */
         void remove(const std::string& image_id);
 
@@ -101,6 +142,40 @@ class Scoreboard {
         void add_xfer(const std::string&, const xfer_info&);
         void add_header(const std::string& image_id,
                         const std::string& path);
+
+        /**
+         * Record pixel fitsfile written for Image ID
+         *
+         * @param image_id Image ID
+         * @param path path to pixel fitsfile of one ccd
+         */
+        void add_ccd(const std::string& image_id, const std::string& path);
+
+        /**
+         * Record that the fetch of every location of Image ID finished
+         *
+         * @param image_id Image ID
+         */
+        void set_fetched(const std::string& image_id);
+
+        /**
+         * Record when Image ID is due, kept in memory only since steady
+         * clock time points do not survive a restart
+         *
+         * @param image_id Image ID
+         * @param deadline time the image should be transferred by
+         */
+        void set_deadline(const std::string& image_id,
+                          const std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * Get everything known about Image ID in one lookup
+         *
+         * @param image_id Image ID
+         * @return readout info, empty if Image ID is unknown
+         */
+        readout_info get(const std::string& image_id);
+
         std::vector<std::string> locations(const std::string& image_id);
         std::string header(const std::string& image_id);
         std::vector<std::string> ccds(const std::string& image_id);
@@ -110,16 +185,50 @@ class Scoreboard {
          *
          * @param image_id Image ID
          * @return transer info
-         *
-         * @throws L1::KeyNotFound if Image ID does not exist in storage
          */
         xfer_info get_xfer(const std::string&);
 
         void set_fwd(const std::string& key, const std::string& body);
 
+        /**
+         * Drop images older than ttl from every stripe
+         *
+         * Stripes are also swept when a new image is added to them, this
+         * catches stripes that see no new images.
+         */
+        void expire();
+
+        /**
+         * Wait until queued writes are acknowledged by redis
+         */
+        void flush();
+
     private:
-        // RedisConnection
-        std::unique_ptr<RedisConnection> _con;
+        struct image_state {
+            readout_info info;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        struct stripe {
+            std::unordered_map<std::string, image_state> images;
+            std::mutex mutex;
+        };
+
+        std::chrono::seconds _ttl;
+        stripe _stripes[SCOREBOARD_STRIPES];
+        stripe& stripe_of(const std::string& image_id);
+
+        // find or create image, caller holds the stripe lock
+        readout_info& entry(stripe& s, const std::string& image_id);
+
+        // drop expired images, caller holds the stripe lock
+        void sweep(stripe& s, const std::chrono::steady_clock::time_point now);
+
+        // write-behind to redis
+        std::unique_ptr<AsyncRedis> _con;
+
+        void mirror(std::vector<std::vector<std::string>> commands);
+        void restore();
 };
 
 #endif
@@ -0,0 +1,169 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+#include <yaml-cpp/yaml.h>
+
+#include <core/IIPBase.h>
+#include <core/Publisher.h>
+#include <core/MessagePipe.h>
+#include <core/AsyncRedis.h>
+#include <core/Scheduler.h>
+#include <core/Metrics.h>
+#include <core/HeartBeat.h>
+#include <forwarder/MessageBuilder.h>
+#include <forwarder/ForwarderNode.h>
+
+/**
+ * Control process of a forwarder node that handles several location groups
+ *
+ * Each group of WORKERS, e.g. the ccds of one raft, is handled by a worker
+ * process running a miniforwarder of its own, pinned to the cores of CPUS or
+ * of NUMA_NODE. Pixel path state (scoreboard, pipeline, buffer pools, DAQ
+ * stream) stays in the worker. The supervisor consumes from RabbitMQ, acks,
+ * registers the forwarder, keeps the heartbeat and association, and relays
+ * what the workers publish.
+ *
+ * XFER_PARAMS go to the workers of their locations, each with its share of
+ * RAFT_CCD_LIST. HEADER_READY, END_READOUT, ASSOCIATED and TRACE go to every
+ * worker and SCAN to the first one. Workers are started as
+ * `dm_forwarder --worker <index> <fd>` with fd one end of a socket pair, and
+ * restarted when they exit. Workers that exit soon after their start are
+ * restarted with exponential backoff, and left down after
+ * SV_MAX_FAST_EXITS such exits in a row. A health check acks False while a
+ * worker is down.
+ */
+class Supervisor : public IIPBase {
+    public:
+        /**
+         * Read WORKERS and start a worker process per group
+         *
+         * @param pub transport for outgoing messages, RabbitMQ at
+         *      BASE_BROKER_ADDR if not given
+         */
+        Supervisor(const std::string& config,
+                   const std::string& log,
+                   std::shared_ptr<Publisher> pub = nullptr);
+
+        /**
+         * Close the pipes of the workers and wait for them to drain their
+         * images and exit
+         */
+        ~Supervisor();
+
+        void on_message(const std::string&);
+        void run();
+
+        void health_check(const YAML::Node&);
+        void xfer_params(const YAML::Node&);
+        void broadcast(const YAML::Node&);
+        void process_ack(const YAML::Node&);
+        void associated(const YAML::Node&);
+        void scan(const YAML::Node&);
+
+        /**
+         * Number of workers running
+         */
+        size_t alive();
+
+        /**
+         * Cores of a cpulist such as `0-3,8`, as in
+         * /sys/devices/system/node/node0/cpulist
+         *
+         * @return cores in order, empty if list is malformed
+         */
+        static std::vector<int> parse_cpus(const std::string& list);
+
+        /**
+         * Locations of group in locations, in the order of locations
+         */
+        static std::vector<std::string> share(
+                const std::vector<std::string>& locations,
+                const std::vector<std::string>& group);
+
+    private:
+        struct worker {
+            std::vector<std::string> locations;
+            // cores the process is pinned to, none to leave it unpinned
+            std::vector<int> cpus;
+            // 0 while not running
+            pid_t pid;
+            std::chrono::steady_clock::time_point started;
+            // exits soon after start in a row, and when to start it again
+            int failures;
+            std::chrono::steady_clock::time_point retry;
+            std::shared_ptr<MessagePipe> pipe;
+            // publishes what the worker sends until its pipe closes
+            std::thread relay;
+        };
+
+        std::string _amqp_url;
+
+        std::map<const std::string,
+            std::function<void (const YAML::Node&)> > _actions;
+
+        // sized once, pid and pipe of a worker change under _mutex when it
+        // is restarted
+        std::vector<worker> _workers;
+        std::mutex _mutex;
+
+        // last ASSOCIATED, replayed to restarted workers
+        std::string _association;
+
+        // name, registration and acks of the node
+        std::unique_ptr<ForwarderNode> _node;
+        std::shared_ptr<Publisher> _pub;
+        std::unique_ptr<AsyncRedis> _remote;
+        std::unique_ptr<Scheduler> _scheduler;
+        std::unique_ptr<Watcher> _watcher;
+        std::unique_ptr<Beacon> _beacon;
+        std::unique_ptr<MetricsServer> _metrics;
+
+        MessageBuilder _builder;
+
+        // fork and exec worker index, caller holds the lock
+        void spawn(const size_t index);
+
+        // restart workers that exited, on the scheduler thread
+        void reap();
+
+        // back off worker index after it failed to start or exited soon
+        // after, caller holds the lock
+        void failed(const size_t index);
+
+        void relay(std::shared_ptr<MessagePipe> pipe);
+        void send(const size_t index, const std::string& message);
+};
+
+#endif
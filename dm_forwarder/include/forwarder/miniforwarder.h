@@ -25,33 +25,64 @@
 #define MINIFORWARDER_H
 
 #include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <future>
 #include <functional>
 #include <boost/filesystem.hpp>
 #include <yaml-cpp/yaml.h>
 
 #include <core/IIPBase.h>
-#include <core/SimplePublisher.h>
+#include <core/Publisher.h>
+#include <core/MessagePipe.h>
+#include <core/AsyncRedis.h>
+#include <core/Scheduler.h>
+#include <core/WorkerPool.h>
+#include <core/TokenBucket.h>
+#include <core/Metrics.h>
 #include <core/HeartBeat.h>
 
 #include <forwarder/Scoreboard.h>
+#include <forwarder/ForwarderNode.h>
 #include <forwarder/MessageBuilder.h>
 #include <forwarder/HeaderFetcher.h>
 #include <forwarder/Formatter.h>
 #include <forwarder/FileSender.h>
 #include <forwarder/ReadoutPattern.h>
+#include <forwarder/YAMLFormatter.h>
 #include <forwarder/Info.h>
+#include <forwarder/Pipeline.h>
+#include <forwarder/ResourceGovernor.h>
+#include <forwarder/CatchupEngine.h>
 #include <daq/Notification.h>
+#include <daq/PixelPool.h>
+#include <daq/ScanIndex.h>
 #include <daq/DAQFetcher.h>
 
 class miniforwarder : public IIPBase {
     public:
+        /**
+         * @param pub transport for outgoing messages, RabbitMQ at
+         *      BASE_BROKER_ADDR if not given
+         * @param worker index in WORKERS of the location group a supervised
+         *      worker handles, -1 for a forwarder on its own
+         */
         miniforwarder(const std::string& config,
-                      const std::string& log);
+                      const std::string& log,
+                      std::shared_ptr<Publisher> pub = nullptr,
+                      const int worker = -1);
         ~miniforwarder();
 
         void on_message(const std::string&);
         void run();
 
+        /**
+         * Handle messages the supervisor hands over pipe until it closes
+         */
+        void serve(MessagePipe& pipe);
+
         void health_check(const YAML::Node&);
         void xfer_params(const YAML::Node&);
         void header_ready(const YAML::Node&);
@@ -59,8 +90,25 @@ class miniforwarder : public IIPBase {
         void process_ack(const YAML::Node&);
         void associated(const YAML::Node&);
         void scan(const YAML::Node&);
+        void trace(const YAML::Node&);
 
+        void fetch(const std::string& image_id);
+        void fetch_pixels(const std::string& image_id);
+        void on_image(const std::string& image_id, const std::string& folder);
+        void speculate(const std::string& image_id);
         void assemble(const std::string&);
+        void format(const std::string& image_id);
+        void transfer(const std::string& image_id);
+
+        /**
+         * Image left format or transfer, transferred or not. Its cost and
+         * resource budget are dropped and it may be assembled again.
+         *
+         * @param engine image is a catch-up image of the engine, which is
+         *      done with it
+         */
+        void finish(const std::string& image_id, const bool engine);
+
         void format_with_header(std::vector<std::string>& ccds,
                                 const std::string header);
         void publish_completed_msgs(const std::string image_id,
@@ -88,26 +136,56 @@ class miniforwarder : public IIPBase {
                 const std::string& ccd,
                 const std::string& filename,
                 const std::string& desc);
+        void publish_image_retrieval_for_archiving(
+                const int& error_code,
+                const std::string& obsid,
+                const std::string& raft,
+                const std::string& ccd,
+                const std::string& filename,
+                const std::string& desc,
+                const image_cost& cost);
+        void publish_telemetry(const std::string& msg);
         boost::filesystem::path create_dir(const boost::filesystem::path&);
         bool check_valid_board(const std::vector<std::string>& locs);
-        std::string get_name();
-        void register_fwd();
+
+        /**
+         * False if image has no locations of this worker, whose supervisor
+         * hands every worker HEADER_READY and END_READOUT
+         */
+        bool ours(const std::string& image_id);
+
+        /**
+         * Mode of the image a message of msg_type is about
+         */
+        Info::MODE mode_of(const std::string& msg_type);
+
+        /**
+         * True if image of xfer is archived by the catch-up engine
+         */
+        bool by_engine(const xfer_info& xfer);
+
+        /**
+         * When a live image of locations read out now is due
+         */
+        std::chrono::steady_clock::time_point due(
+                const std::vector<std::string>& locations);
 
     private:
-        std::string _name;
-        std::string _ip_addr;
-        std::string _hostname;
-        std::string _consume_q;
         std::string _archive_q;
         std::string _telemetry_q;
         std::string _amqp_url;
         std::string _partition;
         std::string _folder;
-        std::string _association_key;
-        std::string _forwarder_list;
-        int _seconds_to_update;
-        int _seconds_to_expire;
-        heartbeat_params _hb_params;
+        std::string _trace_file;
+        bool _speculative_fetch;
+        // bytes of one ccd admission reserves for
+        uint64_t _ccd_bytes;
+        int _scan_threads;
+        // -1 unless supervised, which leaves acks, registration and
+        // heartbeats to the supervisor
+        int _worker;
+        // time after END_READOUT a live image of a sensor type is due
+        std::map<DAQ::Sensor::Type, std::chrono::milliseconds> _budgets;
         Info::MODE _mode;
         redis_connection_params _redis_params;
 
@@ -118,17 +196,60 @@ class miniforwarder : public IIPBase {
             std::function<void (const YAML::Node&)> > _actions;
         std::vector<std::string> _daq_locations;
 
-        std::unique_ptr<SimplePublisher> _pub;
+        // name, registration and acks of the node
+        std::unique_ptr<ForwarderNode> _node;
+        std::shared_ptr<Publisher> _pub;
         std::unique_ptr<Scoreboard> _db;
+        std::unique_ptr<ResourceGovernor> _governor;
+        // remote redis for forwarder registration and scan results
+        std::unique_ptr<AsyncRedis> _remote;
+        std::unique_ptr<Scheduler> _scheduler;
         std::unique_ptr<Watcher> _watcher;
         std::unique_ptr<Beacon> _beacon;
+        std::unique_ptr<MetricsServer> _metrics;
         std::unique_ptr<FileSender> _sender;
+        std::unique_ptr<TokenBucket> _catchup_bucket;
         std::unique_ptr<Notification> _notification;
         std::unique_ptr<ReadoutPattern> _pattern;
+        // only used by scan on the consumer thread
+        std::unique_ptr<ScanIndex> _scan_index;
+
+        // header formatter of each sensor type with a valid readout pattern,
+        // shared by all write_header tasks
+        std::map<DAQ::Sensor::Type, std::shared_ptr<YAMLFormatter>>
+            _formatters;
+
+        // outlive the pipeline and speculative fetches that use them
+        std::unique_ptr<WorkerPool> _declutter_pool;
+        std::unique_ptr<PixelPool> _pixel_pool;
 
         MessageBuilder _builder;
         HeaderFetcher _hdr;
         ReadoutPattern _readoutpattern;
+
+        // images handed to the format stage and not yet transferred
+        std::set<std::string> _assembling;
+        std::mutex _assemble_mutex;
+
+        // pixel fetch of an image, started by the DAQ stream listener
+        // before END_READOUT arrived or claimed by fetch, whose future is
+        // then empty. Kept until the image ages out so that a late stream
+        // event, XFER_PARAMS or END_READOUT does not fetch the image a
+        // second time. Dropped when the fetch fails.
+        struct speculative_fetch {
+            std::shared_future<void> pixels;
+            std::chrono::steady_clock::time_point claimed;
+        };
+        std::map<std::string, speculative_fetch> _speculative;
+        std::mutex _speculative_mutex;
+
+        // forget fetches claimed longer than age ago that are not running
+        void expire_speculative(const std::chrono::seconds age);
+
+        std::unique_ptr<Pipeline> _pipeline;
+
+        // catch-up images, none if CATCHUP_CONCURRENCY is 0
+        std::unique_ptr<CatchupEngine> _catchup;
 };
 
 #endif
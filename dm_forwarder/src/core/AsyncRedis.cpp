@@ -0,0 +1,367 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/AsyncRedis.h>
+
+// milliseconds the loop sleeps in poll when there is nothing to do
+#define ASYNC_REDIS_POLL 100
+
+// milliseconds before connecting again after a failure
+#define ASYNC_REDIS_RETRY 1000
+
+AsyncRedis::AsyncRedis(const redis_connection_params& params) :
+        _params(params),
+        _connect_timeout(params.connect_timeout),
+        _outstanding(0),
+        _ac(nullptr),
+        _connected(false),
+        _want_read(false),
+        _want_write(false),
+        _stop(false) {
+    if (pipe(_wake) < 0) {
+        std::ostringstream err;
+        err << "Cannot create wake up pipe for redis event loop";
+        LOG_CRT << err.str();
+        throw L1::RedisError(err.str());
+    }
+    fcntl(_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(_wake[1], F_SETFL, O_NONBLOCK);
+
+    _loop = std::thread(&AsyncRedis::run, this);
+}
+
+AsyncRedis::~AsyncRedis() {
+    _stop = true;
+    wake();
+    if (_loop.joinable()) {
+        _loop.join();
+    }
+    close(_wake[0]);
+    close(_wake[1]);
+}
+
+void AsyncRedis::send(std::vector<std::string> args, callback cb) {
+    op* o = new op;
+    o->args = std::move(args);
+    o->cb = std::move(cb);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _queue.push_back(o);
+        _outstanding++;
+    }
+    wake();
+}
+
+std::future<Reply> AsyncRedis::call(std::vector<std::string> args) {
+    auto promise = std::make_shared<std::promise<Reply>>();
+    send(std::move(args), [promise](const std::string& error,
+                                    const Reply& reply) {
+        if (error.empty()) {
+            promise->set_value(reply);
+        }
+        else {
+            promise->set_exception(std::make_exception_ptr(
+                        L1::RedisError(error)));
+        }
+    });
+    return promise->get_future();
+}
+
+void AsyncRedis::flush() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _idle.wait(lk, [this]() {
+        return _outstanding == 0;
+    });
+}
+
+void AsyncRedis::wake() {
+    char c = 0;
+    // pipe full means the loop is woken up already
+    ssize_t n = write(_wake[1], &c, 1);
+    (void) n;
+}
+
+void AsyncRedis::run() {
+    auto stop_deadline = std::chrono::steady_clock::time_point::max();
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        std::deque<op*> ready;
+        bool need_connect = false;
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (_stop && stop_deadline == std::chrono::steady_clock::time_point::max()) {
+                stop_deadline = now + _connect_timeout;
+            }
+            if (_stop && (_outstanding == 0 || now > stop_deadline)) {
+                break;
+            }
+
+            if (_connected) {
+                ready.swap(_queue);
+            }
+            else if (!_queue.empty() && !_ac && now >= _retry_at) {
+                need_connect = true;
+            }
+        }
+
+        if (need_connect) {
+            connect();
+        }
+        for (auto&& o : ready) {
+            issue(o);
+        }
+
+        if (_ac && !_connected && now > _connect_deadline) {
+            std::ostringstream err;
+            err << "Cannot connect to redis " << _params.host << ":"
+                << _params.port << " within " << _connect_timeout.count()
+                << " milliseconds";
+            redisAsyncFree(_ac);
+            disconnected(err.str());
+        }
+
+        struct pollfd fds[2];
+        int nfds = 1;
+        fds[0].fd = _wake[0];
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        if (_ac) {
+            fds[1].fd = _ac->c.fd;
+            fds[1].events = (_want_read ? POLLIN : 0) |
+                (_want_write ? POLLOUT : 0);
+            fds[1].revents = 0;
+            nfds = 2;
+        }
+
+        if (poll(fds, nfds, ASYNC_REDIS_POLL) <= 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buf[64];
+            while (read(_wake[0], buf, sizeof(buf)) > 0) {}
+        }
+
+        if (nfds == 2) {
+            const short ev = fds[1].revents;
+            if (_ac && _want_write && (ev & (POLLOUT | POLLERR | POLLHUP))) {
+                redisAsyncHandleWrite(_ac);
+            }
+            if (_ac && _want_read && (ev & (POLLIN | POLLERR | POLLHUP))) {
+                redisAsyncHandleRead(_ac);
+            }
+        }
+    }
+
+    if (_ac) {
+        // pending callbacks are called with a null reply
+        redisAsyncFree(_ac);
+        _ac = nullptr;
+    }
+    fail_queued("Redis event loop stopped");
+    LOG_INF << "Redis event loop for " << _params.host << " ended";
+}
+
+void AsyncRedis::connect() {
+    _ac = redisAsyncConnect(_params.host.c_str(), _params.port);
+    if (!_ac || _ac->err) {
+        std::ostringstream err;
+        err << "Cannot connect to redis " << _params.host << ":"
+            << _params.port << " because "
+            << (_ac ? _ac->errstr : "context cannot be allocated");
+        if (_ac) {
+            redisAsyncFree(_ac);
+        }
+        disconnected(err.str());
+        return;
+    }
+
+    _ac->data = this;
+    _ac->ev.data = this;
+    _ac->ev.addRead = &AsyncRedis::add_read;
+    _ac->ev.delRead = &AsyncRedis::del_read;
+    _ac->ev.addWrite = &AsyncRedis::add_write;
+    _ac->ev.delWrite = &AsyncRedis::del_write;
+    _ac->ev.cleanup = &AsyncRedis::cleanup;
+
+    // event hooks have to be in place, setting the connect callback waits
+    // for the first write event
+    redisAsyncSetConnectCallback(_ac, &AsyncRedis::on_connect);
+    redisAsyncSetDisconnectCallback(_ac, &AsyncRedis::on_disconnect);
+    _connect_deadline = std::chrono::steady_clock::now() + _connect_timeout;
+}
+
+void AsyncRedis::disconnected(const std::string& error) {
+    _ac = nullptr;
+    _connected = false;
+    _want_read = false;
+    _want_write = false;
+
+    if (!error.empty()) {
+        LOG_CRT << error;
+        _retry_at = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(ASYNC_REDIS_RETRY);
+        fail_queued(error);
+    }
+}
+
+void AsyncRedis::issue(op* o) {
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    for (auto&& arg : o->args) {
+        argv.push_back(arg.c_str());
+        argvlen.push_back(arg.size());
+    }
+
+    if (!_ac || redisAsyncCommandArgv(_ac, &AsyncRedis::on_reply, o,
+                argv.size(), argv.data(), argvlen.data()) != REDIS_OK) {
+        done(o, "Cannot queue redis command " + o->args[0], Reply());
+    }
+}
+
+void AsyncRedis::fail_queued(const std::string& error) {
+    std::deque<op*> failed;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        failed.swap(_queue);
+    }
+    for (auto&& o : failed) {
+        done(o, error, Reply());
+    }
+}
+
+void AsyncRedis::done(op* o, const std::string& error, const Reply& reply) {
+    if (o->cb) {
+        try {
+            o->cb(error, reply);
+        }
+        catch (std::exception& e) {
+            LOG_CRT << "Redis callback for " << o->args[0] << " failed because "
+                    << e.what();
+        }
+    }
+    else if (!error.empty()) {
+        // every queued command fails while the server is down
+        LOG_EVERY_MS(critical, 1000) << "Redis " << o->args[0]
+            << " failed because " << error;
+    }
+    delete o;
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (--_outstanding == 0) {
+        _idle.notify_all();
+    }
+}
+
+void AsyncRedis::on_connect(const redisAsyncContext* ac, int status) {
+    AsyncRedis* self = static_cast<AsyncRedis*>(ac->data);
+    if (status != REDIS_OK) {
+        // hiredis frees the context after this returns
+        std::ostringstream err;
+        err << "Cannot connect to redis " << self->_params.host << ":"
+            << self->_params.port << " because " << ac->errstr;
+        self->disconnected(err.str());
+        return;
+    }
+
+    self->_connected = true;
+    LOG_INF << "Made async connection to redis " << self->_params.host
+            << " using db " << self->_params.db;
+
+    // sent ahead of anything queued by the loop
+    std::vector<std::vector<std::string>> handshake;
+    if (!self->_params.passwd.empty()) {
+        handshake.push_back({ "AUTH", self->_params.passwd });
+    }
+    handshake.push_back({ "select", std::to_string(self->_params.db) });
+    for (auto&& args : handshake) {
+        op* o = new op;
+        o->args = std::move(args);
+        {
+            std::lock_guard<std::mutex> lk(self->_mutex);
+            self->_outstanding++;
+        }
+        self->issue(o);
+    }
+}
+
+void AsyncRedis::on_disconnect(const redisAsyncContext* ac, int status) {
+    AsyncRedis* self = static_cast<AsyncRedis*>(ac->data);
+    if (status != REDIS_OK) {
+        std::ostringstream err;
+        err << "Lost connection to redis " << self->_params.host
+            << " because " << ac->errstr;
+        self->disconnected(err.str());
+    }
+    else {
+        self->disconnected("");
+    }
+}
+
+void AsyncRedis::on_reply(redisAsyncContext* ac, void* r, void* privdata) {
+    AsyncRedis* self = static_cast<AsyncRedis*>(ac->data);
+    op* o = static_cast<op*>(privdata);
+    redisReply* reply = static_cast<redisReply*>(r);
+
+    if (!reply) {
+        self->done(o, ac->errstr[0] ? ac->errstr : "Redis connection closed",
+                Reply());
+        return;
+    }
+    if (reply->type == REDIS_REPLY_ERROR) {
+        self->done(o, std::string(reply->str, reply->len), Reply());
+        return;
+    }
+
+    // hiredis frees the reply after this returns
+    RedisReplies replies;
+    replies.parse(reply);
+    self->done(o, "", replies.copy(replies[0]));
+}
+
+void AsyncRedis::add_read(void* data) {
+    static_cast<AsyncRedis*>(data)->_want_read = true;
+}
+
+void AsyncRedis::del_read(void* data) {
+    static_cast<AsyncRedis*>(data)->_want_read = false;
+}
+
+void AsyncRedis::add_write(void* data) {
+    static_cast<AsyncRedis*>(data)->_want_write = true;
+}
+
+void AsyncRedis::del_write(void* data) {
+    static_cast<AsyncRedis*>(data)->_want_write = false;
+}
+
+void AsyncRedis::cleanup(void* data) {
+    AsyncRedis* self = static_cast<AsyncRedis*>(data);
+    self->_want_read = false;
+    self->_want_write = false;
+}
@@ -21,52 +21,29 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <thread>
-#include <chrono>
+#include <string>
 #include <core/HeartBeat.h>
-#include <core/RedisConnection.h>
 #include <core/SimpleLogger.h>
-#include <core/Exceptions.h>
 
-Beacon::Beacon(const heartbeat_params params) {
-    _stop = false;
-    std::thread t(&Beacon::ping, this, params);
-    t.detach();
-}
+Beacon::Beacon(Scheduler& scheduler,
+               AsyncRedis& redis,
+               const heartbeat_params params) : _scheduler(scheduler) {
+    const std::string key = params.key;
+    const std::string seconds_to_expire = std::to_string(
+            params.seconds_to_expire);
 
-void Beacon::clear() {
-    std::lock_guard<std::mutex> lk(_mutex);
-    _stop = true;
-    _cond.notify_all();
+    _timer = _scheduler.every(std::chrono::seconds(params.seconds_to_update),
+            [&redis, key, seconds_to_expire]() {
+        // failures are logged by AsyncRedis, next beat tries again
+        redis.send({ "setex", key, seconds_to_expire, "pong" });
+    }, std::chrono::milliseconds(0));
+    LOG_INF << "Beacon started ...";
 }
 
-void Beacon::ping(const heartbeat_params& params) {
-    const std::string host = params.redis_params.host;
-    const int port = params.redis_params.port;
-    const int db = params.redis_params.db;
-
-    const std::string key = params.key;
-    const int seconds_to_expire = params.seconds_to_expire;
-    const int seconds_to_update = params.seconds_to_update;
+Beacon::~Beacon() {
+    clear();
+}
 
-    try {
-        RedisConnection redis(host, port, db);
-        LOG_INF << "Beacon started ...";
-        while (!_stop.load()) {
-            redis.setex(key, std::to_string(seconds_to_expire), "pong");
-            redis.exec();
-            std::unique_lock<std::mutex> lk(_mutex);
-            std::cv_status status = _cond.wait_for(lk,
-                    std::chrono::seconds(seconds_to_update));
-        }
-    }
-    catch(L1::RedisError& e) {
-        LOG_CRT << "Cannot start Beacon because " << e.what();
-        return;
-    }
-    catch(std::exception& e) {
-        LOG_CRT << "Cannot start Beacon because " << e.what();
-        return;
-    }
-    LOG_CRT << "Beacon ended";
+void Beacon::clear() {
+    _scheduler.cancel(_timer);
 }
@@ -0,0 +1,84 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <core/LocalBroker.h>
+
+LocalBroker::LocalBroker() : _stop{false} {
+}
+
+void LocalBroker::publish_message(const std::string& queue,
+                                  const std::string& body) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _queues[queue].push_back(body);
+    _published.notify_all();
+}
+
+bool LocalBroker::get(const std::string& queue,
+                      std::string& body,
+                      const std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    std::deque<std::string>& messages = _queues[queue];
+    _published.wait_for(lk, timeout, [this, &messages]() {
+        return _stop || !messages.empty();
+    });
+
+    if (_stop || messages.empty()) {
+        return false;
+    }
+    body = std::move(messages.front());
+    messages.pop_front();
+    return true;
+}
+
+void LocalBroker::run(const std::string& queue,
+                      std::function<void (const std::string&)> on_message) {
+    while (true) {
+        std::string body;
+        {
+            std::unique_lock<std::mutex> lk(_mutex);
+            std::deque<std::string>& messages = _queues[queue];
+            _published.wait(lk, [this, &messages]() {
+                return _stop || !messages.empty();
+            });
+
+            if (_stop) {
+                break;
+            }
+            body = std::move(messages.front());
+            messages.pop_front();
+        }
+        on_message(body);
+    }
+}
+
+size_t LocalBroker::size(const std::string& queue) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _queues.find(queue);
+    return it == _queues.end() ? 0 : it->second.size();
+}
+
+void LocalBroker::stop() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _stop = true;
+    _published.notify_all();
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/MessagePipe.h>
+
+MessagePipe::MessagePipe(const int fd) : _fd{fd} {
+}
+
+MessagePipe::~MessagePipe() {
+    close(_fd);
+}
+
+void MessagePipe::publish_message(const std::string& queue,
+                                  const std::string& body) {
+    uint32_t lengths[2] = {
+        static_cast<uint32_t>(queue.size()),
+        static_cast<uint32_t>(body.size())
+    };
+    std::string frame(reinterpret_cast<const char*>(lengths),
+            sizeof(lengths));
+    frame += queue;
+    frame += body;
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        // MSG_NOSIGNAL so that a dead worker does not kill the supervisor
+        ssize_t n = send(_fd, frame.data() + sent, frame.size() - sent,
+                MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            std::ostringstream err;
+            err << "Cannot send message to " << queue << " through pipe "
+                << _fd << " because " << std::strerror(errno);
+            LOG_CRT << err.str();
+            throw L1::PublisherError(err.str());
+        }
+        sent += n;
+    }
+}
+
+bool MessagePipe::read_all(char* buf, size_t n) {
+    while (n > 0) {
+        ssize_t got = recv(_fd, buf, n, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        buf += got;
+        n -= got;
+    }
+    return true;
+}
+
+bool MessagePipe::get(std::string& queue, std::string& body) {
+    uint32_t lengths[2];
+    if (!read_all(reinterpret_cast<char*>(lengths), sizeof(lengths))) {
+        return false;
+    }
+    queue.resize(lengths[0]);
+    body.resize(lengths[1]);
+    return read_all(&queue[0], lengths[0]) && read_all(&body[0], lengths[1]);
+}
+
+void MessagePipe::shutdown() {
+    ::shutdown(_fd, SHUT_WR);
+}
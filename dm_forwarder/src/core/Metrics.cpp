@@ -0,0 +1,478 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/Metrics.h>
+
+// exported histogram buckets, powers of four microseconds from 256 us to
+// about 4.7 hours
+#define METRICS_LE_FIRST 8
+#define METRICS_LE_LAST 34
+#define METRICS_LE_STEP 2
+
+Counter::Counter() : _value(0) {
+}
+
+void Counter::add(const uint64_t n) {
+    _value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    return _value.load(std::memory_order_relaxed);
+}
+
+Gauge::Gauge() : _value(0) {
+}
+
+void Gauge::set(const int64_t value) {
+    _value.store(value, std::memory_order_relaxed);
+}
+
+void Gauge::add(const int64_t n) {
+    _value.fetch_add(n, std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const {
+    return _value.load(std::memory_order_relaxed);
+}
+
+Histogram::Histogram() : _count(0), _sum(0), _max(0) {
+    for (auto&& b : _buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::bucket(const uint64_t us) {
+    if (us < METRICS_SUB_BUCKETS) {
+        return us;
+    }
+    int magnitude = 63 - __builtin_clzll(us);
+    int shift = magnitude - METRICS_SUB_BITS;
+    uint64_t sub = (us >> shift) & (METRICS_SUB_BUCKETS - 1);
+    return (shift + 1) * METRICS_SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::upper(const size_t bucket) {
+    if (bucket < METRICS_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / METRICS_SUB_BUCKETS - 1;
+    uint64_t sub = bucket % METRICS_SUB_BUCKETS;
+    uint64_t lower = (METRICS_SUB_BUCKETS + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(const uint64_t us) {
+    _buckets[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev = _max.load(std::memory_order_relaxed);
+    while (prev < us && !_max.compare_exchange_weak(prev, us,
+                std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::count() const {
+    return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::sum() const {
+    return _sum.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::max() const {
+    return _max.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count_below(const uint64_t us) const {
+    size_t last = bucket(us);
+    uint64_t total = 0;
+    for (size_t i = 0; i <= last; i++) {
+        total += _buckets[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t Histogram::percentile(const double q) const {
+    uint64_t total = 0;
+    uint64_t counts[METRICS_BUCKETS];
+    for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (!total) {
+        return 0;
+    }
+
+    // rank of the value at q, 1 based
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+    rank = std::min<uint64_t>(rank, total);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(upper(i), max());
+        }
+    }
+    return max();
+}
+
+bool operator<(const metric_labels& lhs, const metric_labels& rhs) {
+    if (lhs.stage != rhs.stage) return lhs.stage < rhs.stage;
+    if (lhs.sensor != rhs.sensor) return lhs.sensor < rhs.sensor;
+    return lhs.location < rhs.location;
+}
+
+Metrics& Metrics::instance() {
+    // leaked so that stages still running during exit can record
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Histogram& Metrics::latency(const std::string& stage,
+                            const std::string& sensor,
+                            const std::string& location) {
+    metric_labels labels{ stage, sensor, location };
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::unique_ptr<Histogram>& hist = _latency[labels];
+    if (!hist) {
+        hist = std::unique_ptr<Histogram>(new Histogram());
+    }
+    return *hist;
+}
+
+Counter& Metrics::counter(const std::string& name,
+                          const std::string& stage,
+                          const std::string& sensor,
+                          const std::string& location) {
+    metric_labels labels{ stage, sensor, location };
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::unique_ptr<Counter>& c = _counters[name][labels];
+    if (!c) {
+        c = std::unique_ptr<Counter>(new Counter());
+    }
+    return *c;
+}
+
+Gauge& Metrics::gauge(const std::string& name,
+                      const std::string& stage,
+                      const std::string& sensor,
+                      const std::string& location) {
+    metric_labels labels{ stage, sensor, location };
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::unique_ptr<Gauge>& g = _gauges[name][labels];
+    if (!g) {
+        g = std::unique_ptr<Gauge>(new Gauge());
+    }
+    return *g;
+}
+
+namespace {
+
+std::string escape(const std::string& value) {
+    std::string out;
+    for (auto&& c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n') {
+            out += "\\n";
+        }
+        else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void write_labels(std::ostream& out, const metric_labels& labels) {
+    out << "stage=\"" << escape(labels.stage)
+        << "\",sensor=\"" << escape(labels.sensor)
+        << "\",location=\"" << escape(labels.location) << "\"";
+}
+
+double seconds(const uint64_t us) {
+    return us / 1e6;
+}
+
+}
+
+std::string Metrics::render() {
+    std::ostringstream out;
+    out.precision(9);
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    const std::string stage = METRICS_PREFIX "stage_seconds";
+    out << "# HELP " << stage << " Latency of pipeline stages\n"
+        << "# TYPE " << stage << " histogram\n";
+    for (auto&& series : _latency) {
+        const Histogram& hist = *series.second;
+        for (int i = METRICS_LE_FIRST; i <= METRICS_LE_LAST;
+                i += METRICS_LE_STEP) {
+            uint64_t le = uint64_t(1) << i;
+            out << stage << "_bucket{";
+            write_labels(out, series.first);
+            out << ",le=\"" << seconds(le) << "\"} "
+                << hist.count_below(le - 1) << "\n";
+        }
+        out << stage << "_bucket{";
+        write_labels(out, series.first);
+        out << ",le=\"+Inf\"} " << hist.count() << "\n";
+
+        out << stage << "_sum{";
+        write_labels(out, series.first);
+        out << "} " << seconds(hist.sum()) << "\n";
+
+        out << stage << "_count{";
+        write_labels(out, series.first);
+        out << "} " << hist.count() << "\n";
+    }
+
+    // full resolution percentiles, exported buckets are too coarse to spot
+    // a stage slowing down by a few percent
+    const std::string quantile = METRICS_PREFIX "stage_quantile_seconds";
+    out << "# HELP " << quantile << " Latency percentiles of pipeline stages\n"
+        << "# TYPE " << quantile << " gauge\n";
+    for (auto&& series : _latency) {
+        const Histogram& hist = *series.second;
+        for (auto&& q : { 0.5, 0.9, 0.99, 1.0 }) {
+            out << quantile << "{";
+            write_labels(out, series.first);
+            out << ",quantile=\"" << q << "\"} "
+                << seconds(hist.percentile(q)) << "\n";
+        }
+    }
+
+    for (auto&& family : _counters) {
+        const std::string name = METRICS_PREFIX + family.first + "_total";
+        out << "# TYPE " << name << " counter\n";
+        for (auto&& series : family.second) {
+            out << name << "{";
+            write_labels(out, series.first);
+            out << "} " << series.second->value() << "\n";
+        }
+    }
+
+    for (auto&& family : _gauges) {
+        const std::string name = METRICS_PREFIX + family.first;
+        out << "# TYPE " << name << " gauge\n";
+        for (auto&& series : family.second) {
+            out << name << "{";
+            write_labels(out, series.first);
+            out << "} " << series.second->value() << "\n";
+        }
+    }
+    return out.str();
+}
+
+std::vector<std::pair<metric_labels, const Histogram*>> Metrics::latencies() {
+    std::vector<std::pair<metric_labels, const Histogram*>> out;
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto&& series : _latency) {
+        out.push_back(std::make_pair(series.first, series.second.get()));
+    }
+    return out;
+}
+
+void Metrics::dump(const std::string& path) {
+    const std::string body = render();
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        file << body;
+        file.close();
+        if (!file) {
+            std::ostringstream err;
+            err << "Cannot write metrics to " << tmp;
+            LOG_CRT << err.str();
+            throw L1::MetricsError(err.str());
+        }
+    }
+
+    if (std::rename(tmp.c_str(), path.c_str())) {
+        std::ostringstream err;
+        err << "Cannot move metrics to " << path << " because "
+            << strerror(errno);
+        LOG_CRT << err.str();
+        throw L1::MetricsError(err.str());
+    }
+}
+
+void Metrics::clear() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _latency.clear();
+    _counters.clear();
+    _gauges.clear();
+}
+
+StageTimer::StageTimer(Histogram& hist) :
+        _hist(hist),
+        _start(std::chrono::steady_clock::now()),
+        _stopped{false} {
+}
+
+StageTimer::~StageTimer() {
+    stop();
+}
+
+void StageTimer::stop() {
+    if (!_stopped) {
+        _stopped = true;
+        _hist.record(elapsed());
+    }
+}
+
+uint64_t StageTimer::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - _start).count();
+}
+
+MetricsServer::MetricsServer(const int port) : _stop{false} {
+    // not inherited by worker processes, which would keep the port bound
+    _fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_fd < 0) {
+        std::ostringstream err;
+        err << "Cannot create metrics socket because " << strerror(errno);
+        LOG_CRT << err.str();
+        throw L1::MetricsError(err.str());
+    }
+
+    int on = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    socklen_t len = sizeof(addr);
+    if (bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+            || listen(_fd, 4) < 0
+            || getsockname(_fd, (struct sockaddr*)&addr, &len) < 0
+            || pipe(_wake) < 0) {
+        std::ostringstream err;
+        err << "Cannot serve metrics on port " << port << " because "
+            << strerror(errno);
+        LOG_CRT << err.str();
+        close(_fd);
+        throw L1::MetricsError(err.str());
+    }
+    _port = ntohs(addr.sin_port);
+
+    _worker = std::thread(&MetricsServer::run, this);
+    LOG_INF << "Serving metrics on port " << _port;
+}
+
+MetricsServer::~MetricsServer() {
+    _stop = true;
+    char c = 0;
+    if (write(_wake[1], &c, 1) < 0) {
+        LOG_WRN << "Cannot wake up metrics server";
+    }
+    _worker.join();
+    close(_fd);
+    close(_wake[0]);
+    close(_wake[1]);
+}
+
+int MetricsServer::port() const {
+    return _port;
+}
+
+void MetricsServer::run() {
+    while (!_stop.load()) {
+        struct pollfd fds[2];
+        fds[0].fd = _fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = _wake[0];
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) <= 0 || !(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int client = accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        serve(client);
+        close(client);
+    }
+}
+
+void MetricsServer::serve(const int client) {
+    // the request is only read so the scraper does not see a reset, any
+    // path gets the metrics
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        struct pollfd fd;
+        fd.fd = client;
+        fd.events = POLLIN;
+        if (poll(&fd, 1, METRICS_READ_TIMEOUT) <= 0) {
+            return;
+        }
+        ssize_t n = read(client, buf, sizeof(buf));
+        if (n <= 0) {
+            return;
+        }
+        request.append(buf, n);
+    }
+
+    const std::string body = Metrics::instance().render();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+
+    const std::string out = response.str();
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = send(client, out.data() + sent, out.size() - sent,
+                MSG_NOSIGNAL);
+        if (n <= 0) {
+            LOG_WRN << "Cannot send metrics to scraper";
+            return;
+        }
+        sent += n;
+    }
+}
@@ -21,17 +21,21 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <sstream>
+#include <algorithm>
 #include <sys/time.h>
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
-#include <core/RedisResponse.h>
 #include <core/RedisConnection.h>
 
 RedisConnection::RedisConnection(const std::string host,
                                  const int port,
-                                 const int db) : _host(host) {
-    // Timeout of 2 seconds for connection handshake
-    const struct timeval tv{2, 0};
+                                 const int db) :
+        _host(host),
+        _num_pending(0) {
+    const struct timeval tv{REDIS_CONNECT_TIMEOUT / 1000,
+        (REDIS_CONNECT_TIMEOUT % 1000) * 1000};
 
     _context = redisConnectWithTimeout(host.c_str(), port, tv);
     if (_context->err) {
@@ -47,9 +51,11 @@ RedisConnection::RedisConnection(const std::string host,
 RedisConnection::RedisConnection(const std::string host,
                                  const int port,
                                  const int db,
-                                 const std::string passwd) : _host(host) {
-    // Timeout of 2 seconds for connection handshake
-    const struct timeval tv{2, 0};
+                                 const std::string passwd) :
+        _host(host),
+        _num_pending(0) {
+    const struct timeval tv{REDIS_CONNECT_TIMEOUT / 1000,
+        (REDIS_CONNECT_TIMEOUT % 1000) * 1000};
 
     _context = redisConnectWithTimeout(host.c_str(), port, tv);
     if (_context->err) {
@@ -65,9 +71,10 @@ RedisConnection::RedisConnection(const std::string host,
 }
 
 RedisConnection::RedisConnection(struct redis_connection_params params)
-        : _host(params.host) {
-    // Timeout of 2 seconds for connection handshake
-    const struct timeval tv{2, 0};
+        : _host(params.host),
+          _num_pending(0) {
+    const struct timeval tv{params.connect_timeout / 1000,
+        (params.connect_timeout % 1000) * 1000};
 
     _context = redisConnectWithTimeout(params.host.c_str(), params.port, tv);
     if (_context->err) {
@@ -75,7 +82,9 @@ RedisConnection::RedisConnection(struct redis_connection_params params)
         throw L1::RedisError(_context->errstr);
     }
 
-    auth(params.passwd);
+    if (!params.passwd.empty()) {
+        auth(params.passwd);
+    }
 
     select(std::to_string(params.db));
     exec();
@@ -84,106 +93,233 @@ RedisConnection::RedisConnection(struct redis_connection_params params)
 }
 
 RedisConnection::~RedisConnection() {
+    free_replies();
     redisFree(_context);
 }
 
-void RedisConnection::auth(const std::string passwd){
-    std::vector<std::string> v{ "AUTH", passwd };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::begin(const boost::string_view name,
+                            const size_t argc) {
+    if (_pending.size() <= _num_pending) {
+        _pending.resize(_num_pending + 1);
+    }
+    _pending[_num_pending++].assign(name.data(), name.size());
+    _encoder.command(argc);
+    _encoder.arg(name);
+}
+
+void RedisConnection::auth(const boost::string_view passwd){
+    begin("AUTH", 2);
+    _encoder.arg(passwd);
 }
 
-void RedisConnection::select(const std::string index) {
-    std::vector<std::string> v{ "select", index };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::select(const boost::string_view index) {
+    begin("select", 2);
+    _encoder.arg(index);
 }
 
-void RedisConnection::lpush(const std::string key,
-                            std::vector<std::string> values) {
-    std::vector<std::string> v{ "lpush", key };
-    std::copy(values.begin(), values.end(), std::back_inserter(v));
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::lpush(const boost::string_view key,
+                            const std::vector<std::string>& values) {
+    begin("lpush", 2 + values.size());
+    _encoder.arg(key);
+    for (auto&& value : values) {
+        _encoder.arg(value);
+    }
 }
 
-void RedisConnection::lrange(const std::string key,
-                             const std::string start,
-                             const std::string stop) {
-    std::vector<std::string> v{ "lrange", key, start, stop };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::lrange(const boost::string_view key,
+                             const boost::string_view start,
+                             const boost::string_view stop) {
+    begin("lrange", 4);
+    _encoder.arg(key);
+    _encoder.arg(start);
+    _encoder.arg(stop);
 }
 
-void RedisConnection::setex(const std::string key,
-                            const std::string seconds,
-                            const std::string value) {
-    std::vector<std::string> v{ "setex", key, seconds, value };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::setex(const boost::string_view key,
+                            const boost::string_view seconds,
+                            const boost::string_view value) {
+    begin("setex", 4);
+    _encoder.arg(key);
+    _encoder.arg(seconds);
+    _encoder.arg(value);
 }
 
-void RedisConnection::exists(const std::string key) {
-    std::vector<std::string> v{ "exists", key };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::exists(const boost::string_view key) {
+    begin("exists", 2);
+    _encoder.arg(key);
 }
 
-void RedisConnection::set(const std::string key,
-                          const std::string value) {
-    std::vector<std::string> v{ "set", key, value };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::set(const boost::string_view key,
+                          const boost::string_view value) {
+    begin("set", 3);
+    _encoder.arg(key);
+    _encoder.arg(value);
 }
 
-void RedisConnection::get(const std::string key) {
-    std::vector<std::string> v{ "get", key };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::get(const boost::string_view key) {
+    begin("get", 2);
+    _encoder.arg(key);
 }
 
 void RedisConnection::flushdb() {
-    std::vector<std::string> v{ "flushdb" };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+    begin("flushdb", 1);
+}
+
+void RedisConnection::keys(const boost::string_view pattern) {
+    begin("keys", 2);
+    _encoder.arg(pattern);
+}
+
+void RedisConnection::del(const std::vector<std::string>& keys) {
+    begin("del", 1 + keys.size());
+    for (auto&& key : keys) {
+        _encoder.arg(key);
+    }
+}
+
+void RedisConnection::hgetall(const boost::string_view key) {
+    begin("hgetall", 2);
+    _encoder.arg(key);
 }
 
-void RedisConnection::keys(const std::string pattern) {
-    std::vector<std::string> v{ "keys", pattern };
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+void RedisConnection::smembers(const boost::string_view key) {
+    begin("smembers", 2);
+    _encoder.arg(key);
+}
+
+void RedisConnection::srem(const boost::string_view key,
+                           const std::vector<std::string>& members) {
+    begin("srem", 2 + members.size());
+    _encoder.arg(key);
+    for (auto&& member : members) {
+        _encoder.arg(member);
+    }
+}
+
+void RedisConnection::command(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        return;
+    }
+
+    begin(args[0], args.size());
+    for (size_t i = 1; i < args.size(); i++) {
+        _encoder.arg(args[i]);
+    }
+}
+
+void RedisConnection::free_replies() {
+    for (auto&& r : _raw) {
+        freeReplyObject(r);
+    }
+    _raw.clear();
+    _replies.clear();
 }
 
-void RedisConnection::del(std::vector<std::string> keys) {
-    std::vector<std::string> v{ "del" };
-    std::copy(keys.begin(), keys.end(), std::back_inserter(v));
-    RedisArg arg;
-    arg.arg = v;
-    _commands.push_back(arg);
+const RedisReplies& RedisConnection::exec_view() {
+    free_replies();
+
+    const size_t num = _num_pending;
+    _num_pending = 0;
+    const boost::string_view buf = _encoder.data();
+    if (num) {
+        redisAppendFormattedCommand(_context, buf.data(), buf.size());
+    }
+    _encoder.clear();
+
+    // read every reply even if one of them is an error, otherwise the
+    // remaining replies would be returned to the next caller
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream err;
+    bool failed = false;
+    for (size_t i = 0; i < num; i++) {
+        redisReply* r = NULL;
+        if (redisGetReply(_context, (void **)&r) != REDIS_OK || r == NULL) {
+            err << "Error occurred while executing redis command because "
+                << _context->errstr;
+            failed = true;
+            break;
+        }
+        _raw.push_back(r);
+        _replies.parse(r);
+
+        if (r->type == REDIS_REPLY_ERROR && !failed) {
+            err << "Error while executing redis `" << _pending[i]
+                << "` because " << std::string(r->str, r->len);
+            failed = true;
+        }
+
+        if (_stats) {
+            auto end = std::chrono::steady_clock::now();
+            _stats->record(_pending[i],
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        end - start).count());
+        }
+    }
+
+    if (failed) {
+        LOG_CRT << err.str();
+        throw L1::RedisError(err.str());
+    }
+    return _replies;
 }
 
 std::vector<Reply> RedisConnection::exec() {
+    const RedisReplies& views = exec_view();
+
     std::vector<Reply> replies;
-    std::vector<RedisResponse> responses;
-    for (auto&& arg : _commands) {
-        RedisResponse r(_context, arg);
-        responses.push_back(r);
+    for (size_t i = 0; i < views.size(); i++) {
+        replies.push_back(views.copy(views[i]));
     }
+    return replies;
+}
+
+std::vector<Reply> RedisConnection::transaction() {
+    const size_t num = _num_pending;
 
-    for (auto&& res : responses) {
-        replies.push_back(res.get());
+    // MULTI goes out ahead of the commands already encoded, EXEC after them
+    static const char multi[] = "*1\r\n$5\r\nmulti\r\n";
+    redisAppendFormattedCommand(_context, multi, sizeof(multi) - 1);
+
+    // name it in the next free slot and rotate it to the front, so that
+    // the names keep their storage across transactions
+    if (_pending.size() <= _num_pending) {
+        _pending.resize(_num_pending + 1);
     }
+    _pending[_num_pending].assign("multi");
+    std::rotate(_pending.begin(), _pending.begin() + _num_pending,
+            _pending.begin() + _num_pending + 1);
+    _num_pending++;
+    begin("exec", 1);
 
-    _commands.clear();
-    return replies;
+    // EXEC replies nil if a watched key changed
+    const RedisReplies& views = exec_view();
+    const ReplyView& result = views[views.size() - 1];
+    if (result.type == REDIS_REPLY_NIL) {
+        std::ostringstream err;
+        err << "Redis transaction of " << num << " commands was aborted";
+        LOG_CRT << err.str();
+        throw L1::RedisError(err.str());
+    }
+    return views.copy(result).elements;
+}
+
+bool RedisConnection::ok() {
+    return _context != NULL && !_context->err;
+}
+
+void RedisConnection::set_stats(std::shared_ptr<RedisStats> stats) {
+    _stats = stats;
+}
+
+void RedisStats::record(const std::string& command, const uint64_t us) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    redis_command_stats& stats = _stats[command];
+    stats.count++;
+    stats.total_us += us;
+    stats.max_us = std::max(stats.max_us, us);
+}
+
+std::map<std::string, redis_command_stats> RedisStats::get() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _stats;
 }
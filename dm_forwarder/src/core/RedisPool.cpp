@@ -0,0 +1,140 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <algorithm>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/RedisPool.h>
+
+// idle connections kept per redis server
+#define REDIS_POOL_MAX_IDLE 8
+
+RedisPool::Lease::Lease(RedisPool* pool,
+                        const std::string& key,
+                        std::unique_ptr<RedisConnection> con) :
+        _pool(pool),
+        _key(key),
+        _con(std::move(con)) {
+}
+
+RedisPool::Lease::Lease(Lease&& other) :
+        _pool(other._pool),
+        _key(std::move(other._key)),
+        _con(std::move(other._con)) {
+}
+
+RedisPool::Lease::~Lease() {
+    if (_con) {
+        _pool->release(_key, std::move(_con));
+    }
+}
+
+RedisConnection* RedisPool::Lease::operator->() {
+    return _con.get();
+}
+
+RedisConnection& RedisPool::Lease::operator*() {
+    return *_con;
+}
+
+RedisPool::RedisPool(const size_t max_idle) : _max_idle(max_idle) {
+}
+
+RedisPool& RedisPool::instance() {
+    static RedisPool pool(REDIS_POOL_MAX_IDLE);
+    return pool;
+}
+
+RedisPool::Lease RedisPool::lease(const redis_connection_params& params) {
+    std::ostringstream name;
+    name << params.host << ":" << params.port << "/" << params.db;
+    const std::string key = name.str() + "@" + params.passwd;
+
+    std::shared_ptr<RedisStats> stats;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        server& s = _servers[key];
+        if (!s.stats) {
+            s.name = name.str();
+            s.stats = std::make_shared<RedisStats>();
+        }
+
+        if (!s.idle.empty()) {
+            std::unique_ptr<RedisConnection> con = std::move(s.idle.back());
+            s.idle.pop_back();
+            return Lease(this, key, std::move(con));
+        }
+        stats = s.stats;
+    }
+
+    // connect outside of the lock so a slow server does not hold up leases
+    // of other servers
+    std::unique_ptr<RedisConnection> con(new RedisConnection(params));
+    con->set_stats(stats);
+    return Lease(this, key, std::move(con));
+}
+
+void RedisPool::release(const std::string& key,
+                        std::unique_ptr<RedisConnection> con) {
+    if (!con->ok()) {
+        LOG_WRN << "Dropping broken redis connection";
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    server& s = _servers[key];
+    if (s.idle.size() < _max_idle) {
+        s.idle.push_back(std::move(con));
+    }
+}
+
+std::map<std::string, std::map<std::string, redis_command_stats>>
+        RedisPool::stats() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::map<std::string, std::map<std::string, redis_command_stats>> all;
+    for (auto&& s : _servers) {
+        if (s.second.stats) {
+            std::map<std::string, redis_command_stats>& cmds =
+                    all[s.second.name];
+            for (auto&& cmd : s.second.stats->get()) {
+                redis_command_stats& merged = cmds[cmd.first];
+                merged.count += cmd.second.count;
+                merged.total_us += cmd.second.total_us;
+                merged.max_us = std::max(merged.max_us, cmd.second.max_us);
+            }
+        }
+    }
+    return all;
+}
+
+void RedisPool::report() {
+    for (auto&& s : stats()) {
+        for (auto&& cmd : s.second) {
+            LOG_INF << "Redis " << s.first << " " << cmd.first
+                    << " count=" << cmd.second.count
+                    << " mean_us=" << cmd.second.total_us / cmd.second.count
+                    << " max_us=" << cmd.second.max_us;
+        }
+    }
+}
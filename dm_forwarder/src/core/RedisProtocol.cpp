@@ -0,0 +1,126 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <core/RedisProtocol.h>
+
+// initial size of the command buffer of a connection
+#define REDIS_ENCODER_RESERVE 4096
+
+RedisEncoder::RedisEncoder() {
+    _buf.reserve(REDIS_ENCODER_RESERVE);
+}
+
+void RedisEncoder::number(const char prefix, size_t n) {
+    char digits[24];
+    int len = 0;
+    do {
+        digits[len++] = '0' + n % 10;
+        n /= 10;
+    } while (n);
+
+    _buf.push_back(prefix);
+    while (len) {
+        _buf.push_back(digits[--len]);
+    }
+    _buf.append("\r\n", 2);
+}
+
+void RedisEncoder::command(const size_t argc) {
+    number('*', argc);
+}
+
+void RedisEncoder::arg(const boost::string_view arg) {
+    number('$', arg.size());
+    _buf.append(arg.data(), arg.size());
+    _buf.append("\r\n", 2);
+}
+
+boost::string_view RedisEncoder::data() const {
+    return boost::string_view(_buf.data(), _buf.size());
+}
+
+void RedisEncoder::clear() {
+    _buf.clear();
+}
+
+void RedisReplies::parse(const redisReply* r) {
+    _top.push_back(_views.size());
+    _views.emplace_back();
+    fill(_top.back(), r);
+}
+
+void RedisReplies::fill(const size_t idx, const redisReply* r) {
+    // _views may grow below, write through the index
+    _views[idx].type = r->type;
+    _views[idx].integer = r->integer;
+    _views[idx].first = 0;
+    _views[idx].size = 0;
+
+    if (r->type == REDIS_REPLY_STRING || r->type == REDIS_REPLY_STATUS ||
+            r->type == REDIS_REPLY_ERROR) {
+        _views[idx].str = boost::string_view(r->str, r->len);
+    }
+    else {
+        _views[idx].str = boost::string_view();
+    }
+
+    if (r->type == REDIS_REPLY_ARRAY) {
+        const size_t first = _views.size();
+        _views.resize(first + r->elements);
+        _views[idx].first = first;
+        _views[idx].size = r->elements;
+        for (size_t i = 0; i < r->elements; i++) {
+            fill(first + i, r->element[i]);
+        }
+    }
+}
+
+void RedisReplies::clear() {
+    _top.clear();
+    _views.clear();
+}
+
+size_t RedisReplies::size() const {
+    return _top.size();
+}
+
+const ReplyView& RedisReplies::operator[](const size_t i) const {
+    return _views[_top[i]];
+}
+
+const ReplyView& RedisReplies::element(const ReplyView& r,
+                                       const size_t i) const {
+    return _views[r.first + i];
+}
+
+Reply RedisReplies::copy(const ReplyView& r) const {
+    Reply g;
+    g.integer = r.integer;
+    if (r.type != REDIS_REPLY_ERROR) {
+        g.str = std::string(r.str.data(), r.str.size());
+    }
+    for (size_t i = 0; i < r.size; i++) {
+        g.elements.push_back(copy(element(r, i)));
+    }
+    return g;
+}
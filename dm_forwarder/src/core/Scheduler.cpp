@@ -0,0 +1,229 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <core/SimpleLogger.h>
+#include <core/Scheduler.h>
+
+Scheduler::Scheduler(const std::chrono::milliseconds tick) :
+        _tick(tick.count() > 0 ? tick : std::chrono::milliseconds(1)),
+        _start(std::chrono::steady_clock::now()),
+        _now(0),
+        _next_id(1),
+        _running(0),
+        _stop(false) {
+    _worker = std::thread(&Scheduler::run, this);
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stop = true;
+    }
+    _cond.notify_all();
+    if (_worker.joinable()) {
+        _worker.join();
+    }
+}
+
+Scheduler::timer_id Scheduler::after(const std::chrono::milliseconds delay,
+                                     std::function<void ()> task) {
+    return add(std::move(task), ticks(delay), 0);
+}
+
+Scheduler::timer_id Scheduler::every(const std::chrono::milliseconds period,
+                                     std::function<void ()> task) {
+    return every(period, std::move(task), period);
+}
+
+Scheduler::timer_id Scheduler::every(const std::chrono::milliseconds period,
+                                     std::function<void ()> task,
+                                     const std::chrono::milliseconds delay) {
+    uint64_t p = ticks(period);
+    return add(std::move(task), ticks(delay), p > 0 ? p : 1);
+}
+
+void Scheduler::cancel(const timer_id id) {
+    // slot entries of cancelled timers are skipped when they come up
+    std::unique_lock<std::mutex> lk(_mutex);
+    _timers.erase(id);
+    if (id && std::this_thread::get_id() != _worker.get_id()) {
+        _task_done.wait(lk, [this, id]() {
+            return _running != id;
+        });
+    }
+}
+
+size_t Scheduler::size() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _timers.size();
+}
+
+uint64_t Scheduler::ticks(const std::chrono::milliseconds duration) {
+    if (duration.count() <= 0) {
+        return 0;
+    }
+    // round up so a task never runs early
+    return (duration.count() + _tick.count() - 1) / _tick.count();
+}
+
+Scheduler::timer_id Scheduler::add(std::function<void ()> task,
+                                   const uint64_t delay,
+                                   const uint64_t period) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    // catch up first so the delay counts from now, not from the last tick
+    uint64_t elapsed = (std::chrono::steady_clock::now() - _start) / _tick;
+    if (_timers.empty() && elapsed > _now) {
+        _now = elapsed;
+    }
+
+    // part of the current tick has passed already, count it as a whole
+    // one so the task never runs early
+    const timer_id id = _next_id++;
+    timer& t = _timers[id];
+    t.task = std::move(task);
+    t.expires = std::max(_now, elapsed) + delay + (delay ? 1 : 0);
+    t.period = period;
+    insert(id, t.expires, _now + 1);
+    _cond.notify_one();
+    return id;
+}
+
+void Scheduler::insert(const timer_id id,
+                       const uint64_t expires,
+                       const uint64_t earliest) {
+    const uint64_t top = SCHEDULER_SLOT_BITS * SCHEDULER_LEVELS;
+    uint64_t when = std::max(expires, earliest);
+    if ((when >> top) != (_now >> top)) {
+        // too far out, park in the slot of the top level visited last
+        when = ((_now >> top) << top) + (1ull << top) - 1;
+        if (when <= _now) {
+            when = _now + 1;
+        }
+    }
+
+    // lowest level where deadline and now only differ inside the level
+    int level = 0;
+    while (level < SCHEDULER_LEVELS - 1 &&
+           (when >> (SCHEDULER_SLOT_BITS * (level + 1))) !=
+           (_now >> (SCHEDULER_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    const size_t slot = (when >> (SCHEDULER_SLOT_BITS * level)) &
+        (SCHEDULER_SLOTS - 1);
+    _wheel[level][slot].push_back(id);
+}
+
+void Scheduler::advance(std::vector<timer_id>& due) {
+    _now++;
+
+    // cascade from the top so timers can fall through several levels
+    for (int level = SCHEDULER_LEVELS - 1; level > 0; level--) {
+        const uint64_t mask = (1ull << (SCHEDULER_SLOT_BITS * level)) - 1;
+        if (_now & mask) {
+            continue;
+        }
+        const size_t slot = (_now >> (SCHEDULER_SLOT_BITS * level)) &
+            (SCHEDULER_SLOTS - 1);
+        std::vector<timer_id> ids;
+        ids.swap(_wheel[level][slot]);
+        for (auto&& id : ids) {
+            auto it = _timers.find(id);
+            if (it != _timers.end()) {
+                // slot of the current tick is drained right after this
+                insert(id, it->second.expires, _now);
+            }
+        }
+    }
+
+    std::vector<timer_id>& slot = _wheel[0][_now & (SCHEDULER_SLOTS - 1)];
+    for (auto&& id : slot) {
+        auto it = _timers.find(id);
+        if (it == _timers.end()) {
+            continue;
+        }
+        if (it->second.expires > _now) {
+            // parked beyond the top level
+            insert(id, it->second.expires, _now + 1);
+            continue;
+        }
+        due.push_back(id);
+    }
+    slot.clear();
+}
+
+void Scheduler::run() {
+    std::vector<timer_id> due;
+    std::unique_lock<std::mutex> lk(_mutex);
+    while (!_stop) {
+        if (_timers.empty()) {
+            _cond.wait(lk);
+            continue;
+        }
+
+        _cond.wait_until(lk, _start + _tick * static_cast<int64_t>(_now + 1));
+        if (_stop) {
+            break;
+        }
+
+        uint64_t elapsed = (std::chrono::steady_clock::now() - _start) / _tick;
+        while (_now < elapsed) {
+            advance(due);
+        }
+
+        for (auto&& id : due) {
+            auto it = _timers.find(id);
+            if (it == _timers.end()) {
+                continue;
+            }
+
+            std::function<void ()> task = it->second.task;
+            if (it->second.period) {
+                // skip runs missed while the thread was busy
+                timer& t = it->second;
+                while (t.expires <= _now) {
+                    t.expires += t.period;
+                }
+                insert(id, t.expires, _now + 1);
+            }
+            else {
+                _timers.erase(it);
+            }
+
+            _running = id;
+            lk.unlock();
+            try {
+                task();
+            }
+            catch (std::exception& e) {
+                LOG_CRT << "Scheduled task failed because " << e.what();
+            }
+            lk.lock();
+            _running = 0;
+            _task_done.notify_all();
+        }
+        due.clear();
+    }
+    LOG_INF << "Scheduler ended";
+}
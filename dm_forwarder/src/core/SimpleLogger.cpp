@@ -21,10 +21,276 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
-#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <condition_variable>
 #include "core/SimpleLogger.h"
 
+namespace {
+
+/**
+ * Single producer, single consumer ring of one thread
+ *
+ * The owning thread reserves slots, the writer frees them by moving tail.
+ * Slots are published through their ready flag, so a statement that logs
+ * while evaluating the arguments of another one does not corrupt it.
+ */
+struct log_ring {
+    // producer only
+    uint64_t reserve = 0;
+    // keep tail off the cache line the producer writes
+    char pad[64];
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    log_record slots[LOG_RING_SLOTS];
+
+    log_ring() : tail(0), dropped(0) {
+        for (auto&& slot : slots) {
+            slot.ready = false;
+        }
+    }
+};
+
+class LogWriter {
+    public:
+        static LogWriter& instance() {
+            // never destroyed, threads may log while the process exits
+            static LogWriter* writer = new LogWriter();
+            return *writer;
+        }
+
+        void add(const std::shared_ptr<log_ring>& ring) {
+            std::lock_guard<std::mutex> lk(_rings_mutex);
+            _rings.push_back(ring);
+        }
+
+        void open(const std::string& filepath, const std::string& filename) {
+            std::lock_guard<std::mutex> lk(_file_mutex);
+            drain();
+            if (_file) {
+                fclose(_file);
+                _file = nullptr;
+            }
+            _path = filepath;
+            _name = filename;
+            _index = 0;
+            open_file();
+
+            if (!_writer.joinable()) {
+                _writer = std::thread(&LogWriter::run, this);
+                std::atexit([]() { LogWriter::instance().stop(); });
+            }
+        }
+
+        void flush() {
+            std::lock_guard<std::mutex> lk(_file_mutex);
+            drain();
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lk(_file_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            if (_writer.joinable()) {
+                _writer.join();
+            }
+            std::lock_guard<std::mutex> lk(_file_mutex);
+            drain();
+            if (_file) {
+                fclose(_file);
+                _file = nullptr;
+            }
+        }
+
+    private:
+        std::mutex _rings_mutex;
+        std::vector<std::shared_ptr<log_ring>> _rings;
+
+        // guards everything below
+        std::mutex _file_mutex;
+        std::condition_variable _cond;
+        bool _stop = false;
+        FILE* _file = nullptr;
+        std::string _path;
+        std::string _name;
+        int _index = 0;
+        size_t _written = 0;
+        std::thread _writer;
+
+        // reused between passes
+        std::vector<log_record*> _batch;
+        std::string _out;
+        time_t _second = 0;
+        char _date[32];
+
+        LogWriter() {}
+
+        std::string file_name(const int index) {
+            return _path + "/" + _name + ".log." + std::to_string(index);
+        }
+
+        void open_file() {
+            const std::string name = file_name(_index);
+            _file = fopen(name.c_str(), "a");
+            if (!_file) {
+                std::cout << "[CRITICAL] Cannot create log file " << _name
+                    << " at " << _path << " because " << strerror(errno)
+                    << std::endl;
+                return;
+            }
+            _written = ftell(_file);
+
+            std::string old = file_name(_index - LOG_MAX_FILES);
+            std::remove(old.c_str());
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lk(_file_mutex);
+            while (!_stop) {
+                _cond.wait_for(lk, std::chrono::milliseconds(LOG_FLUSH_MS));
+                drain();
+            }
+        }
+
+        void format(const log_record& r) {
+            const time_t second = r.time / 1000000000;
+            if (second != _second) {
+                struct tm t;
+                gmtime_r(&second, &t);
+                strftime(_date, sizeof(_date), "%Y-%m-%d %H:%M:%S", &t);
+                _second = second;
+            }
+
+            const char* file = strrchr(r.file, '/');
+            file = file ? file + 1 : r.file;
+
+            static const char* levels[] = {
+                "debug",
+                "info",
+                "critical",
+                "warning"
+            };
+
+            char head[160];
+            int n = snprintf(head, sizeof(head), "%-10s%s.%06ld    %-30s%-30s%-5d    ",
+                    levels[r.level], _date, (long) (r.time % 1000000000) / 1000,
+                    file, r.function, r.line);
+            _out.append(head, std::min(n, (int) sizeof(head) - 1));
+            _out.append(r.message, r.size);
+            _out.push_back('\n');
+        }
+
+        // caller holds _file_mutex
+        void drain() {
+            std::vector<std::shared_ptr<log_ring>> rings;
+            {
+                std::lock_guard<std::mutex> lk(_rings_mutex);
+                rings = _rings;
+            }
+
+            _batch.clear();
+            std::vector<uint64_t> ends(rings.size());
+            uint64_t dropped = 0;
+            for (size_t i = 0; i < rings.size(); i++) {
+                log_ring& ring = *rings[i];
+                const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+                uint64_t t = tail;
+                while (t - tail < LOG_RING_SLOTS) {
+                    log_record& r = ring.slots[t % LOG_RING_SLOTS];
+                    if (!r.ready.load(std::memory_order_acquire)) {
+                        break;
+                    }
+                    _batch.push_back(&r);
+                    t++;
+                }
+                ends[i] = t;
+                dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+            }
+
+            // threads are merged back into one timeline
+            std::stable_sort(_batch.begin(), _batch.end(),
+                    [](const log_record* a, const log_record* b) {
+                return a->time < b->time;
+            });
+
+            _out.clear();
+            for (auto&& r : _batch) {
+                format(*r);
+                r->ready.store(false, std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < rings.size(); i++) {
+                rings[i]->tail.store(ends[i], std::memory_order_release);
+            }
+
+            if (dropped) {
+                LogLine(warning, __FILE__, __FUNCTION__, __LINE__)
+                    << "Logger dropped " << dropped
+                    << " records because thread rings were full";
+            }
+
+            if (_file && !_out.empty()) {
+                fwrite(_out.data(), 1, _out.size(), _file);
+                fflush(_file);
+                _written += _out.size();
+                if (_written >= LOG_ROTATION_SIZE) {
+                    fclose(_file);
+                    _index++;
+                    open_file();
+                }
+            }
+
+            // rings of exited threads go away once they are empty
+            std::lock_guard<std::mutex> lk(_rings_mutex);
+            for (auto it = _rings.begin(); it != _rings.end();) {
+                log_ring& ring = **it;
+                const bool empty = !ring.slots[ring.tail % LOG_RING_SLOTS].ready;
+                if (it->use_count() == 2 && empty) {
+                    it = _rings.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+};
+
+// owner keeps the ring registered until the thread exits, the raw pointer is
+// what the hot path reads
+struct ring_owner {
+    std::shared_ptr<log_ring> ring;
+    ~ring_owner();
+};
+
+thread_local log_ring* t_ring = nullptr;
+thread_local bool t_ring_gone = false;
+thread_local ring_owner t_owner;
+
+ring_owner::~ring_owner() {
+    t_ring = nullptr;
+    t_ring_gone = true;
+}
+
+log_ring* local_ring() {
+    if (!t_ring && !t_ring_gone) {
+        t_owner.ring = std::make_shared<log_ring>();
+        LogWriter::instance().add(t_owner.ring);
+        t_ring = t_owner.ring.get();
+    }
+    return t_ring;
+}
+
+} // namespace
+
 std::ostream& operator<< (std::ostream& strm, severity_level level) {
     static const char* log_levels[] = {
         "debug",
@@ -43,33 +309,160 @@ std::ostream& operator<< (std::ostream& strm, severity_level level) {
 }
 
 void init_log(const std::string& filepath, const std::string& filename) {
-    try {
-        logging::add_common_attributes();
-        logging::core::get()->add_global_attribute("UTCTime", attrs::utc_clock());
-        boost::shared_ptr< file_sink > sink(new file_sink(
-            keywords::file_name = filepath + "/" + filename + ".log.%N",
-            keywords::rotation_size = 1 * 1024 * 1024,
-            keywords::auto_flush = true,
-            keywords::open_mode = std::ios_base::app
-        ));
-
-        sink->set_formatter(
-            expr::stream
-                << std::left
-                << std::setw(10) << std::setfill(' ') << severity
-                << expr::format_date_time< boost::posix_time::ptime >("UTCTime", "%Y-%m-%d %H:%M:%S.%f")
-                << expr::smessage
-        );
-
-        sink->locked_backend()->set_file_collector(sinks::file::make_collector(
-            keywords::target = filepath,
-            keywords::max_files = 10
-        ));
-
-        logging::core::get()->add_sink(sink);
+    LogWriter::instance().open(filepath, filename);
+}
+
+void flush_log() {
+    LogWriter::instance().flush();
+}
+
+LogLine::LogLine(const severity_level level,
+                 const char* file,
+                 const char* function,
+                 const int line) : _record(nullptr) {
+    log_ring* ring = local_ring();
+    if (!ring) {
+        return;
+    }
+
+    if (ring->reserve - ring->tail.load(std::memory_order_acquire) >=
+            LOG_RING_SLOTS) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    catch (boost::filesystem::filesystem_error& e) {
-        std::cout << "[CRITICAL] Cannot create log file " << filename << " at " << filepath
-            << " because " << e.code().message() << std::endl;
+
+    _record = &ring->slots[ring->reserve++ % LOG_RING_SLOTS];
+    _record->time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    _record->file = file;
+    _record->function = function;
+    _record->line = line;
+    _record->level = level;
+    _record->size = 0;
+}
+
+LogLine::~LogLine() {
+    if (_record) {
+        _record->ready.store(true, std::memory_order_release);
+    }
+}
+
+void LogLine::append(const char* s, const size_t n) {
+    if (!_record) {
+        return;
+    }
+    const size_t room = LOG_MESSAGE_SIZE - _record->size;
+    if (n > room) {
+        memcpy(_record->message + _record->size, s, room);
+        _record->size = LOG_MESSAGE_SIZE;
+        memcpy(_record->message + LOG_MESSAGE_SIZE - 3, "...", 3);
+        return;
+    }
+    memcpy(_record->message + _record->size, s, n);
+    _record->size += n;
+}
+
+void LogLine::append_integer(const unsigned long long v, const bool negative) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    unsigned long long x = v;
+    do {
+        *--p = '0' + x % 10;
+        x /= 10;
+    } while (x);
+    if (negative) {
+        *--p = '-';
+    }
+    append(p, end - p);
+}
+
+LogLine& LogLine::operator<<(const char* s) {
+    if (_record) {
+        append(s ? s : "(null)", strlen(s ? s : "(null)"));
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const std::string& s) {
+    append(s.data(), s.size());
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const char c) {
+    append(&c, 1);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const bool b) {
+    append(b ? "1" : "0", 1);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const int v) {
+    return *this << (long long) v;
+}
+
+LogLine& LogLine::operator<<(const long v) {
+    return *this << (long long) v;
+}
+
+LogLine& LogLine::operator<<(const long long v) {
+    if (_record) {
+        // negate in unsigned so that the minimum value does not overflow
+        append_integer(v < 0 ? 0ull - (unsigned long long) v : v, v < 0);
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const unsigned int v) {
+    return *this << (unsigned long long) v;
+}
+
+LogLine& LogLine::operator<<(const unsigned long v) {
+    return *this << (unsigned long long) v;
+}
+
+LogLine& LogLine::operator<<(const unsigned long long v) {
+    if (_record) {
+        append_integer(v, false);
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const double v) {
+    if (_record) {
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "%g", v);
+        append(buf, std::min(n, (int) sizeof(buf) - 1));
+    }
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const severity_level v) {
+    static const char* levels[] = {
+        "debug",
+        "info",
+        "critical",
+        "warning"
+    };
+    return *this << levels[v];
+}
+
+LogLine& LogLine::operator<<(std::ostream& (*)(std::ostream&)) {
+    return *this;
+}
+
+bool log_every_n(std::atomic<uint64_t>& count, const uint64_t n) {
+    return count.fetch_add(1, std::memory_order_relaxed) % (n ? n : 1) == 0;
+}
+
+bool log_every_ms(std::atomic<int64_t>& last, const int64_t ms) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t prev = last.load(std::memory_order_relaxed);
+    if (prev && now - prev < ms) {
+        return false;
     }
+    return last.compare_exchange_strong(prev, now);
 }
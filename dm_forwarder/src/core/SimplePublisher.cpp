@@ -41,6 +41,7 @@ void SimplePublisher::publish_message(const std::string& queue,
     AmqpClient::BasicMessage::ptr_t message =
         AmqpClient::BasicMessage::Create(body);
     try {
+        std::lock_guard<std::mutex> lk(_mutex);
         _channel->BasicPublish("", queue, message);
     }
     catch (std::exception& e) {
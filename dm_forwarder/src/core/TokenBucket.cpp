@@ -0,0 +1,62 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <algorithm>
+#include <core/TokenBucket.h>
+
+TokenBucket::TokenBucket(const uint64_t rate, const uint64_t burst) :
+        _rate{rate},
+        _burst{burst},
+        _tokens(burst),
+        _last(std::chrono::steady_clock::now()) {
+}
+
+uint64_t TokenBucket::take(const uint64_t tokens) {
+    if (!_rate) {
+        return 0;
+    }
+
+    std::chrono::microseconds wait(0);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - _last).count();
+        _tokens = std::min<double>(_burst, _tokens + elapsed * _rate);
+        _last = now;
+
+        // callers after this one wait for the debt as well
+        _tokens -= tokens;
+        if (_tokens < 0) {
+            wait = std::chrono::microseconds(
+                    static_cast<int64_t>(-_tokens * 1000000 / _rate));
+        }
+    }
+
+    std::this_thread::sleep_for(wait);
+    return wait.count();
+}
+
+uint64_t TokenBucket::rate() {
+    return _rate;
+}
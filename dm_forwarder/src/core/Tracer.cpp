@@ -0,0 +1,210 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/Tracer.h>
+
+namespace {
+
+/**
+ * Marks the thread's buffer as exited so the next start can drop it
+ */
+struct local_buffer {
+    std::shared_ptr<trace_buffer> buffer;
+
+    ~local_buffer() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lk(buffer->mutex);
+            buffer->exited = true;
+        }
+    }
+};
+
+thread_local local_buffer tls;
+
+void write_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (auto&& c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}
+
+Tracer& Tracer::instance() {
+    // leaked so that threads ending during exit can still record
+    static Tracer* tracer = new Tracer();
+    return *tracer;
+}
+
+Tracer::Tracer() :
+        _enabled{false},
+        _epoch(std::chrono::steady_clock::now()),
+        _next_tid(1) {
+}
+
+void Tracer::start() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto it = _buffers.begin(); it != _buffers.end(); ) {
+        std::lock_guard<std::mutex> buf_lk((*it)->mutex);
+        if ((*it)->exited) {
+            it = _buffers.erase(it);
+            continue;
+        }
+        (*it)->events.clear();
+        (*it)->dropped = 0;
+        ++it;
+    }
+    _enabled = true;
+    LOG_INF << "Tracing started";
+}
+
+void Tracer::stop() {
+    _enabled = false;
+    LOG_INF << "Tracing stopped";
+}
+
+trace_buffer& Tracer::local() {
+    if (!tls.buffer) {
+        tls.buffer = std::make_shared<trace_buffer>();
+        tls.buffer->exited = false;
+        tls.buffer->dropped = 0;
+
+        std::lock_guard<std::mutex> lk(_mutex);
+        tls.buffer->tid = _next_tid++;
+        _buffers.push_back(tls.buffer);
+    }
+    return *tls.buffer;
+}
+
+void Tracer::name_thread(const std::string& name) {
+    trace_buffer& buf = local();
+    std::lock_guard<std::mutex> lk(buf.mutex);
+    buf.name = name;
+}
+
+void Tracer::record(trace_event&& event) {
+    trace_buffer& buf = local();
+    std::lock_guard<std::mutex> lk(buf.mutex);
+    if (buf.events.size() >= TRACE_MAX_EVENTS) {
+        buf.dropped++;
+        return;
+    }
+    buf.events.push_back(std::move(event));
+}
+
+uint64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - _epoch).count();
+}
+
+void Tracer::dump(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::ostringstream err;
+        err << "Cannot open trace file " << path;
+        LOG_CRT << err.str();
+        throw L1::CannotOpenFile(err.str());
+    }
+
+    const int pid = getpid();
+    size_t written = 0;
+    uint64_t dropped = 0;
+    bool first = true;
+
+    out << "{\"traceEvents\":[";
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto&& buf : _buffers) {
+        std::lock_guard<std::mutex> buf_lk(buf->mutex);
+        if (!buf->name.empty()) {
+            out << (first ? "\n" : ",\n")
+                << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+                << ",\"tid\":" << buf->tid << ",\"args\":{\"name\":";
+            write_string(out, buf->name);
+            out << "}}";
+            first = false;
+        }
+
+        for (auto&& e : buf->events) {
+            out << (first ? "\n" : ",\n")
+                << "{\"ph\":\"X\",\"name\":";
+            write_string(out, e.name);
+            out << ",\"pid\":" << pid << ",\"tid\":" << buf->tid
+                << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+                << ",\"args\":{\"image\":";
+            write_string(out, e.image);
+            out << ",\"location\":";
+            write_string(out, e.location);
+            out << "}}";
+            first = false;
+        }
+        written += buf->events.size();
+        dropped += buf->dropped;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    LOG_INF << "Wrote " << written << " trace events to " << path;
+    if (dropped) {
+        LOG_WRN << "Dropped " << dropped << " trace events because thread "
+                << "buffers were full";
+    }
+}
+
+TraceSpan::TraceSpan(const char* name,
+                     const std::string& image,
+                     const std::string& location) :
+        _on(Tracer::instance().enabled()),
+        _name(name),
+        _start(0) {
+    if (_on) {
+        _image = image;
+        _location = location;
+        _start = Tracer::instance().now();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    stop();
+}
+
+void TraceSpan::stop() {
+    if (_on) {
+        _on = false;
+        Tracer& tracer = Tracer::instance();
+        tracer.record(trace_event{ _name, std::move(_image),
+                std::move(_location), _start, tracer.now() - _start });
+    }
+}
@@ -21,65 +21,63 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <sstream>
-#include <thread>
-#include <chrono>
 #include "core/HeartBeat.h"
-#include "core/RedisConnection.h"
-#include "core/Exceptions.h"
 #include "core/SimpleLogger.h"
 
-void Watcher::start(const heartbeat_params params) {
+Watcher::Watcher(Scheduler& scheduler, AsyncRedis& redis) :
+        _scheduler(scheduler),
+        _redis(redis),
+        _timer(0),
+        _generation(0) {
+}
+
+Watcher::~Watcher() {
     clear();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+}
+
+void Watcher::start(const heartbeat_params params) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _scheduler.cancel(_timer);
+    const uint64_t generation = ++_generation;
 
-    _stop = false;
-    std::thread t(&Watcher::check, this, params);
-    t.detach();
+    _timer = _scheduler.every(std::chrono::seconds(params.seconds_to_expire),
+            [this, params, generation]() {
+        check(params, generation);
+    }, std::chrono::milliseconds(0));
+    LOG_INF << "Watcher started";
 }
 
 void Watcher::clear() {
     std::lock_guard<std::mutex> lk(_mutex);
-    _stop = true;
-    _cond.notify_all();
+    _scheduler.cancel(_timer);
+    ++_generation;
 }
 
-void Watcher::check(const heartbeat_params params) {
-    const std::string host = params.redis_params.host;
-    const int port = params.redis_params.port;
-    const int db = params.redis_params.db;
-
-    const std::string key = params.key;
-    const int timeout = params.seconds_to_expire;
-    auto execute = params.action;
-
-    try {
-        RedisConnection redis(host, port, db);
-        LOG_INF << "Watcher started";
-        while (!_stop.load()) {
-            redis.exists(key);
-            std::vector<Reply> reply = redis.exec();
-            bool exists = reply[0].integer;
+void Watcher::check(const heartbeat_params& params,
+                    const uint64_t generation) {
+    _redis.send({ "exists", params.key }, [this, params, generation](
+                const std::string& error, const Reply& reply) {
+        if (!error.empty()) {
+            LOG_CRT << "Watcher cannot check " << params.key << " because "
+                    << error;
+            return;
+        }
+        if (reply.integer) {
+            return;
+        }
 
-            if (!exists) {
-                LOG_CRT << "Did not receive heartbeat from Commandable SAL"
-                    << " Component(CSC)";
-                execute();
-                break;
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (generation != _generation) {
+                return;
             }
-
-            std::unique_lock<std::mutex> lk(_mutex);
-            std::cv_status status = _cond.wait_for(lk,
-                    std::chrono::seconds(timeout));
+            _scheduler.cancel(_timer);
+            ++_generation;
         }
-    }
-    catch(L1::RedisError& e) {
-        LOG_CRT << "Cannot start Watcher because " << e.what();
-        return;
-    }
-    catch(std::exception& e) {
-        LOG_CRT << "Cannot start Watcher because " << e.what();
-        return;
-    }
-    LOG_CRT << "Watcher ended";
+
+        LOG_CRT << "Did not receive heartbeat from Commandable SAL"
+            << " Component(CSC)";
+        params.action();
+        LOG_CRT << "Watcher ended";
+    });
 }
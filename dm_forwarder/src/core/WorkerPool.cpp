@@ -0,0 +1,117 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <core/SimpleLogger.h>
+#include <core/Tracer.h>
+#include <core/WorkerPool.h>
+
+struct WorkerPool::batch {
+    size_t pending;
+    std::exception_ptr error;
+};
+
+WorkerPool::WorkerPool(const std::string& name, const int threads) :
+        _name{name},
+        _stop{false} {
+    for (int i = 0; i < threads; i++) {
+        _workers.push_back(std::thread(&WorkerPool::work, this));
+    }
+    LOG_INF << "WorkerPool " << _name << " started with " << threads
+            << " threads";
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stop = true;
+        _not_empty.notify_all();
+    }
+    for (auto&& worker : _workers) {
+        worker.join();
+    }
+}
+
+int WorkerPool::size() {
+    return _workers.size();
+}
+
+void WorkerPool::run(std::vector<std::function<void ()>>& tasks) {
+    batch b = { tasks.size(), nullptr };
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (auto&& task : tasks) {
+        _jobs.push_back(job{ &task, &b });
+    }
+    _not_empty.notify_all();
+
+    // help until the queue is empty, then wait for tasks still running on
+    // workers
+    while (b.pending && !_jobs.empty()) {
+        job j = _jobs.front();
+        _jobs.pop_front();
+        execute(lk, j);
+    }
+    _done.wait(lk, [&b]() { return b.pending == 0; });
+
+    if (b.error) {
+        std::rethrow_exception(b.error);
+    }
+}
+
+void WorkerPool::execute(std::unique_lock<std::mutex>& lk, job& j) {
+    lk.unlock();
+    std::exception_ptr error;
+    try {
+        (*j.task)();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    lk.lock();
+
+    if (error && !j.owner->error) {
+        j.owner->error = error;
+    }
+    if (--j.owner->pending == 0) {
+        _done.notify_all();
+    }
+}
+
+void WorkerPool::work() {
+    Tracer::instance().name_thread(_name);
+    std::unique_lock<std::mutex> lk(_mutex);
+    while (true) {
+        _not_empty.wait(lk, [this]() {
+            return _stop || !_jobs.empty();
+        });
+
+        if (_stop) {
+            break;
+        }
+
+        job j = _jobs.front();
+        _jobs.pop_front();
+        execute(lk, j);
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <daq/ArrivalIndex.h>
+
+ArrivalIndex::ArrivalIndex(const size_t capacity) :
+        _capacity(capacity > 0 ? capacity : 1) {
+}
+
+std::string ArrivalIndex::key(const std::string& image_id,
+                              const std::string& folder) {
+    return folder + "/" + image_id;
+}
+
+void ArrivalIndex::set(const std::string& k, const STATE state) {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        auto it = _images.find(k);
+        if (it != _images.end()) {
+            it->second = state;
+        }
+        else {
+            _images.emplace(k, state);
+            _order.push_back(k);
+            while (_order.size() > _capacity) {
+                _images.erase(_order.front());
+                _order.pop_front();
+            }
+        }
+    }
+    _cond.notify_all();
+}
+
+void ArrivalIndex::arrived(const std::string& image_id,
+                           const std::string& folder) {
+    set(key(image_id, folder), STATE::ARRIVED);
+}
+
+void ArrivalIndex::complete(const std::string& image_id,
+                            const std::string& folder) {
+    set(key(image_id, folder), STATE::COMPLETE);
+}
+
+void ArrivalIndex::failed(const std::string& image_id,
+                          const std::string& folder) {
+    set(key(image_id, folder), STATE::FAILED);
+}
+
+bool ArrivalIndex::ready(const std::string& image_id,
+                         const std::string& folder) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _images.find(key(image_id, folder));
+    return it != _images.end() && it->second == STATE::COMPLETE;
+}
+
+bool ArrivalIndex::wait(const std::string& image_id,
+                        const std::string& folder,
+                        const std::chrono::microseconds timeout) {
+    const std::string k = key(image_id, folder);
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    _cond.wait_for(lk, timeout, [this, &k]() {
+        auto it = _images.find(k);
+        return it != _images.end() && it->second != STATE::ARRIVED;
+    });
+
+    auto it = _images.find(k);
+    return it != _images.end() && it->second == STATE::COMPLETE;
+}
+
+size_t ArrivalIndex::size() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _images.size();
+}
@@ -33,15 +33,20 @@
 
 #define SAMPLES 195072
 
-DAQDecoder::DAQDecoder(IMS::Image& img, const DAQ::LocationSet& filter)
+DAQDecoder::DAQDecoder(IMS::Image& img,
+                       const DAQ::LocationSet& filter,
+                       PixelPool* pool)
       : IMS::Decoder(img, filter) {
     _samples = 0;
+    _bytes = 0;
+    _pool = pool;
 }
 
 void DAQDecoder::process(IMS::Science::Source& source,
                          uint64_t length,
                          uint64_t offset) {
     _samples += IMS::Science::Data::samples(length);
+    _bytes += length;
 
     uint64_t QUANTA = IMS::Science::Data::bytes(SAMPLES);
     uint64_t remaining = length;
@@ -50,7 +55,7 @@ void DAQDecoder::process(IMS::Science::Source& source,
         uint64_t quanta = remaining > QUANTA ? QUANTA : remaining;
         uint64_t current_samples = IMS::Science::Data::samples(quanta);
 
-        ScienceBuffer buffer(current_samples);
+        ScienceBuffer buffer(current_samples, _pool);
         Data ccds = buffer.process(source);
         _data.push_back(ccds);
 
@@ -63,6 +68,7 @@ void DAQDecoder::process(IMS::Guiding::Source& source,
                            uint64_t length,
                            uint64_t offset) {
     _samples += IMS::Guiding::Data::samples(length);
+    _bytes += length;
 
     uint64_t QUANTA = IMS::Guiding::Data::bytes(SAMPLES);
     uint64_t remaining = length;
@@ -71,7 +77,7 @@ void DAQDecoder::process(IMS::Guiding::Source& source,
         uint64_t quanta = remaining > QUANTA ? QUANTA : remaining;
         uint64_t current_samples = IMS::Guiding::Data::samples(quanta);
 
-        GuidingBuffer buffer(current_samples);
+        GuidingBuffer buffer(current_samples, _pool);
         Data ccds = buffer.process(source);
         _data.push_back(ccds);
 
@@ -84,6 +90,7 @@ void DAQDecoder::process(IMS::Wavefront::Source& source,
                            uint64_t length,
                            uint64_t offset) {
     _samples += IMS::Wavefront::Data::samples(length);
+    _bytes += length;
 
     uint64_t QUANTA = IMS::Wavefront::Data::bytes(SAMPLES);
     uint64_t remaining = length;
@@ -92,7 +99,7 @@ void DAQDecoder::process(IMS::Wavefront::Source& source,
         uint64_t quanta = remaining > QUANTA ? QUANTA : remaining;
         uint64_t current_samples = IMS::Wavefront::Data::samples(quanta);
 
-        WavefrontBuffer buffer(current_samples);
+        WavefrontBuffer buffer(current_samples, _pool);
         Data ccds = buffer.process(source);
         _data.push_back(ccds);
 
@@ -105,6 +112,10 @@ uint64_t DAQDecoder::samples() {
     return _samples;
 }
 
+uint64_t DAQDecoder::bytes() {
+    return _bytes;
+}
+
 std::vector<Data> DAQDecoder::data() {
     return _data;
 }
@@ -25,30 +25,65 @@
 #include <future>
 #include <ims/Image.hh>
 #include <core/Exceptions.h>
+#include <core/Metrics.h>
+#include <core/Tracer.h>
 #include <core/SimpleLogger.h>
 #include <forwarder/Formatter.h>
+#include <forwarder/ImageCost.h>
 #include <forwarder/ReadoutPattern.h>
 #include <daq/DAQDecoder.h>
 #include <daq/DAQFetcher.h>
+#include <daq/Declutter.h>
 
 namespace fs = boost::filesystem;
 
 DAQFetcher::DAQFetcher(const std::string& partition,
                        const std::string& folder,
                        const std::vector<int>& data_segment,
-                       redis_connection_params params,
-                       const int xor_pattern) :
+                       const int xor_pattern,
+                       WorkerPool* pool,
+                       PixelPool* pixels) :
         _folder{folder},
         // Bug: Invalid partition name segfaults from DAQ
-        _store(partition.c_str()),
+        _store(new IMS::Store(partition.c_str())),
         _xor{xor_pattern},
-        _fmt(data_segment, params) {
+        _pool{pool},
+        _pixels{pixels},
+        _fmt(data_segment) {
 }
 
-void DAQFetcher::fetch(const fs::path& prefix,
-                       const std::string& image,
-                       const std::string& location) {
-    IMS::Id id = _store.catalog.lookup(image.c_str(), _folder.c_str());
+DAQFetcher::DAQFetcher(const std::vector<int>& data_segment,
+                       const int xor_pattern,
+                       WorkerPool* pool,
+                       PixelPool* pixels) :
+        _xor{xor_pattern},
+        _pool{pool},
+        _pixels{pixels},
+        _fmt(data_segment) {
+}
+
+std::vector<std::string> DAQFetcher::fetch(const fs::path& prefix,
+                                           const std::string& image,
+                                           const std::string& location) {
+    TraceSpan span("daq_fetch", image, location);
+    uint64_t samples = 0;
+    std::vector<Data> data = decode(image, location, samples);
+    return process(prefix, image, location, data, samples);
+}
+
+std::vector<Data> DAQFetcher::decode(const std::string& image,
+                                     const std::string& location,
+                                     uint64_t& samples) {
+    CpuTimer cpu(image);
+    if (!_store) {
+        std::ostringstream err;
+        err << "DAQFetcher for " << location << " has no DAQ store to read "
+            << "image " << image << " from";
+        LOG_CRT << err.str();
+        throw L1::CannotFetchPixel(err.str());
+    }
+
+    IMS::Id id = _store->catalog.lookup(image.c_str(), _folder.c_str());
     if (!id) {
         std::ostringstream err;
         err << "Folder " << _folder << " or Image " << image
@@ -57,7 +92,7 @@ void DAQFetcher::fetch(const fs::path& prefix,
         throw L1::CannotFetchPixel(err.str());
     }
 
-    IMS::Image img(id, _store);
+    IMS::Image img(id, *_store);
     if (!img) {
         std::ostringstream err;
         err << "Cannot create IMS::Image for " << image << " at location "
@@ -68,20 +103,14 @@ void DAQFetcher::fetch(const fs::path& prefix,
 
     DAQ::Location mine(location.c_str());
     DAQ::LocationSet filter(mine);
+    const std::string sensor_name = DAQ::Sensor::encode(
+            sensor_type(location));
 
-    DAQ::Sensor::Type sensor_type;
-    try {
-        sensor_type = ReadoutPattern::sensor(location);
-    }
-    catch (L1::InvalidLocation& e) {
-        std::ostringstream err;
-        err << "Location: " << location << ". " << e.what();
-        LOG_CRT << err.str();
-        throw L1::CannotFetchPixel(err.str());
-    }
-
-    DAQDecoder decoder(img, filter);
+    DAQDecoder decoder(img, filter, _pixels);
     try {
+        StageTimer timer(Metrics::instance().latency("decode", sensor_name,
+                    location));
+        TraceSpan decode_span("decode", image, location);
         decoder.run();
     }
     catch (L1::InvalidData& e) {
@@ -95,10 +124,39 @@ void DAQFetcher::fetch(const fs::path& prefix,
         LOG_CRT << err.str();
         throw L1::CannotFetchPixel(err.str());
     }
+    ImageCost::instance().add_daq(image, decoder.bytes());
 
-    std::vector<Data> data = decoder.data();
-    uint64_t samples = decoder.samples();
-    Pixel3d ccds = declutter(data, samples, sensor_type);
+    samples = decoder.samples();
+    return decoder.data();
+}
+
+std::vector<std::string> DAQFetcher::process(const fs::path& prefix,
+                                             const std::string& image,
+                                             const std::string& location,
+                                             std::vector<Data>& data,
+                                             const uint64_t samples) {
+    CpuTimer cpu(image);
+    ImageCost& cost = ImageCost::instance();
+    Metrics& metrics = Metrics::instance();
+    const std::string sensor_name = DAQ::Sensor::encode(
+            sensor_type(location));
+
+    if (data.empty()) {
+        std::ostringstream err;
+        err << "There is no data to process for image " << image
+            << " and location " << location;
+        LOG_CRT << err.str();
+        throw L1::CannotFetchPixel(err.str());
+    }
+
+    StageTimer declutter_timer(metrics.latency("declutter", sensor_name,
+                location));
+    TraceSpan declutter_span("declutter", image, location);
+    Pixel3d ccds = declutter(data, samples);
+    declutter_span.stop();
+    declutter_timer.stop();
+    PixelCharge charge(image, ccds.d1() * ccds.d2() * ccds.d3() *
+            sizeof(int32_t));
 
     // naxes calculation
     std::vector<long> axes = naxes(data[0], samples);
@@ -116,33 +174,53 @@ void DAQFetcher::fetch(const fs::path& prefix,
     new_location.replace(found, 1, "S");
     fs::path filename = prefix / fs::path(image + "-R" + new_location);
 
+    std::vector<std::string> files;
     try {
-        _fmt.write(image, ccds, naxes, filename.string());
+        // all ccds of the board are written in parallel
+        StageTimer timer(metrics.latency("write_pix_file", sensor_name,
+                    location));
+        TraceSpan write_span("write_pix", image, location);
+        files = _fmt.write(image, ccds, naxes, filename.string());
     }
     catch (L1::CannotFormatFitsfile& e) {
         throw L1::CannotFetchPixel(e.what());
     }
+
+    for (auto&& file : files) {
+        boost::system::error_code ec;
+        uintmax_t size = fs::file_size(file, ec);
+        if (!ec) {
+            cost.add_written(image, size);
+        }
+    }
+    return files;
+}
+
+DAQ::Sensor::Type DAQFetcher::sensor_type(const std::string& location) {
+    try {
+        return ReadoutPattern::sensor(location);
+    }
+    catch (L1::InvalidLocation& e) {
+        std::ostringstream err;
+        err << "Location: " << location << ". " << e.what();
+        LOG_CRT << err.str();
+        throw L1::CannotFetchPixel(err.str());
+    }
 }
 
-Pixel3d DAQFetcher::declutter(std::vector<Data>& data,
-                              uint64_t samples,
-                              DAQ::Sensor::Type sensor) {
+Pixel3d DAQFetcher::declutter(std::vector<Data>& data, uint64_t samples) {
     uint64_t segments = (unsigned) DAQ::Sensor::Segment::NUMOF;
-    uint64_t offset = 0;
-
-    Pixel3d pixels(sensor, segments, samples);
-    int32_t*** pix = pixels.get();
-
-    for (auto&& x : data) {
-        for (int i = 0; i < sensor; i++) {
-            for (int j = 0; j < x.samples(); j++) {
-                for (int k = 0; k < segments; k++) {
-                    pix[i][k][j+offset] = _xor ^ x.pixel(j, i, k);
-                }
-            }
+    int sensors = data[0].ccds();
+
+    Pixel3d pixels(sensors, segments, samples, _pixels);
+    std::vector<stripe_chunk> chunks(data.size());
+    for (size_t j = 0; j < data.size(); j++) {
+        for (int i = 0; i < sensors; i++) {
+            chunks[j].stripes.push_back(data[j].stripes(i));
         }
-        offset += x.samples();
+        chunks[j].samples = data[j].samples();
     }
+    declutter_chunks(pixels.get(), chunks, sensors, _xor, _pool);
     return pixels;
 }
 
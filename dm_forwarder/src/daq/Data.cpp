@@ -26,6 +26,10 @@
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
 #include <daq/Data.h>
+#include <daq/Declutter.h>
+
+static_assert(sizeof(IMS::Stripe) == DECLUTTER_SEGMENTS * sizeof(int32_t),
+        "IMS::Stripe must be one pixel per segment without padding");
 
 Data::Data(int num_ccds,
            int64_t samples,
@@ -43,6 +47,10 @@ int32_t Data::pixel(uint64_t index, int sensor, int segment) {
     return _pix[sensor][index].segment[segment];
 }
 
+const int32_t* Data::stripes(int sensor) {
+    return _pix[sensor].data()->segment;
+}
+
 std::vector<long> Data::naxes() {
     RMS::InstructionList instructions = _meta.instructions();
 
@@ -68,3 +76,7 @@ std::vector<long> Data::naxes() {
 int64_t Data::samples() {
     return _samples;
 }
+
+int Data::ccds() {
+    return _pix.size();
+}
@@ -0,0 +1,165 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <core/WorkerPool.h>
+#include <daq/Declutter.h>
+
+void declutter_stripes(int32_t*** pix,
+                       const int32_t* const* stripes,
+                       const int ccds,
+                       const int64_t samples,
+                       const uint64_t offset,
+                       const int32_t xor_pattern) {
+    for (int i = 0; i < ccds; i++) {
+        const int32_t* stripe = stripes[i];
+        int32_t** segments = pix[i];
+        for (int64_t j = 0; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                segments[k][j+offset] = xor_pattern ^ stripe[k];
+            }
+            stripe += DECLUTTER_SEGMENTS;
+        }
+    }
+}
+
+template <int CCDS>
+void declutter_ccds(int32_t*** pix,
+                    const int32_t* const* stripes,
+                    const int64_t samples,
+                    const uint64_t offset,
+                    const int32_t xor_pattern) {
+    for (int i = 0; i < CCDS; i++) {
+        const int32_t* stripe = stripes[i];
+        int32_t* segments[DECLUTTER_SEGMENTS];
+        for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+            segments[k] = pix[i][k] + offset;
+        }
+
+        // transpose a tile of stripes so that each segment is written as
+        // one contiguous run instead of scattering every pixel
+        int64_t j = 0;
+        for (; j + DECLUTTER_TILE <= samples; j += DECLUTTER_TILE) {
+            const int32_t* tile = stripe + j * DECLUTTER_SEGMENTS;
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                int32_t* dst = segments[k] + j;
+                for (int t = 0; t < DECLUTTER_TILE; t++) {
+                    dst[t] = xor_pattern ^ tile[t * DECLUTTER_SEGMENTS + k];
+                }
+            }
+        }
+
+        for (; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                segments[k][j] = xor_pattern ^
+                    stripe[j * DECLUTTER_SEGMENTS + k];
+            }
+        }
+    }
+}
+
+declutter_kernel declutter_for(const int ccds) {
+    switch (ccds) {
+        case 1: return &declutter_ccds<1>;
+        case 2: return &declutter_ccds<2>;
+        case 3: return &declutter_ccds<3>;
+        default: return nullptr;
+    }
+}
+
+/**
+ * Declutter samples [first, last) of the board with kernel, or the generic
+ * loop if there is none for ccds
+ */
+void declutter_range(int32_t*** pix,
+                     const std::vector<stripe_chunk>& chunks,
+                     const int ccds,
+                     const declutter_kernel kernel,
+                     const int32_t xor_pattern,
+                     const uint64_t first,
+                     const uint64_t last) {
+    std::vector<const int32_t*> stripes(ccds);
+    uint64_t offset = 0;
+    for (auto&& chunk : chunks) {
+        if (offset >= last) {
+            break;
+        }
+
+        uint64_t end = offset + chunk.samples;
+        uint64_t from = std::max(first, offset);
+        uint64_t to = std::min(last, end);
+        if (from < to) {
+            for (int i = 0; i < ccds; i++) {
+                stripes[i] = chunk.stripes[i] +
+                    (from - offset) * DECLUTTER_SEGMENTS;
+            }
+            if (kernel) {
+                kernel(pix, stripes.data(), to - from, from, xor_pattern);
+            }
+            else {
+                declutter_stripes(pix, stripes.data(), ccds, to - from, from,
+                        xor_pattern);
+            }
+        }
+        offset = end;
+    }
+}
+
+void declutter_chunks(int32_t*** pix,
+                      const std::vector<stripe_chunk>& chunks,
+                      const int ccds,
+                      const int32_t xor_pattern,
+                      WorkerPool* pool) {
+    uint64_t samples = 0;
+    for (auto&& chunk : chunks) {
+        samples += chunk.samples;
+    }
+
+    uint64_t tasks = 1;
+    if (pool) {
+        tasks = std::min<uint64_t>(pool->size() + 1,
+                samples / DECLUTTER_TASK_SAMPLES);
+    }
+
+    // chosen once for every range of the location
+    const declutter_kernel kernel = declutter_for(ccds);
+    if (tasks < 2) {
+        declutter_range(pix, chunks, ccds, kernel, xor_pattern, 0, samples);
+        return;
+    }
+
+    uint64_t block = (samples + tasks - 1) / tasks;
+    block = (block + DECLUTTER_TILE - 1) / DECLUTTER_TILE * DECLUTTER_TILE;
+
+    std::vector<std::function<void ()>> jobs;
+    for (uint64_t first = 0; first < samples; first += block) {
+        uint64_t last = std::min(samples, first + block);
+        jobs.push_back([&chunks, pix, ccds, kernel, xor_pattern, first,
+                    last]() {
+            declutter_range(pix, chunks, ccds, kernel, xor_pattern, first,
+                    last);
+        });
+    }
+    pool->run(jobs);
+}
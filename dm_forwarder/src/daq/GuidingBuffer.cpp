@@ -26,18 +26,21 @@
 #include "core/SimpleLogger.h"
 #include "daq/GuidingBuffer.h"
 
-GuidingBuffer::GuidingBuffer(int64_t samples) :
+GuidingBuffer::GuidingBuffer(int64_t samples, PixelPool* pool) :
         _samples{samples},
-        _buffer(new char[IMS::Guiding::Data::bytes(samples)]),
+        _buffer(static_cast<char*>(pixel_alloc(pool,
+                    IMS::Guiding::Data::bytes(samples)))),
         _data(_buffer, samples),
-        _ccds(new IMS::Stripe[samples * 2]) {
+        _ccds(static_cast<IMS::Stripe*>(pixel_alloc(pool,
+                    samples * 2 * sizeof(IMS::Stripe)))),
+        _pool{pool} {
     _ccd[0] = _ccds;
     _ccd[1] = _ccds + samples;
 }
 
 GuidingBuffer::~GuidingBuffer() {
-    delete[] _buffer;
-    delete[] _ccds;
+    pixel_free(_pool, _buffer, IMS::Guiding::Data::bytes(_samples));
+    pixel_free(_pool, _ccds, _samples * 2 * sizeof(IMS::Stripe));
 }
 
 Data GuidingBuffer::process(IMS::Guiding::Source& source) {
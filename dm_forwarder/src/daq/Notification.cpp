@@ -21,6 +21,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
 #include <ims/Image.hh>
 #include <ims/ImageMetadata.hh>
 #include <ims/Barrier.hh>
@@ -28,14 +29,35 @@
 #include <core/SimpleLogger.h>
 #include <daq/Notification.h>
 
-Notification::Notification(const std::string partition, int barrier_timeout) {
+Notification::Notification(const std::string partition,
+                           int barrier_timeout,
+                           const size_t index_size) :
+        _listening{false},
+        _restart{false},
+        _stop{false},
+        _index(index_size) {
     _barrier_timeout = barrier_timeout;
     _store = std::unique_ptr<IMS::Store>(new IMS::Store(partition.c_str()));
     _stream = std::unique_ptr<IMS::Stream>(new IMS::Stream(*_store,
                 _barrier_timeout));
 }
 
+Notification::~Notification() {
+    _stop = true;
+    if (_listener.joinable()) {
+        _listener.join();
+    }
+}
+
 void Notification::start() {
+    if (_listening) {
+        // stream belongs to the listener thread, it reopens the stream
+        // before reading the next image
+        _restart = true;
+        LOG_INF << "Notification stream restart requested from listener";
+        return;
+    }
+
     _stream.reset();
     _stream = std::unique_ptr<IMS::Stream>(new IMS::Stream(*_store,
                 _barrier_timeout));
@@ -48,64 +70,80 @@ void Notification::block(Info::MODE mode, const std::string image_id, const std:
         return;
     }
 
-    // We make the assumption that we open the stream on start up of the Forwarder.  This
-    // is before getting an endReadout (which calls this method), so we can't be 
-    // "ahead" of reading the data coming from the stream, only behind. Any images that
-    // were on the stream that we skip will be handled by the catchup archiver.
-    //
-    while (true) {
-        //
-        // Call IMS::IMAGE to attempt to set up an image from the stream. If the image 
-        // is null, there were no pending images after TIMEOUT so we thrown an exception.
-        //
-        LOG_DBG << "Trying to read stream to find image " << image_id;
-        IMS::Image image(*_store, *_stream, _barrier_timeout);
-        if (!image)  {
-            std::ostringstream err;
-            err << "Wasn't able to read image in "<< _barrier_timeout << " microseconds";
-            LOG_CRT << err.str();
-            throw L1::CannotFetchPixel(err.str());
+    if (!_listening) {
+        listen(nullptr);
+    }
+
+    LOG_DBG << "Waiting for listener to complete image " << image_id;
+    if (!_index.wait(image_id, folder,
+                std::chrono::microseconds(_barrier_timeout))) {
+        std::ostringstream err;
+        err << "image " << image_id << " was not seen complete by listener "
+            << "after " << _barrier_timeout << " microseconds";
+        LOG_CRT << err.str();
+        throw L1::CannotFetchPixel(err.str());
+    }
+    LOG_DBG << "Listener completed image " << image_id;
+}
+
+void Notification::listen(std::function<void (const std::string&,
+                                              const std::string&)> on_image) {
+    if (_listening) {
+        LOG_WRN << "Notification listener is already running";
+        return;
+    }
+
+    _on_image = on_image;
+    _listening = true;
+    _listener = std::thread(&Notification::run, this);
+    LOG_INF << "Notification listener started";
+}
+
+bool Notification::ready(const std::string image_id,
+                         const std::string folder) {
+    return _index.ready(image_id, folder);
+}
+
+void Notification::run() {
+    while (!_stop.load()) {
+        if (_restart.exchange(false)) {
+            _stream.reset();
+            _stream = std::unique_ptr<IMS::Stream>(new IMS::Stream(*_store,
+                        _barrier_timeout));
+            LOG_INF << "Notification stream restarted by listener";
         }
 
-        //
-        // Examine the metadata.  If it doesn't match, move on and try
-        // to read next image; not matching can happen if we didn't get an endReadout
-        // about an image that made it onto the stream, which in practice means the stream
-        // has two or more images pending to read; print out a message and continue 
-        // with the loop.
-        //
-        LOG_DBG << "Acquired image ";
-    
-        IMS::ImageMetadata meta = image.metadata();
-        std::string meta_name = std::string(meta.name());
-        std::string meta_folder = std::string(meta.folder());
-        LOG_INF << "dumping elements(); check stdout";
-        LOG_INF << "number of elements in image.metadata.elements() is " <<  image.metadata().elements().numof();
-        image.metadata().elements().dump();
-    
-        if (meta_name != image_id || meta_folder != folder) {
-            LOG_INF << "Currently streaming image " << meta_name << " in "
-                    << meta_folder << " is not what is being expected "
-                    << image_id << " from " << folder;
+        // returns null image if nothing shows up within the timeout
+        IMS::Image image(*_store, *_stream, _barrier_timeout);
+        if (!image) {
             continue;
         }
-    
-        // We have the Image, the metadata matches, so now we block for the pixels.
-        LOG_DBG << "Barrier blocking for image " << image_id;
+
+        IMS::ImageMetadata meta = image.metadata();
+        const std::string name = std::string(meta.name());
+        const std::string folder = std::string(meta.folder());
+        LOG_DBG << "Listener acquired image " << name << " in " << folder;
+        _index.arrived(name, folder);
+
         IMS::Barrier barrier(image);
         barrier.block(*_stream, _barrier_timeout);
-        LOG_DBG << "Barrier released for image " << image_id;
-        //
-        // if image is null, then there was a TIMEOUT, which means the pixels
-        // never materialized.  Print an error, and throw an exception.
-        //
         if (!image) {
-            std::ostringstream err;
-            err << "image " << image_id << " was not found after blocking " << _barrier_timeout << " microseconds at barrier";
-            LOG_CRT << err.str();
-            throw L1::CannotFetchPixel(err.str());
+            LOG_CRT << "image " << name << " was not completed after blocking "
+                    << _barrier_timeout << " microseconds at barrier";
+            _index.failed(name, folder);
+            continue;
+        }
+        _index.complete(name, folder);
+
+        if (_on_image) {
+            try {
+                _on_image(name, folder);
+            }
+            catch (std::exception& e) {
+                LOG_CRT << "Listener callback failed for " << name
+                        << " because " << e.what();
+            }
         }
-        // We have the image, return
-        return;
     }
+    LOG_INF << "Notification listener ended";
 }
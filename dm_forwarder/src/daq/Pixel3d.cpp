@@ -21,29 +21,51 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "daq/PixelPool.h"
 #include "daq/Pixel3d.h"
 
 Pixel3d::Pixel3d(uint64_t d1, uint64_t d2, uint64_t d3) :
+        Pixel3d(d1, d2, d3, nullptr) {
+}
+
+Pixel3d::Pixel3d(uint64_t d1, uint64_t d2, uint64_t d3, PixelPool* pool) :
+        _pool{pool},
         _d1{d1},
         _d2{d2},
         _d3{d3} {
+    _data = static_cast<int32_t*>(pixel_alloc(_pool, bytes()));
+
     _arr = new int32_t**[_d1];
     for (uint64_t i = 0; i < _d1; i++) {
         _arr[i] = new int32_t*[_d2];
         for (uint64_t j = 0; j < _d2; j++) {
-            _arr[i][j] = new int32_t[_d3];
+            _arr[i][j] = _data + (i * _d2 + j) * _d3;
         }
     }
 }
 
+Pixel3d::Pixel3d(Pixel3d&& other) :
+        _arr{other._arr},
+        _data{other._data},
+        _pool{other._pool},
+        _d1{other._d1},
+        _d2{other._d2},
+        _d3{other._d3} {
+    other._arr = nullptr;
+    other._data = nullptr;
+}
+
 Pixel3d::~Pixel3d() {
+    if (!_arr) {
+        return;
+    }
+
     for (uint64_t i = 0; i < _d1; i++) {
-        for (uint64_t j = 0; j < _d2; j++) {
-            delete[] _arr[i][j];
-        }
         delete[] _arr[i];
     }
     delete[] _arr;
+
+    pixel_free(_pool, _data, bytes());
 }
 
 int32_t*** Pixel3d::get() {
@@ -62,3 +84,6 @@ uint64_t Pixel3d::d3() {
     return _d3;
 }
 
+uint64_t Pixel3d::bytes() {
+    return _d1 * _d2 * _d3 * sizeof(int32_t);
+}
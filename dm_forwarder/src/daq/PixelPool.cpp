@@ -0,0 +1,192 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <sstream>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <core/Exceptions.h>
+#include <core/Metrics.h>
+#include <core/SimpleLogger.h>
+#include <daq/PixelPool.h>
+
+#define PIXEL_POOL_PAGE 4096
+#define PIXEL_POOL_HUGE_PAGE (2 << 20)
+
+PixelPool::PixelPool(const uint64_t cap, const PixelPages pages) :
+        _cap{cap},
+        _pages{pages},
+        _resident{0} {
+}
+
+PixelPool::~PixelPool() {
+    for (auto&& idle : _idle) {
+        for (auto&& b : idle.second) {
+            unmap(b);
+        }
+    }
+}
+
+void* PixelPool::acquire(const uint64_t bytes) {
+    Metrics& metrics = Metrics::instance();
+    const key k(bytes, node());
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        auto it = _idle.find(k);
+        if (it != _idle.end() && !it->second.empty()) {
+            block b = it->second.back();
+            it->second.pop_back();
+            _used[b.addr] = b;
+            metrics.counter("pixel_pool", "hit").add();
+            return b.addr;
+        }
+        evict(bytes);
+    }
+
+    // map and fault in pages without the lock held
+    metrics.counter("pixel_pool", "miss").add();
+    block b = map(bytes);
+
+    std::lock_guard<std::mutex> lk(_mutex);
+    _used[b.addr] = b;
+    _resident += b.length;
+    metrics.gauge("pixel_pool_bytes", "resident").set(_resident);
+    return b.addr;
+}
+
+void PixelPool::release(void* buffer, const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _used.find(buffer);
+    if (it == _used.end()) {
+        LOG_CRT << "Buffer of " << bytes << " bytes was not acquired from "
+                << "PixelPool";
+        return;
+    }
+
+    block b = it->second;
+    _used.erase(it);
+    if (_resident > _cap) {
+        _resident -= b.length;
+        unmap(b);
+        Metrics::instance().gauge("pixel_pool_bytes", "resident").set(
+                _resident);
+        return;
+    }
+
+    _idle[key(bytes, b.node)].push_back(b);
+}
+
+uint64_t PixelPool::resident() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _resident;
+}
+
+PixelPages PixelPool::pages(const std::string& name) {
+    if (name == "normal") return PixelPages::NORMAL;
+    if (name == "transparent") return PixelPages::TRANSPARENT;
+    if (name == "hugetlb") return PixelPages::HUGETLB;
+
+    std::ostringstream err;
+    err << "Pixel pool pages " << name << " is not one of normal, "
+        << "transparent or hugetlb";
+    LOG_CRT << err.str();
+    throw L1::YamlKeyError(err.str());
+}
+
+void PixelPool::evict(const uint64_t bytes) {
+    for (auto it = _idle.begin(); it != _idle.end() &&
+            _resident + bytes > _cap; ++it) {
+        while (!it->second.empty() && _resident + bytes > _cap) {
+            block b = it->second.back();
+            it->second.pop_back();
+            _resident -= b.length;
+            unmap(b);
+        }
+    }
+    Metrics::instance().gauge("pixel_pool_bytes", "resident").set(_resident);
+}
+
+PixelPool::block PixelPool::map(const uint64_t bytes) {
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    block b = { MAP_FAILED, bytes, node() };
+    if (_pages == PixelPages::HUGETLB) {
+        b.length = (bytes + PIXEL_POOL_HUGE_PAGE - 1) /
+            PIXEL_POOL_HUGE_PAGE * PIXEL_POOL_HUGE_PAGE;
+        b.addr = mmap(nullptr, b.length, prot, flags | MAP_HUGETLB, -1, 0);
+        if (b.addr == MAP_FAILED) {
+            LOG_WRN << "No hugetlbfs pages for " << b.length << " bytes, "
+                    << "using transparent huge pages";
+        }
+    }
+
+    if (b.addr == MAP_FAILED) {
+        b.length = (bytes + PIXEL_POOL_PAGE - 1) / PIXEL_POOL_PAGE *
+            PIXEL_POOL_PAGE;
+        b.addr = mmap(nullptr, b.length, prot, flags, -1, 0);
+        if (b.addr == MAP_FAILED) {
+            LOG_CRT << "Cannot map " << b.length << " bytes of pixel buffer";
+            throw std::bad_alloc();
+        }
+        if (_pages != PixelPages::NORMAL) {
+            madvise(b.addr, b.length, MADV_HUGEPAGE);
+        }
+    }
+
+    // first touch places pages on the node of the calling thread
+    char* p = static_cast<char*>(b.addr);
+    for (uint64_t i = 0; i < b.length; i += PIXEL_POOL_PAGE) {
+        p[i] = 0;
+    }
+    return b;
+}
+
+void PixelPool::unmap(const block& b) {
+    munmap(b.addr, b.length);
+}
+
+int PixelPool::node() {
+    unsigned cpu = 0, n = 0;
+    if (syscall(SYS_getcpu, &cpu, &n, nullptr)) {
+        return 0;
+    }
+    return n;
+}
+
+void* pixel_alloc(PixelPool* pool, const uint64_t bytes) {
+    if (pool) {
+        return pool->acquire(bytes);
+    }
+    return ::operator new(bytes);
+}
+
+void pixel_free(PixelPool* pool, void* buffer, const uint64_t bytes) {
+    if (pool) {
+        pool->release(buffer, bytes);
+    }
+    else {
+        ::operator delete(buffer);
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <daq/ScanIndex.h>
+
+const std::string HIGH_WATER = "high_water";
+const std::string CORRUPTED = "-";
+
+ScanIndex::ScanIndex(const std::string& path) :
+        _path{path},
+        _high_water{0} {
+    if (!_path.empty()) {
+        load();
+    }
+}
+
+bool ScanIndex::find(const uint64_t id, scan_entry& entry) const {
+    auto it = _entries.find(id);
+    if (it == _entries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void ScanIndex::put(const uint64_t id, const scan_entry& entry) {
+    _entries[id] = entry;
+    _high_water = std::max(_high_water, id);
+}
+
+size_t ScanIndex::retain(const std::vector<uint64_t>& ids) {
+    std::unordered_set<uint64_t> keep(ids.begin(), ids.end());
+    size_t removed = 0;
+    for (auto it = _entries.begin(); it != _entries.end(); ) {
+        if (!keep.count(it->first)) {
+            it = _entries.erase(it);
+            removed++;
+        }
+        else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+uint64_t ScanIndex::high_water() const {
+    return _high_water;
+}
+
+size_t ScanIndex::size() const {
+    return _entries.size();
+}
+
+void ScanIndex::save() {
+    if (_path.empty()) {
+        return;
+    }
+
+    // written aside and renamed so a crash leaves either file whole
+    const std::string tmp = _path + ".tmp";
+    std::ofstream out(tmp, std::ios::trunc);
+    out << HIGH_WATER << " " << _high_water << "\n";
+    for (auto&& e : _entries) {
+        out << e.first << " " << e.second.seconds << " "
+            << (e.second.name.empty() ? CORRUPTED : e.second.name) << "\n";
+    }
+    out.close();
+
+    if (!out || std::rename(tmp.c_str(), _path.c_str())) {
+        std::ostringstream err;
+        err << "Cannot write scan index " << _path;
+        LOG_CRT << err.str();
+        throw L1::CannotOpenFile(err.str());
+    }
+}
+
+void ScanIndex::load() {
+    std::ifstream in(_path);
+    if (!in) {
+        return;
+    }
+
+    std::string key;
+    uint64_t high_water;
+    if (!(in >> key >> high_water) || key != HIGH_WATER) {
+        LOG_WRN << "Ignoring scan index " << _path << " of unknown format";
+        return;
+    }
+
+    std::map<uint64_t, scan_entry> entries;
+    uint64_t id;
+    scan_entry e;
+    while (in >> id >> e.seconds >> e.name) {
+        if (e.name == CORRUPTED) {
+            e.name.clear();
+        }
+        entries[id] = e;
+    }
+    if (!in.eof()) {
+        LOG_WRN << "Ignoring scan index " << _path << " with bad entries";
+        return;
+    }
+
+    _high_water = high_water;
+    _entries.swap(entries);
+    LOG_INF << "Loaded " << _entries.size() << " entries of scan index "
+            << _path << " up to IMS::Id " << _high_water;
+}
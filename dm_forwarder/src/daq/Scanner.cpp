@@ -22,14 +22,26 @@
  */
 
 #include <time.h>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <functional>
 #include <ims/Folder.hh>
+#include <core/Metrics.h>
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
+#include <core/WorkerPool.h>
 #include <daq/Scanner.h>
 
-Scanner::Scanner(const std::string partition, const int minutes) :
+Scanner::Scanner(const std::string partition,
+                 const int minutes,
+                 ScanIndex* index,
+                 WorkerPool* pool) :
         IMS::Processor(),
-        _store(partition.c_str()) {
+        _partition{partition},
+        _index(index ? index : &_own_index),
+        _pool{pool} {
 
     if (minutes < 0) {
         std::ostringstream err;
@@ -45,14 +57,107 @@ Scanner::Scanner(const std::string partition, const int minutes) :
     struct tm* local;
     local = localtime(&current);
     local->tm_min = local->tm_min - minutes;
-    time_t last_time = mktime(local);
-    _timestamp = OSA::TimeStamp(last_time);
+    _since = mktime(local);
 
-    LOG_INF << "Querying images from " << _timestamp.decode() << " to now";
+    LOG_INF << "Querying images from " << OSA::TimeStamp(_since).decode()
+            << " to now";
 }
 
 void Scanner::process(const IMS::Id& id) {
-    IMS::Image image(id, _store);
+    const uint64_t value = id;
+    _seen.push_back(value);
+
+    // ids above the high-water mark were never scanned
+    scan_entry e;
+    if (value > _index->high_water() || !_index->find(value, e)) {
+        _new.push_back(value);
+    }
+}
+
+std::vector<std::string> Scanner::get_images() {
+    Metrics& metrics = Metrics::instance();
+    StageTimer timer(metrics.latency("scan"));
+
+    open(_new);
+    const size_t removed = _index->retain(_seen);
+
+    // the index only saves work, a scan that cannot save it still counts
+    if (!_new.empty() || removed) {
+        try {
+            _index->save();
+        }
+        catch (L1::CannotOpenFile& e) { }
+    }
+
+    std::vector<std::pair<int64_t, std::string>> found;
+    for (auto&& id : _seen) {
+        scan_entry e;
+        if (_index->find(id, e) && !e.name.empty() && e.seconds > _since) {
+            found.push_back(std::make_pair(e.seconds, e.name));
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> images;
+    for (auto&& f : found) {
+        images.push_back(f.second);
+    }
+
+    timer.stop();
+    const double seconds = timer.elapsed() / 1e6;
+    const double rate = seconds > 0 ? _seen.size() / seconds : 0;
+    metrics.counter("scan_ids", "seen").add(_seen.size());
+    metrics.counter("scan_ids", "new").add(_new.size());
+    metrics.gauge("scan_ids_per_second", "scan").set(rate);
+    LOG_INF << "Scanned " << _seen.size() << " ids, " << _new.size()
+            << " new, in " << timer.elapsed() / 1000 << " ms (" << rate
+            << " images/s), " << images.size() << " images to catch up";
+    _new.clear();
+    return images;
+}
+
+void Scanner::open(const std::vector<uint64_t>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+
+    // one range per thread, each with its own store
+    const size_t ranges = _pool ? _pool->size() + 1 : 1;
+    const size_t per_range = (ids.size() + ranges - 1) / ranges;
+    std::vector<std::vector<scan_entry>> entries(ranges);
+    std::vector<std::function<void ()>> tasks;
+    for (size_t r = 0; r < ranges; r++) {
+        const size_t begin = r * per_range;
+        const size_t end = std::min(ids.size(), begin + per_range);
+        if (begin >= end) {
+            break;
+        }
+        tasks.push_back([this, &ids, &entries, r, begin, end]() {
+            IMS::Store store(_partition.c_str());
+            for (size_t i = begin; i < end; i++) {
+                entries[r].push_back(read(store, ids[i]));
+            }
+        });
+    }
+
+    if (_pool) {
+        _pool->run(tasks);
+    }
+    else {
+        for (auto&& task : tasks) {
+            task();
+        }
+    }
+
+    for (size_t r = 0; r < entries.size(); r++) {
+        for (size_t i = 0; i < entries[r].size(); i++) {
+            _index->put(ids[r * per_range + i], entries[r][i]);
+        }
+    }
+}
+
+scan_entry Scanner::read(IMS::Store& store, const uint64_t id) {
+    IMS::Image image(IMS::Id(id), store);
     if (!image) {
         std::ostringstream err;
         err << "Cannot instantiate IMS::Image for scanning DAQ catalog";
@@ -60,19 +165,31 @@ void Scanner::process(const IMS::Id& id) {
         throw L1::ScannerError(err.str());
     }
 
-    const OSA::TimeStamp time = image.metadata().timestamp();
-    const std::string img_name = image.metadata().name();
+    scan_entry e;
+    e.seconds = seconds(image.metadata().timestamp());
+    e.name = image.metadata().name();
 
     // handling for img name corruption from DAQ
-    auto it = std::find_if(img_name.begin(), img_name.end(), [](char c) { 
+    auto it = std::find_if(e.name.begin(), e.name.end(), [](char c) {
                 return !(isalnum(c) || c == '_');
               });
-
-    if (time > _timestamp && it == img_name.end()) {
-        _images.push_back(img_name);
+    if (it != e.name.end()) {
+        e.name.clear();
     }
+    return e;
 }
 
-std::vector<std::string> Scanner::get_images() {
-    return _images;
+int64_t Scanner::seconds(const OSA::TimeStamp& timestamp) {
+    // TimeStamp only compares, find the first whole second not before it
+    int64_t lo = 0, hi = int64_t(1) << 40;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (timestamp > OSA::TimeStamp(static_cast<time_t>(mid))) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
 }
@@ -26,19 +26,22 @@
 #include "core/SimpleLogger.h"
 #include "daq/ScienceBuffer.h"
 
-ScienceBuffer::ScienceBuffer(int64_t samples) :
+ScienceBuffer::ScienceBuffer(int64_t samples, PixelPool* pool) :
         _samples{samples},
-        _buffer(new char[IMS::Science::Data::bytes(samples)]),
+        _buffer(static_cast<char*>(pixel_alloc(pool,
+                    IMS::Science::Data::bytes(samples)))),
         _data(_buffer, samples),
-        _ccds(new IMS::Stripe[samples * 3]) {
+        _ccds(static_cast<IMS::Stripe*>(pixel_alloc(pool,
+                    samples * 3 * sizeof(IMS::Stripe)))),
+        _pool{pool} {
     _ccd[0] = _ccds;
     _ccd[1] = _ccds + samples;
     _ccd[2] = _ccds + samples + samples;
 }
 
 ScienceBuffer::~ScienceBuffer() {
-    delete[] _buffer;
-    delete[] _ccds;
+    pixel_free(_pool, _buffer, IMS::Science::Data::bytes(_samples));
+    pixel_free(_pool, _ccds, _samples * 3 * sizeof(IMS::Stripe));
 }
 
 Data ScienceBuffer::process(IMS::Science::Source& source) {
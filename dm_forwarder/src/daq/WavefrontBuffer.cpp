@@ -26,17 +26,20 @@
 #include "core/SimpleLogger.h"
 #include "daq/WavefrontBuffer.h"
 
-WavefrontBuffer::WavefrontBuffer(int64_t samples) :
+WavefrontBuffer::WavefrontBuffer(int64_t samples, PixelPool* pool) :
         _samples{samples},
-        _buffer(new char[IMS::Wavefront::Data::bytes(samples)]),
+        _buffer(static_cast<char*>(pixel_alloc(pool,
+                    IMS::Wavefront::Data::bytes(samples)))),
         _data(_buffer, samples),
-        _ccds(new IMS::Stripe[samples * 1]) {
+        _ccds(static_cast<IMS::Stripe*>(pixel_alloc(pool,
+                    samples * 1 * sizeof(IMS::Stripe)))),
+        _pool{pool} {
     _ccd[0] = _ccds;
 }
 
 WavefrontBuffer::~WavefrontBuffer() {
-    delete[] _buffer;
-    delete[] _ccds;
+    pixel_free(_pool, _buffer, IMS::Wavefront::Data::bytes(_samples));
+    pixel_free(_pool, _ccds, _samples * 1 * sizeof(IMS::Stripe));
 }
 
 Data WavefrontBuffer::process(IMS::Wavefront::Source& source) {
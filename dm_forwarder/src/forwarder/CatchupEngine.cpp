@@ -0,0 +1,211 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cctype>
+#include <sstream>
+#include <algorithm>
+#include <core/Exceptions.h>
+#include <core/Metrics.h>
+#include <core/SimpleLogger.h>
+#include <core/Tracer.h>
+#include <forwarder/CatchupEngine.h>
+
+CatchupEngine::CatchupEngine(const int concurrency,
+                             const std::string& checkpoint) :
+        _checkpoint{checkpoint},
+        _stop{false} {
+    load();
+
+    _log.open(_checkpoint, std::ios::app);
+    if (!_log) {
+        std::ostringstream err;
+        err << "Cannot open catch-up checkpoint " << _checkpoint;
+        LOG_CRT << err.str();
+        throw L1::CannotOpenFile(err.str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        report();
+    }
+    for (int i = 0; i < std::max(concurrency, 1); i++) {
+        _workers.push_back(std::thread(&CatchupEngine::work, this));
+    }
+    LOG_INF << "Catch-up engine started with " << _workers.size()
+            << " images at a time and " << _pending.size()
+            << " pending images";
+}
+
+CatchupEngine::~CatchupEngine() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stop = true;
+        if (!_jobs.empty()) {
+            LOG_WRN << "Catch-up engine stopped with " << _jobs.size()
+                    << " queued jobs";
+        }
+        _jobs.clear();
+        _not_empty.notify_all();
+    }
+    for (auto&& worker : _workers) {
+        worker.join();
+    }
+}
+
+void CatchupEngine::add(const std::vector<std::string>& image_ids) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto&& image_id : image_ids) {
+        if (_pending.insert(std::make_pair(age(image_id), image_id)).second) {
+            record('+', image_id);
+        }
+    }
+    _log.flush();
+    report();
+}
+
+void CatchupEngine::run(const std::string& image_id,
+                        std::function<void ()> job) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_stop) {
+        return;
+    }
+
+    const std::string key = age(image_id);
+    if (_pending.insert(std::make_pair(key, image_id)).second) {
+        record('+', image_id);
+        _log.flush();
+        report();
+    }
+    _jobs.insert(std::make_pair(key, std::move(job)));
+    _not_empty.notify_one();
+}
+
+void CatchupEngine::done(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (!_pending.erase(std::make_pair(age(image_id), image_id))) {
+        return;
+    }
+
+    // nothing left to resume, start the next backlog from an empty file
+    if (_pending.empty()) {
+        _log.close();
+        _log.open(_checkpoint, std::ios::trunc);
+    }
+    else {
+        record('-', image_id);
+    }
+    _log.flush();
+    report();
+    Metrics::instance().counter("images", "catchup").add();
+}
+
+std::vector<std::string> CatchupEngine::pending() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::vector<std::string> ids;
+    for (auto&& p : _pending) {
+        ids.push_back(p.second);
+    }
+    return ids;
+}
+
+size_t CatchupEngine::size() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _pending.size();
+}
+
+std::string CatchupEngine::age(const std::string& image_id) {
+    // controller and origin prefixes end before the first digit
+    auto it = std::find_if(image_id.begin(), image_id.end(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+    });
+    return std::string(it, image_id.end());
+}
+
+void CatchupEngine::load() {
+    std::ifstream in(_checkpoint);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.size() < 2) {
+            continue;
+        }
+        const std::string image_id = line.substr(1);
+        if (line[0] == '+') {
+            _pending.insert(std::make_pair(age(image_id), image_id));
+        }
+        else if (line[0] == '-') {
+            _pending.erase(std::make_pair(age(image_id), image_id));
+        }
+    }
+    in.close();
+
+    // written aside and renamed so a crash leaves either file whole
+    const std::string tmp = _checkpoint + ".tmp";
+    std::ofstream out(tmp, std::ios::trunc);
+    for (auto&& p : _pending) {
+        out << '+' << p.second << '\n';
+    }
+    out.close();
+    if (!out || std::rename(tmp.c_str(), _checkpoint.c_str())) {
+        std::ostringstream err;
+        err << "Cannot write catch-up checkpoint " << _checkpoint;
+        LOG_CRT << err.str();
+        throw L1::CannotOpenFile(err.str());
+    }
+}
+
+void CatchupEngine::record(const char op, const std::string& image_id) {
+    _log << op << image_id << '\n';
+}
+
+void CatchupEngine::report() {
+    Metrics::instance().gauge("catchup_images", "pending").set(
+            _pending.size());
+}
+
+void CatchupEngine::work() {
+    Tracer::instance().name_thread("catchup");
+    while (true) {
+        std::function<void ()> job;
+        {
+            std::unique_lock<std::mutex> lk(_mutex);
+            _not_empty.wait(lk, [this]() {
+                return _stop || !_jobs.empty();
+            });
+
+            if (_stop) {
+                break;
+            }
+
+            job = std::move(_jobs.begin()->second);
+            _jobs.erase(_jobs.begin());
+        }
+
+        try {
+            job();
+        }
+        catch (std::exception& e) {
+            LOG_CRT << "Catch-up job failed because " << e.what();
+        }
+    }
+}
@@ -39,9 +39,8 @@ std::vector<std::string> excluded_keywords {
 };
 
 FitsFormatter::FitsFormatter(const std::vector<std::string>& daq_mapping,
-                             const std::vector<std::string>& hdr_mapping,
-                             redis_connection_params params)
-    : Formatter(daq_mapping, hdr_mapping, params) {
+                             const std::vector<std::string>& hdr_mapping)
+    : Formatter(daq_mapping, hdr_mapping) {
 }
 
 void FitsFormatter::write_header(const fs::path& pix_path,
@@ -91,7 +90,7 @@ void FitsFormatter::write_header(const fs::path& pix_path,
             LOG_CRT << err;
             throw L1::CannotFormatFitsfile(std::string(err));
         }
-        LOG_INF << "Finished assembling header with pixel data file at "
+        LOG_DBG << "Finished assembling header with pixel data file at "
                 << pix_path.string();
     }
     catch (L1::CfitsioError& e) {
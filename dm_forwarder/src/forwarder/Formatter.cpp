@@ -25,16 +25,14 @@
 #include <future>
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
-#include <core/RedisConnection.h>
+#include <core/Tracer.h>
+#include <forwarder/ImageCost.h>
 #include <forwarder/Formatter.h>
 
 namespace fs = boost::filesystem;
 
-Formatter::Formatter(const std::vector<int>& data_segment,
-                     redis_connection_params params) :
+Formatter::Formatter(const std::vector<int>& data_segment) :
         _data_segment{data_segment} {
-    _db = std::unique_ptr<RedisConnection>(
-            new RedisConnection(params.host, params.port, params.db));
 }
 
 std::string Formatter::write_pix_file(int32_t** ccd,
@@ -63,7 +61,7 @@ std::string Formatter::write_pix_file(int32_t** ccd,
             LOG_CRT << std::string(err);
             throw L1::CannotFormatFitsfile(err);
         }
-        LOG_INF << "Finished writing pixel fitsfile at " << filepath.string();
+        LOG_DBG << "Finished writing pixel fitsfile at " << filepath.string();
 
         return filepath.string();
     }
@@ -72,10 +70,10 @@ std::string Formatter::write_pix_file(int32_t** ccd,
     }
 }
 
-void Formatter::write(const std::string image,
-                      Pixel3d& ccds,
-                      long* naxes,
-                      const fs::path& prefix) {
+std::vector<std::string> Formatter::write(const std::string image,
+                                          Pixel3d& ccds,
+                                          long* naxes,
+                                          const fs::path& prefix) {
     int32_t d3 = static_cast<int32_t>(ccds.d3());
     int32_t*** pix = ccds.get();
     std::vector<std::future<std::string>> tasks;
@@ -90,19 +88,19 @@ void Formatter::write(const std::string image,
 
         std::future<std::string> job = std::async(
                 std::launch::async,
-                &Formatter::write_pix_file,
-                this,
-                ccd,
-                std::ref(d3),
-                naxes,
-                filename);
+                [this, &image, ccd, &d3, naxes, filename]() {
+                    TraceSpan span("write_pix_file", image,
+                            filename.filename().string());
+                    CpuTimer cpu(image);
+                    return write_pix_file(ccd, d3, naxes, filename);
+                });
         tasks.push_back(std::move(job));
     }
 
+    TraceSpan span("wait_pix_files", image, prefix.filename().string());
+    std::vector<std::string> filenames;
     for (auto&& task : tasks) {
-        std::string filename = task.get();
-        std::string key = image + ":ccd";
-        _db->lpush(key, { filename });
-        _db->exec();
+        filenames.push_back(task.get());
     }
+    return filenames;
 }
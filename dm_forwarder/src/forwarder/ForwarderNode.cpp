@@ -0,0 +1,151 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <netdb.h>
+#include <climits> // HOST_NAME_MAX
+#include <unistd.h> // gethostname
+#include <memory>
+
+#include <core/Exceptions.h>
+#include <core/SimpleLogger.h>
+#include <core/Metrics.h>
+#include <forwarder/ForwarderNode.h>
+
+ForwarderNode::ForwarderNode(const YAML::Node& config) {
+    _consume_q = config["CONSUME_QUEUE"].as<std::string>();
+    _forwarder_list = "forwarder_list";
+    _association_key = "f99_association";
+
+    _hb_params.key = _association_key;
+    _hb_params.seconds_to_update = config["SECONDS_TO_UPDATE"].as<int>();
+    _hb_params.seconds_to_expire = config["SECONDS_TO_EXPIRE"].as<int>();
+    _hb_params.redis_params.host = config["REDIS"]["REMOTE"]["HOST"]
+            .as<std::string>();
+    _hb_params.redis_params.port = config["REDIS"]["REMOTE"]["PORT"]
+            .as<int>();
+    _hb_params.redis_params.db = config["REDIS"]["REMOTE"]["DB"].as<int>();
+
+    // milliseconds to wait for a redis connection
+    if (config["REDIS"]["CONNECT_TIMEOUT"]) {
+        _hb_params.redis_params.connect_timeout = config["REDIS"][
+            "CONNECT_TIMEOUT"].as<int>();
+    }
+
+    char hostname[HOST_NAME_MAX];
+    gethostname(hostname, HOST_NAME_MAX);
+
+    std::unique_ptr<struct addrinfo, decltype(&freeaddrinfo)> infoptr(nullptr,
+            &freeaddrinfo);
+
+    addrinfo *temp;
+    int response = getaddrinfo(hostname, NULL, NULL, &temp);
+    infoptr.reset(temp);
+    if (response) {
+        LOG_CRT << "Cannot get hostname";
+        throw L1::L1Exception("Cannot get hostname");
+    }
+
+    char host[256];
+    getnameinfo(infoptr->ai_addr, infoptr->ai_addrlen, host, sizeof(host),
+            NULL, 0, NI_NUMERICHOST);
+
+    _hostname = hostname;
+    _ip_addr = host;
+    _name = static_cast<std::string>(host) + ":" + hostname;
+}
+
+const std::string& ForwarderNode::name() const {
+    return _name;
+}
+
+const std::string& ForwarderNode::consume_q() const {
+    return _consume_q;
+}
+
+const std::string& ForwarderNode::association_key() const {
+    return _association_key;
+}
+
+const redis_connection_params& ForwarderNode::remote() const {
+    return _hb_params.redis_params;
+}
+
+heartbeat_params ForwarderNode::heartbeat(AsyncRedis& remote) {
+    heartbeat_params params = _hb_params;
+    params.action = std::bind(&ForwarderNode::register_fwd, this,
+            std::ref(remote));
+    return params;
+}
+
+void ForwarderNode::register_fwd(AsyncRedis& remote) {
+    // set forwarder in archiver database
+    const std::string msg = _builder.build_fwd_info(_hostname, _ip_addr,
+            _consume_q);
+
+    remote.send({ "lpush", _forwarder_list, msg }, [](
+                const std::string& error, const Reply& reply) {
+        if (!error.empty()) {
+            LOG_CRT << "Cannot set forwarder in redis list because " << error;
+            return;
+        }
+        LOG_INF << "Set forwarder in redis list";
+    });
+}
+
+void ForwarderNode::publish_ack(Publisher& pub,
+                                const YAML::Node& n,
+                                const bool ok) {
+    try {
+        const std::string msg_type = n["MSG_TYPE"].as<std::string>();
+        const std::string image_id = n["IMAGE_ID"].as<std::string>();
+        const std::string ack_id = n["ACK_ID"].as<std::string>();
+        const std::string reply_q = n["REPLY_QUEUE"].as<std::string>();
+        const std::string msg = _builder.build_ack(msg_type, image_id, _name,
+                ack_id, ok ? "True" : "False");
+        StageTimer timer(Metrics::instance().latency("publish"));
+        pub.publish_message(reply_q, msg);
+        LOG_DBG << "Published ack for " << msg_type << " with values: " << msg;
+    }
+    catch (L1::PublisherError& e) { }
+    catch (std::exception& e) {
+        LOG_CRT << e.what();
+    }
+}
+
+std::map<const std::string, ForwarderNode::action> ForwarderNode::actions(
+        const handlers& h) {
+    std::map<const std::string, action> table = {
+        { "FILE_TRANSFER_COMPLETED_ACK", h.process_ack },
+        { "ASSOCIATED", h.associated },
+        { "SCAN", h.scan },
+        { "TRACE", h.trace },
+    };
+    for (auto&& device : { "AT", "CC", "CATCHUP" }) {
+        const std::string prefix = std::string(device) + "_FWDR_";
+        table[prefix + "HEALTH_CHECK"] = h.health_check;
+        table[prefix + "XFER_PARAMS"] = h.xfer_params;
+        table[prefix + "HEADER_READY"] = h.header_ready;
+        table[prefix + "END_READOUT"] = h.end_readout;
+    }
+    return table;
+}
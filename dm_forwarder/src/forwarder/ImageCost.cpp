@@ -0,0 +1,141 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <algorithm>
+#include <forwarder/ImageCost.h>
+
+ImageCost& ImageCost::instance() {
+    // leaked so that tasks still running during exit can record
+    static ImageCost* cost = new ImageCost();
+    return *cost;
+}
+
+ImageCost::entry& ImageCost::at(const std::string& image_id) {
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        entry e = { { 0, 0, 0, 0, 0 }, 0, std::chrono::steady_clock::now() };
+        it = _images.insert(std::make_pair(image_id, e)).first;
+    }
+    return it->second;
+}
+
+void ImageCost::add_cpu(const std::string& image_id, const uint64_t us) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    at(image_id).cost.cpu_us += us;
+}
+
+void ImageCost::add_daq(const std::string& image_id, const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    at(image_id).cost.daq_bytes += bytes;
+}
+
+void ImageCost::add_written(const std::string& image_id,
+                            const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    at(image_id).cost.written_bytes += bytes;
+}
+
+void ImageCost::add_sent(const std::string& image_id, const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    at(image_id).cost.sent_bytes += bytes;
+}
+
+void ImageCost::alloc_pixels(const std::string& image_id,
+                             const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    entry& e = at(image_id);
+    e.pixel_bytes += bytes;
+    e.cost.peak_pixel_bytes = std::max(e.cost.peak_pixel_bytes,
+            e.pixel_bytes);
+}
+
+void ImageCost::free_pixels(const std::string& image_id,
+                            const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    entry& e = at(image_id);
+    e.pixel_bytes -= std::min(e.pixel_bytes, bytes);
+}
+
+image_cost ImageCost::get(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        return image_cost{ 0, 0, 0, 0, 0 };
+    }
+    return it->second.cost;
+}
+
+void ImageCost::remove(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _images.erase(image_id);
+}
+
+void ImageCost::expire(const std::chrono::seconds age) {
+    auto oldest = std::chrono::steady_clock::now() - age;
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto it = _images.begin(); it != _images.end(); ) {
+        if (it->second.created < oldest) {
+            it = _images.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+uint64_t ImageCost::thread_cpu() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+        return 0;
+    }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+PixelCharge::PixelCharge(const std::string& image_id, const uint64_t bytes) :
+        _image_id{image_id},
+        _bytes{bytes} {
+    ImageCost::instance().alloc_pixels(_image_id, _bytes);
+}
+
+PixelCharge::~PixelCharge() {
+    ImageCost::instance().free_pixels(_image_id, _bytes);
+}
+
+CpuTimer::CpuTimer(const std::string& image_id) :
+        _image_id{image_id},
+        _start(ImageCost::thread_cpu()),
+        _stopped{false} {
+}
+
+CpuTimer::~CpuTimer() {
+    stop();
+}
+
+void CpuTimer::stop() {
+    if (!_stopped) {
+        _stopped = true;
+        ImageCost::instance().add_cpu(_image_id,
+                ImageCost::thread_cpu() - _start);
+    }
+}
@@ -5,3 +5,9 @@ Info::MODE Info::encode(std::string mode) {
     else if (mode == "catchup") return Info::MODE::CATCHUP;
     else return Info::MODE::UNDEFINED;
 }
+
+std::string Info::decode(const Info::MODE mode) {
+    if (mode == Info::MODE::LIVE) return "live";
+    else if (mode == Info::MODE::CATCHUP) return "catchup";
+    else return "undefined";
+}
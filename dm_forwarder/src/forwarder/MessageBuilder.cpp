@@ -101,6 +101,27 @@ std::string MessageBuilder::build_fwd_info(const std::string& hostname,
     return msg.c_str();
 }
 
+namespace {
+
+void emit_image_retrieval_for_archiving(YAML::Emitter& msg,
+                                        const int& code,
+                                        const std::string& obsid,
+                                        const std::string& raft,
+                                        const std::string& ccd,
+                                        const std::string& filename,
+                                        const std::string& desc) {
+    msg << YAML::Key << "MSG_TYPE"
+        << YAML::Value << "IMAGE_RETRIEVAL_FOR_ARCHIVING";
+    msg << YAML::Key << "OBSID" << YAML::Value << obsid;
+    msg << YAML::Key << "RAFT" << YAML::Value << raft;
+    msg << YAML::Key << "SENSOR" << YAML::Value << ccd;
+    msg << YAML::Key << "FILENAME" << YAML::Value << filename;
+    msg << YAML::Key << "STATUS_CODE" << YAML::Value << code;
+    msg << YAML::Key << "DESCRIPTION" << YAML::Value << desc;
+}
+
+}
+
 std::string MessageBuilder::build_image_retrieval_for_archiving(
         const int& code,
         const std::string& obsid,
@@ -112,14 +133,32 @@ std::string MessageBuilder::build_image_retrieval_for_archiving(
     msg << YAML::DoubleQuoted;
     msg << YAML::Flow;
     msg << YAML::BeginMap;
-    msg << YAML::Key << "MSG_TYPE"
-        << YAML::Value << "IMAGE_RETRIEVAL_FOR_ARCHIVING";
-    msg << YAML::Key << "OBSID" << YAML::Value << obsid;
-    msg << YAML::Key << "RAFT" << YAML::Value << raft;
-    msg << YAML::Key << "SENSOR" << YAML::Value << ccd;
-    msg << YAML::Key << "FILENAME" << YAML::Value << filename;
-    msg << YAML::Key << "STATUS_CODE" << YAML::Value << code;
-    msg << YAML::Key << "DESCRIPTION" << YAML::Value << desc;
+    emit_image_retrieval_for_archiving(msg, code, obsid, raft, ccd, filename,
+            desc);
+    msg << YAML::EndMap;
+    return msg.c_str();
+}
+
+std::string MessageBuilder::build_image_retrieval_for_archiving(
+        const int& code,
+        const std::string& obsid,
+        const std::string& raft,
+        const std::string& ccd,
+        const std::string& filename,
+        const std::string& desc,
+        const image_cost& cost) {
+    YAML::Emitter msg;
+    msg << YAML::DoubleQuoted;
+    msg << YAML::Flow;
+    msg << YAML::BeginMap;
+    emit_image_retrieval_for_archiving(msg, code, obsid, raft, ccd, filename,
+            desc);
+    msg << YAML::Key << "CPU_US" << YAML::Value << cost.cpu_us;
+    msg << YAML::Key << "PEAK_PIXEL_BYTES"
+        << YAML::Value << cost.peak_pixel_bytes;
+    msg << YAML::Key << "DAQ_BYTES" << YAML::Value << cost.daq_bytes;
+    msg << YAML::Key << "WRITTEN_BYTES" << YAML::Value << cost.written_bytes;
+    msg << YAML::Key << "SENT_BYTES" << YAML::Value << cost.sent_bytes;
     msg << YAML::EndMap;
     return msg.c_str();
 }
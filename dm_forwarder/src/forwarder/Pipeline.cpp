@@ -0,0 +1,141 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iterator>
+#include <exception>
+#include <core/SimpleLogger.h>
+#include <core/Tracer.h>
+#include <forwarder/Pipeline.h>
+
+Stage::Stage(const std::string& name, const int capacity) :
+        _name{name},
+        _capacity(capacity > 0 ? capacity : 1),
+        _stop{false} {
+    _worker = std::thread(&Stage::run, this);
+}
+
+Stage::~Stage() {
+    join();
+}
+
+void Stage::push(std::function<void ()> job,
+                 const std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    if (!_stop && ahead(deadline) >= _capacity) {
+        TraceSpan span("stage_full", "", _name);
+        _not_full.wait(lk, [this, deadline]() {
+            return _stop || ahead(deadline) < _capacity;
+        });
+    }
+
+    if (_stop) {
+        LOG_WRN << "Stage " << _name << " is stopped, dropping job";
+        return;
+    }
+
+    _jobs.insert(std::make_pair(deadline, std::move(job)));
+    _not_empty.notify_one();
+}
+
+size_t Stage::size() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _jobs.size();
+}
+
+void Stage::stop() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _stop = true;
+    _not_empty.notify_all();
+    _not_full.notify_all();
+}
+
+void Stage::join() {
+    stop();
+    if (_worker.joinable()) {
+        _worker.join();
+    }
+}
+
+size_t Stage::ahead(const std::chrono::steady_clock::time_point deadline) {
+    return std::distance(_jobs.begin(), _jobs.upper_bound(deadline));
+}
+
+void Stage::run() {
+    Tracer::instance().name_thread(_name);
+    while (true) {
+        std::function<void ()> job;
+        {
+            std::unique_lock<std::mutex> lk(_mutex);
+            _not_empty.wait(lk, [this]() {
+                return _stop || !_jobs.empty();
+            });
+
+            if (_jobs.empty()) {
+                break;
+            }
+
+            job = std::move(_jobs.begin()->second);
+            _jobs.erase(_jobs.begin());
+
+            // producers wait on different deadlines
+            _not_full.notify_all();
+        }
+
+        try {
+            job();
+        }
+        catch (std::exception& e) {
+            LOG_CRT << "Stage " << _name << " job failed because " << e.what();
+        }
+    }
+    LOG_INF << "Stage " << _name << " ended";
+}
+
+Pipeline::Pipeline(const int images_in_flight) :
+        _fetch("fetch", images_in_flight),
+        _format("format", images_in_flight),
+        _transfer("transfer", images_in_flight) {
+    LOG_INF << "Pipeline started with " << images_in_flight
+            << " images in flight per stage";
+}
+
+Pipeline::~Pipeline() {
+    _fetch.join();
+    _format.join();
+    _transfer.join();
+}
+
+void Pipeline::fetch(std::function<void ()> job,
+                     const std::chrono::steady_clock::time_point deadline) {
+    _fetch.push(std::move(job), deadline);
+}
+
+void Pipeline::format(std::function<void ()> job,
+                      const std::chrono::steady_clock::time_point deadline) {
+    _format.push(std::move(job), deadline);
+}
+
+void Pipeline::transfer(std::function<void ()> job,
+                        const std::chrono::steady_clock::time_point deadline) {
+    _transfer.push(std::move(job), deadline);
+}
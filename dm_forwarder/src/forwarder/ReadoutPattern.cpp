@@ -21,6 +21,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <map>
+#include <mutex>
 #include <daq/Location.hh>
 #include <daq/ScienceSet.hh>
 #include <daq/WavefrontSet.hh>
@@ -41,10 +43,90 @@ std::vector<int> DATA_SEGMENT {
     8, 9, 10, 11, 12, 13, 14, 15
 };
 
-ReadoutPattern::ReadoutPattern(const YAML::Node& n) : _root{n} {
+namespace {
+    struct sensor_cache {
+        std::mutex mutex;
+        std::map<std::string, SensorType> sensors;
+    };
+
+    sensor_cache& sensors() {
+        // leaked so that tasks still running during exit can look up
+        static sensor_cache* cache = new sensor_cache();
+        return *cache;
+    }
+}
+
+template <typename T, typename F>
+void ReadoutPattern::compile(compiled<T>& c, F read) {
+    c.value = T();
+    try {
+        c.value = read();
+    }
+    catch (L1::InvalidReadoutPattern& e) {
+        c.error = e.what();
+    }
+    catch (YAML::Exception& e) {
+        c.error = std::string("Cannot read readout pattern because ")
+            + e.what();
+    }
+}
+
+template <typename T>
+const T& ReadoutPattern::get(const compiled<T>& c) {
+    if (!c.error.empty()) {
+        LOG_CRT << c.error;
+        throw L1::InvalidReadoutPattern(c.error);
+    }
+    return c.value;
+}
+
+ReadoutPattern::ReadoutPattern(const YAML::Node& n) {
+    const SensorType types[] = {
+        DAQ::Sensor::Type::WAVEFRONT,
+        DAQ::Sensor::Type::GUIDE,
+        DAQ::Sensor::Type::SCIENCE
+    };
+
+    for (auto&& type : types) {
+        const std::string name = DAQ::Sensor::encode(type);
+        sensor_pattern& p = _table[type];
+        compile(p.data_segment_name, [&]() {
+            return read_data_segment_name(n, name);
+        });
+        compile(p.data_segment, [&]() {
+            return read_data_segment(n, name);
+        });
+        compile(p.sensor_order, [&]() {
+            return read_sensor_order(n, name);
+        });
+        compile(p.xor_pattern, [&]() {
+            return read_xor(n, name);
+        });
+    }
+}
+
+const ReadoutPattern::sensor_pattern& ReadoutPattern::at(
+        const SensorType sensor) const {
+    if (sensor < DAQ::Sensor::Type::WAVEFRONT ||
+            sensor > DAQ::Sensor::Type::SCIENCE) {
+        std::ostringstream err;
+        err << "Sensor type " << int(sensor) << " has no readout pattern.";
+        LOG_CRT << err.str();
+        throw L1::InvalidReadoutPattern(err.str());
+    }
+    return _table[sensor];
 }
 
 DAQ::Sensor::Type ReadoutPattern::sensor(const std::string& location) {
+    sensor_cache& cache = sensors();
+    {
+        std::lock_guard<std::mutex> lk(cache.mutex);
+        auto it = cache.sensors.find(location);
+        if (it != cache.sensors.end()) {
+            return it->second;
+        }
+    }
+
     DAQ::Location loc(location.c_str());
 
     DAQ::ScienceSet s;
@@ -58,25 +140,48 @@ DAQ::Sensor::Type ReadoutPattern::sensor(const std::string& location) {
         throw L1::InvalidLocation(err.str());
     }
 
-    if (s.has(loc)) return DAQ::Sensor::Type::SCIENCE;
-    else if (g.has(loc)) return DAQ::Sensor::Type::GUIDE;
-    else if (w.has(loc)) return DAQ::Sensor::Type::WAVEFRONT;
+    SensorType type;
+    if (s.has(loc)) type = DAQ::Sensor::Type::SCIENCE;
+    else if (g.has(loc)) type = DAQ::Sensor::Type::GUIDE;
+    else if (w.has(loc)) type = DAQ::Sensor::Type::WAVEFRONT;
     else {
         std::ostringstream err;
         err << "DAQ Location is undefined sensor type.";
         LOG_CRT << err.str();
         throw L1::InvalidLocation(err.str());
     }
+
+    std::lock_guard<std::mutex> lk(cache.mutex);
+    cache.sensors[location] = type;
+    return type;
+}
+
+const std::vector<std::string>& ReadoutPattern::data_segment_name(
+        const SensorType sensor) const {
+    return get(at(sensor).data_segment_name);
+}
+
+const std::vector<int>& ReadoutPattern::data_segment(
+        const SensorType sensor) const {
+    return get(at(sensor).data_segment);
 }
 
-std::vector<std::string> ReadoutPattern::data_segment_name(SensorType& sensor) {
-    std::string sensor_name = DAQ::Sensor::encode(sensor);
-    YAML::Node node = _root["DATA_SEGMENT_NAME"][sensor_name];
+const std::vector<int>& ReadoutPattern::sensor_order(
+        const SensorType sensor) const {
+    return get(at(sensor).sensor_order);
+}
+
+int ReadoutPattern::get_xor(const SensorType sensor) const {
+    return get(at(sensor).xor_pattern);
+}
+
+std::vector<std::string> ReadoutPattern::read_data_segment_name(
+        const YAML::Node& root, const std::string& sensor_name) {
+    YAML::Node node = root["DATA_SEGMENT_NAME"][sensor_name];
     if (!node) {
         std::ostringstream err;
         err << "Config file does not contain DATA_SEGMENT_NAME::"
             << sensor_name;
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -88,7 +193,6 @@ std::vector<std::string> ReadoutPattern::data_segment_name(SensorType& sensor) {
         std::ostringstream err;
         err << "DATA_SEGMENT_NAME:: " << sensor_name
             << " is invalid data type. Expecting strings of 00-07, 10-17";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -102,21 +206,19 @@ std::vector<std::string> ReadoutPattern::data_segment_name(SensorType& sensor) {
         std::ostringstream err;
         err << "DATA_SEGMENT_NAME::" << sensor_name << " is not valid pattern."
             << "Sample is 00-07, 10-17";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
     return names;
 }
 
-std::vector<int> ReadoutPattern::data_segment(SensorType& sensor) {
-    std::string sensor_name = DAQ::Sensor::encode(sensor);
-    YAML::Node node = _root["DATA_SEGMENT"][sensor_name];
+std::vector<int> ReadoutPattern::read_data_segment(
+        const YAML::Node& root, const std::string& sensor_name) {
+    YAML::Node node = root["DATA_SEGMENT"][sensor_name];
     if (!node) {
         std::ostringstream err;
         err << "Config file does not contain DATA_SEGMENT::"
             << sensor_name;
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -128,7 +230,6 @@ std::vector<int> ReadoutPattern::data_segment(SensorType& sensor) {
         std::ostringstream err;
         err << "DATA_SEGMENT:: " << sensor_name
             << " is invalid data type. Expecting int from 0-15";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -142,39 +243,35 @@ std::vector<int> ReadoutPattern::data_segment(SensorType& sensor) {
         std::ostringstream err;
         err << "DATA_SEGMENT::" << sensor_name << " is not valid pattern."
             << "Sample is 0-15";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
     return data;
 }
 
-std::vector<int> ReadoutPattern::sensor_order(SensorType& sensor) {
-    std::string sensor_name = DAQ::Sensor::encode(sensor);
+std::vector<int> ReadoutPattern::read_sensor_order(
+        const YAML::Node& root, const std::string& sensor_name) {
     try {
-        return _root["DATA_SENSOR"][sensor_name].as<std::vector<int>>();
+        return root["DATA_SENSOR"][sensor_name].as<std::vector<int>>();
     }
-    catch (YAML::TypedBadConversion<std::vector<int>>& e) {
+    catch (YAML::Exception& e) {
         std::ostringstream err;
         err << "Cannot read either DATA_SENSOR from pattern or "
             << " Sensor " << sensor_name << " is not valid";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 }
 
-int ReadoutPattern::get_xor(SensorType& sensor) {
-    std::string sensor_name = DAQ::Sensor::encode(sensor);
-
+int ReadoutPattern::read_xor(const YAML::Node& root,
+                             const std::string& sensor_name) {
     YAML::Node node;
     try {
-        node = _root["XOR"][sensor_name];
+        node = root["XOR"][sensor_name];
     }
     catch (YAML::BadSubscript& e) {
         std::ostringstream err;
         err << "Trying to access XOR::" << sensor_name << " but node does not "
             << "exist.";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -182,7 +279,6 @@ int ReadoutPattern::get_xor(SensorType& sensor) {
         std::ostringstream err;
         err << "Config file does not contain XOR::"
             << sensor_name;
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
@@ -194,7 +290,6 @@ int ReadoutPattern::get_xor(SensorType& sensor) {
         std::ostringstream err;
         err << "XOR:: " << sensor_name
             << " is invalid data type. Expecting int";
-        LOG_CRT << err.str();
         throw L1::InvalidReadoutPattern(err.str());
     }
 
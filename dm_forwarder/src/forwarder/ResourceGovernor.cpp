@@ -0,0 +1,170 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <core/Metrics.h>
+#include <core/SimpleLogger.h>
+#include <core/Tracer.h>
+#include <forwarder/ResourceGovernor.h>
+
+ResourceGovernor::ResourceGovernor(const uint64_t memory,
+                                   const uint64_t spool) :
+        _memory_cap{memory},
+        _spool_cap{spool},
+        _memory{0},
+        _spool{0},
+        _next_ticket{0} {
+}
+
+uint64_t ResourceGovernor::admit(const std::string& image_id,
+                                 const uint64_t memory,
+                                 const uint64_t spool,
+                                 const Info::MODE mode) {
+    StageTimer timer(Metrics::instance().latency("admission"));
+    TraceSpan span("admission", image_id);
+
+    const bool live = mode != Info::MODE::CATCHUP;
+    std::deque<uint64_t>& queue = live ? _live : _catchup;
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    const uint64_t ticket = _next_ticket++;
+    queue.push_back(ticket);
+
+    // catch-up waits for every live image, both wait for earlier arrivals
+    // of their own mode
+    _released.wait(lk, [&]() {
+        return queue.front() == ticket && (live || _live.empty()) &&
+            fits(memory, spool);
+    });
+    queue.pop_front();
+
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        reservation r = { 0, 0, std::chrono::steady_clock::now() };
+        it = _images.insert(std::make_pair(image_id, r)).first;
+    }
+    it->second.memory += memory;
+    it->second.spool += spool;
+    _memory += memory;
+    _spool += spool;
+    report();
+
+    // the next waiter may fit as well
+    _released.notify_all();
+    lk.unlock();
+
+    timer.stop();
+    span.stop();
+    uint64_t waited = timer.elapsed();
+    if (waited > 1000000) {
+        LOG_WRN << "Image " << image_id << " waited " << waited / 1000
+                << " ms for " << memory << " bytes of memory and " << spool
+                << " bytes of spool";
+    }
+    return waited;
+}
+
+void ResourceGovernor::release_memory(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        return;
+    }
+    _memory -= it->second.memory;
+    it->second.memory = 0;
+    report();
+    _released.notify_all();
+}
+
+void ResourceGovernor::set_spool(const std::string& image_id,
+                                 const uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        return;
+    }
+    _spool = _spool - it->second.spool + bytes;
+    it->second.spool = bytes;
+    report();
+    _released.notify_all();
+}
+
+void ResourceGovernor::release(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto it = _images.find(image_id);
+    if (it == _images.end()) {
+        return;
+    }
+    erase(it);
+    report();
+    _released.notify_all();
+}
+
+void ResourceGovernor::expire(const std::chrono::seconds age) {
+    auto oldest = std::chrono::steady_clock::now() - age;
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (auto it = _images.begin(); it != _images.end(); ) {
+        if (it->second.admitted < oldest) {
+            LOG_WRN << "Releasing resources of stale image " << it->first;
+            auto stale = it++;
+            erase(stale);
+        }
+        else {
+            ++it;
+        }
+    }
+    report();
+    _released.notify_all();
+}
+
+uint64_t ResourceGovernor::memory() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _memory;
+}
+
+uint64_t ResourceGovernor::spool() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _spool;
+}
+
+bool ResourceGovernor::fits(const uint64_t memory, const uint64_t spool) {
+    if (_images.empty()) {
+        return true;
+    }
+    bool memory_fits = !_memory_cap || _memory + memory <= _memory_cap;
+    bool spool_fits = !_spool_cap || _spool + spool <= _spool_cap;
+    return memory_fits && spool_fits;
+}
+
+void ResourceGovernor::erase(
+        std::map<std::string, reservation>::iterator it) {
+    _memory -= it->second.memory;
+    _spool -= it->second.spool;
+    _images.erase(it);
+}
+
+void ResourceGovernor::report() {
+    Metrics& metrics = Metrics::instance();
+    metrics.gauge("governor_bytes", "memory").set(_memory);
+    metrics.gauge("governor_bytes", "spool").set(_spool);
+}
@@ -23,114 +23,318 @@
 
 #include <sstream>
 #include <algorithm>
+#include <functional>
 #include <core/Exceptions.h>
 #include <core/SimpleLogger.h>
-#include <core/RedisConnection.h>
 #include <forwarder/Scoreboard.h>
 
-const std::string TARGET = ":target";
+const std::string IMAGES = "scoreboard:images";
 const std::string CCD = ":ccd";
-const std::string HEADER = ":header";
-const std::string SESSION_ID = ":session_id";
-const std::string JOB_NUM = ":job_num";
-const std::string LOCATIONS = ":locations";
+const std::string TARGET = "target";
+const std::string HEADER = "header";
+const std::string SESSION_ID = "session_id";
+const std::string JOB_NUM = "job_num";
+const std::string LOCATIONS = "locations";
+const std::string MODE = "mode";
+const std::string FETCHED = "fetched";
 
-Scoreboard::Scoreboard(const std::string& host,
-                       const int& port,
-                       const int& db_num,
-                       const std::string& password) {
-    _con = std::unique_ptr<RedisConnection>(
-            new RedisConnection(host, port, db_num));
+Scoreboard::Scoreboard(const int ttl) :
+        _ttl(ttl) {
+}
 
-    _con->flushdb();
-    _con->exec();
+Scoreboard::Scoreboard(const redis_connection_params& params, const int ttl) :
+        _ttl(ttl) {
+    _con = std::unique_ptr<AsyncRedis>(new AsyncRedis(params));
+    restore();
 }
 
 Scoreboard::~Scoreboard() {
+    // AsyncRedis waits for outstanding writes before it stops
+    _con.reset();
+}
 
+Scoreboard::stripe& Scoreboard::stripe_of(const std::string& image_id) {
+    size_t h = std::hash<std::string>()(image_id);
+    return _stripes[h % SCOREBOARD_STRIPES];
 }
 
-bool Scoreboard::ready(const std::string& image_id) {
-    _con->exists(image_id + CCD);
-    _con->exists(image_id + HEADER);
-    std::vector<Reply> replies = _con->exec();
+readout_info& Scoreboard::entry(stripe& s, const std::string& image_id) {
+    auto it = s.images.find(image_id);
+    if (it != s.images.end()) {
+        return it->second.info;
+    }
+
+    // images that never completed are dropped when a new one shows up in
+    // the same stripe
+    auto now = std::chrono::steady_clock::now();
+    sweep(s, now);
+
+    image_state& state = s.images[image_id];
+    state.expires = now + _ttl;
+    return state.info;
+}
 
-    bool flag = true;
-    for (auto&& r : replies) {
-        flag = flag && r.integer;
+void Scoreboard::sweep(stripe& s,
+                       const std::chrono::steady_clock::time_point now) {
+    for (auto i = s.images.begin(); i != s.images.end();) {
+        if (i->second.expires < now) {
+            LOG_WRN << "Scoreboard dropped expired image " << i->first;
+            i = s.images.erase(i);
+        }
+        else {
+            ++i;
+        }
     }
-    return flag;
 }
 
-void Scoreboard::remove(const std::string& image_id) {
-    _con->keys(image_id + "*");
-    std::vector<Reply> results = _con->exec();
+void Scoreboard::expire() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto&& s : _stripes) {
+        std::lock_guard<std::mutex> lk(s.mutex);
+        sweep(s, now);
+    }
+}
 
-    std::vector<std::string> keys;
-    for (auto&& val : results[0].elements) {
-        keys.push_back(val.str);
+bool Scoreboard::ready(const std::string& image_id) {
+    stripe& s = stripe_of(image_id);
+    std::lock_guard<std::mutex> lk(s.mutex);
+    auto it = s.images.find(image_id);
+    if (it == s.images.end()) {
+        return false;
     }
-    _con->del(keys);
-    _con->exec();
+    const readout_info& info = it->second.info;
+    return info.fetched && !info.ccds.empty() && !info.header.empty();
+}
+
+void Scoreboard::remove(const std::string& image_id) {
+    {
+        stripe& s = stripe_of(image_id);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        s.images.erase(image_id);
+    }
+
+    mirror({
+        { "del", image_id, image_id + CCD },
+        { "srem", IMAGES, image_id }
+    });
 }
 
 void Scoreboard::add_xfer(const std::string& image_id, const xfer_info& xfer) {
-    _con->set(image_id + TARGET, xfer.target);
-    _con->set(image_id + SESSION_ID, xfer.session_id);
-    _con->set(image_id + JOB_NUM, xfer.job_num);
-    _con->lpush(image_id + LOCATIONS, xfer.locations);
-    _con->exec();
+    std::string locations;
+    {
+        stripe& s = stripe_of(image_id);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        xfer_info& info = entry(s, image_id).xfer;
+        info.target = xfer.target;
+        info.session_id = xfer.session_id;
+        info.job_num = xfer.job_num;
+        info.mode = xfer.mode;
+        info.locations = xfer.locations;
+
+        for (auto&& loc : info.locations) {
+            locations += (locations.empty() ? "" : " ") + loc;
+        }
+    }
+
+    const std::string ttl = std::to_string(_ttl.count());
+    mirror({
+        { "hmset", image_id, TARGET, xfer.target, SESSION_ID, xfer.session_id,
+            JOB_NUM, xfer.job_num, LOCATIONS, locations,
+            MODE, Info::decode(xfer.mode) },
+        { "expire", image_id, ttl },
+        { "sadd", IMAGES, image_id }
+    });
 }
 
 xfer_info Scoreboard::get_xfer(const std::string& image_id) {
-    _con->get(image_id + SESSION_ID);
-    _con->get(image_id + JOB_NUM);
-    _con->get(image_id + TARGET);
-    std::vector<Reply> r = _con->exec();
-
-    xfer_info info;
-    info.session_id = r[0].str;
-    info.job_num = r[1].str;
-    info.target = r[2].str;
-    info.locations = locations(image_id);
-    return info;
+    return get(image_id).xfer;
 }
 
 void Scoreboard::add_header(const std::string& image_id,
                             const std::string& path) {
-    _con->set(image_id + HEADER, path);
-    _con->exec();
+    {
+        stripe& s = stripe_of(image_id);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        entry(s, image_id).header = path;
+    }
+
+    const std::string ttl = std::to_string(_ttl.count());
+    mirror({
+        { "hset", image_id, HEADER, path },
+        { "expire", image_id, ttl },
+        { "sadd", IMAGES, image_id }
+    });
 }
 
-void Scoreboard::set_fwd(const std::string& key, const std::string& body) {
-    _con->lpush(key, { body });
-    _con->exec();
+void Scoreboard::add_ccd(const std::string& image_id,
+                         const std::string& path) {
+    {
+        stripe& s = stripe_of(image_id);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        entry(s, image_id).ccds.push_back(path);
+    }
+
+    const std::string ttl = std::to_string(_ttl.count());
+    mirror({
+        { "sadd", image_id + CCD, path },
+        { "expire", image_id + CCD, ttl },
+        { "sadd", IMAGES, image_id }
+    });
 }
 
-std::vector<std::string> Scoreboard::locations(const std::string& image_id) {
-    _con->lrange(image_id + LOCATIONS, "0", "-1");
-    std::vector<Reply> reply = _con->exec();
+void Scoreboard::set_fetched(const std::string& image_id) {
+    {
+        stripe& s = stripe_of(image_id);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        entry(s, image_id).fetched = true;
+    }
 
-    std::vector<std::string> locations;
-    for (auto&& loc : reply[0].elements) {
-        locations.push_back(loc.str);
+    const std::string ttl = std::to_string(_ttl.count());
+    mirror({
+        { "hset", image_id, FETCHED, "true" },
+        { "expire", image_id, ttl },
+        { "sadd", IMAGES, image_id }
+    });
+}
+
+void Scoreboard::set_deadline(
+        const std::string& image_id,
+        const std::chrono::steady_clock::time_point deadline) {
+    stripe& s = stripe_of(image_id);
+    std::lock_guard<std::mutex> lk(s.mutex);
+    entry(s, image_id).deadline = deadline;
+}
+
+void Scoreboard::set_fwd(const std::string& key, const std::string& body) {
+    mirror({ { "lpush", key, body } });
+}
+
+readout_info Scoreboard::get(const std::string& image_id) {
+    stripe& s = stripe_of(image_id);
+    std::lock_guard<std::mutex> lk(s.mutex);
+    auto it = s.images.find(image_id);
+    if (it == s.images.end()) {
+        return readout_info();
     }
-    return locations;
+    return it->second.info;
+}
+
+std::vector<std::string> Scoreboard::locations(const std::string& image_id) {
+    return get(image_id).xfer.locations;
 }
 
 std::string Scoreboard::header(const std::string& image_id) {
-    _con->get(image_id + HEADER);
-    std::vector<Reply> r = _con->exec();
-    return r[0].str;
+    return get(image_id).header;
 }
 
 std::vector<std::string> Scoreboard::ccds(const std::string& image_id) {
-    _con->lrange(image_id + CCD, "0", "-1");
-    std::vector<Reply> r = _con->exec();
+    return get(image_id).ccds;
+}
+
+void Scoreboard::restore() {
+    std::vector<std::string> ids;
+    std::vector<std::future<Reply>> replies;
+    try {
+        Reply r = _con->call({ "smembers", IMAGES }).get();
+        for (auto&& id : r.elements) {
+            ids.push_back(id.str);
+        }
+
+        // queued together so the event loop pipelines them
+        for (auto&& id : ids) {
+            replies.push_back(_con->call({ "hgetall", id }));
+            replies.push_back(_con->call({ "smembers", id + CCD }));
+        }
+        for (auto&& reply : replies) {
+            reply.wait();
+        }
+    }
+    catch (L1::RedisError& e) {
+        // redis only mirrors the in-memory state, start empty
+        LOG_CRT << "Scoreboard cannot restore images from redis because "
+                << e.what();
+        return;
+    }
+    if (ids.empty()) {
+        return;
+    }
+
+    std::vector<std::string> expired;
+    for (size_t i = 0; i < ids.size(); i++) {
+        Reply hash, ccds;
+        try {
+            hash = replies[2*i].get();
+            ccds = replies[2*i + 1].get();
+        }
+        catch (L1::RedisError& e) {
+            LOG_CRT << "Scoreboard cannot restore " << ids[i] << " because "
+                    << e.what();
+            continue;
+        }
+        if (hash.elements.empty() && ccds.elements.empty()) {
+            expired.push_back(ids[i]);
+            continue;
+        }
+
+        stripe& s = stripe_of(ids[i]);
+        std::lock_guard<std::mutex> lk(s.mutex);
+        readout_info& info = entry(s, ids[i]);
+        for (size_t j = 0; j + 1 < hash.elements.size(); j += 2) {
+            const std::string& field = hash.elements[j].str;
+            const std::string& value = hash.elements[j+1].str;
+            if (field == TARGET) {
+                info.xfer.target = value;
+            }
+            else if (field == SESSION_ID) {
+                info.xfer.session_id = value;
+            }
+            else if (field == JOB_NUM) {
+                info.xfer.job_num = value;
+            }
+            else if (field == HEADER) {
+                info.header = value;
+            }
+            else if (field == MODE) {
+                info.xfer.mode = Info::encode(value);
+            }
+            else if (field == FETCHED) {
+                info.fetched = value == "true";
+            }
+            else if (field == LOCATIONS) {
+                std::istringstream locations(value);
+                std::string loc;
+                while (locations >> loc) {
+                    info.xfer.locations.push_back(loc);
+                }
+            }
+        }
+        for (auto&& ccd : ccds.elements) {
+            info.ccds.push_back(ccd.str);
+        }
+    }
+
+    if (!expired.empty()) {
+        std::vector<std::string> args{ "srem", IMAGES };
+        args.insert(args.end(), expired.begin(), expired.end());
+        _con->send(std::move(args));
+    }
+    LOG_INF << "Scoreboard restored " << ids.size() - expired.size()
+            << " images from redis";
+}
+
+void Scoreboard::mirror(std::vector<std::vector<std::string>> commands) {
+    if (!_con) {
+        return;
+    }
+
+    // failures are logged by AsyncRedis, readout carries on
+    for (auto&& command : commands) {
+        _con->send(std::move(command));
+    }
+}
 
-    std::vector<std::string> sensors;
-    for (auto&& ccd : r[0].elements) {
-        sensors.push_back(ccd.str);
+void Scoreboard::flush() {
+    if (_con) {
+        _con->flush();
     }
-    return sensors;
 }
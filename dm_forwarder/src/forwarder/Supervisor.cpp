@@ -0,0 +1,553 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+#include <core/Exceptions.h>
+#include <core/Consumer.h>
+#include <core/SimpleLogger.h>
+#include <core/SimplePublisher.h>
+#include <forwarder/Supervisor.h>
+
+// seconds between checks for workers that exited
+#define SV_REAP_INTERVAL 1
+// seconds a worker runs before its exit no longer counts as a failed start
+#define SV_STABLE_UPTIME 60
+// failed starts in a row after which a worker is left down
+#define SV_MAX_FAST_EXITS 5
+#define SV_METRICS_INTERVAL 10
+
+Supervisor::Supervisor(const std::string& config,
+                       const std::string& log,
+                       std::shared_ptr<Publisher> pub) :
+                           IIPBase(config, log)
+                           , _pub(pub) {
+    std::string ip_host, partition, metrics_file;
+    int metrics_port = 0;
+    int metrics_interval = SV_METRICS_INTERVAL;
+    try {
+        ip_host = _config_root["BASE_BROKER_ADDR"].as<std::string>();
+        _node = std::unique_ptr<ForwarderNode>(new ForwarderNode(
+                    _config_root));
+
+        if (_config_root["METRICS_FILE"]) {
+            metrics_file = _config_root["METRICS_FILE"].as<std::string>();
+        }
+        if (_config_root["METRICS_PORT"]) {
+            metrics_port = _config_root["METRICS_PORT"].as<int>();
+        }
+        if (_config_root["METRICS_INTERVAL"]) {
+            metrics_interval = _config_root["METRICS_INTERVAL"].as<int>();
+        }
+
+        // every group must be a part of the partition, pinned to cores of
+        // its own or of a NUMA node
+        partition = _config_root["PARTITION"].as<std::string>();
+        const std::vector<std::string> daq_locations = _config_root[partition]
+                .as<std::vector<std::string>>();
+        const YAML::Node groups = _config_root["WORKERS"];
+        if (!groups || !groups.size()) {
+            LOG_CRT << "Supervisor needs at least one group in WORKERS";
+            exit(EXIT_FAILURE);
+        }
+
+        _workers.resize(groups.size());
+        for (size_t i = 0; i < groups.size(); i++) {
+            worker& w = _workers[i];
+            w.pid = 0;
+            w.failures = 0;
+            w.locations = groups[i]["LOCATIONS"]
+                    .as<std::vector<std::string>>();
+            if (share(w.locations, daq_locations).size() !=
+                    w.locations.size()) {
+                LOG_CRT << "Locations of worker " << i << " are not all "
+                        << "defined in " << partition;
+                exit(EXIT_FAILURE);
+            }
+
+            std::string cpulist;
+            if (groups[i]["CPUS"]) {
+                cpulist = groups[i]["CPUS"].as<std::string>();
+            }
+            else if (groups[i]["NUMA_NODE"]) {
+                const std::string node = "/sys/devices/system/node/node" +
+                    groups[i]["NUMA_NODE"].as<std::string>() + "/cpulist";
+                std::ifstream f(node);
+                if (!std::getline(f, cpulist)) {
+                    LOG_CRT << "Cannot read cores of NUMA node from " << node;
+                    exit(EXIT_FAILURE);
+                }
+            }
+            if (!cpulist.empty()) {
+                w.cpus = parse_cpus(cpulist);
+                if (w.cpus.empty()) {
+                    LOG_CRT << "Cores " << cpulist << " of worker " << i
+                            << " are malformed";
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+    catch (YAML::TypedBadConversion<std::string>& e) {
+        LOG_CRT << "YAML bad conversion for std::string";
+        exit(EXIT_FAILURE);
+    }
+    catch (YAML::TypedBadConversion<int>& e) {
+        LOG_CRT << "YAML bad conversion for int";
+        exit(EXIT_FAILURE);
+    }
+    catch (YAML::TypedBadConversion<std::vector<std::string>>& e) {
+        LOG_CRT << "YAML bad conversion for vector<string>";
+        exit(EXIT_FAILURE);
+    }
+
+    const std::string user = _credentials->get_user("service_user");
+    const std::string passwd = _credentials->get_user("service_passwd");
+    _amqp_url = "amqp://" + user + ":" + passwd + "@" + ip_host;
+
+    // HEADER_READY, END_READOUT and TRACE go to every worker
+    ForwarderNode::handlers handlers;
+    handlers.health_check = std::bind(&Supervisor::health_check, this,
+            std::placeholders::_1);
+    handlers.xfer_params = std::bind(&Supervisor::xfer_params, this,
+            std::placeholders::_1);
+    handlers.header_ready = std::bind(&Supervisor::broadcast, this,
+            std::placeholders::_1);
+    handlers.end_readout = handlers.header_ready;
+    handlers.process_ack = std::bind(&Supervisor::process_ack, this,
+            std::placeholders::_1);
+    handlers.associated = std::bind(&Supervisor::associated, this,
+            std::placeholders::_1);
+    handlers.scan = std::bind(&Supervisor::scan, this,
+            std::placeholders::_1);
+    handlers.trace = handlers.header_ready;
+    _actions = ForwarderNode::actions(handlers);
+
+    try {
+        if (!_pub) {
+            _pub = std::make_shared<SimplePublisher>(_amqp_url);
+        }
+    }
+    catch (L1::PublisherError& e) {
+        exit(EXIT_FAILURE);
+    }
+
+    _remote = std::unique_ptr<AsyncRedis>(new AsyncRedis(_node->remote()));
+    _node->register_fwd(*_remote);
+
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        for (size_t i = 0; i < _workers.size(); i++) {
+            spawn(i);
+        }
+    }
+
+    _scheduler = std::unique_ptr<Scheduler>(new Scheduler());
+    _beacon = std::unique_ptr<Beacon>(new Beacon(*_scheduler, *_remote,
+                _node->heartbeat(*_remote)));
+    _watcher = std::unique_ptr<Watcher>(new Watcher(*_scheduler, *_remote));
+    _scheduler->every(std::chrono::seconds(SV_REAP_INTERVAL), [this]() {
+        reap();
+    });
+
+    if (!metrics_file.empty()) {
+        _scheduler->every(std::chrono::seconds(metrics_interval),
+                [metrics_file]() {
+            try {
+                Metrics::instance().dump(metrics_file);
+            }
+            catch (L1::MetricsError& e) { }
+        });
+    }
+    if (metrics_port > 0) {
+        try {
+            _metrics = std::unique_ptr<MetricsServer>(
+                    new MetricsServer(metrics_port));
+        }
+        catch (L1::MetricsError& e) { }
+    }
+}
+
+Supervisor::~Supervisor() {
+    _beacon.reset();
+    _watcher->clear();
+    _metrics.reset();
+
+    // no restarts while workers shut down
+    _remote.reset();
+    _watcher.reset();
+    _scheduler.reset();
+
+    // workers drain their images once their pipe is closed, what they
+    // publish meanwhile is still relayed
+    for (auto&& w : _workers) {
+        if (w.pipe) {
+            w.pipe->shutdown();
+        }
+    }
+    for (auto&& w : _workers) {
+        if (w.pid > 0) {
+            int status;
+            waitpid(w.pid, &status, 0);
+        }
+        if (w.relay.joinable()) {
+            w.relay.join();
+        }
+    }
+}
+
+void Supervisor::on_message(const std::string& message) {
+    try {
+        LOG_DBG << "Received message " << message;
+        const YAML::Node n = YAML::Load(message);
+        const std::string message_type = n["MSG_TYPE"].as<std::string>();
+        _actions[message_type](n);
+    }
+    catch(std::exception& e) {
+        LOG_CRT << e.what();
+    }
+}
+
+void Supervisor::run() {
+    try {
+        Consumer consumer(_amqp_url, _node->consume_q());
+        auto on_msg = bind(&Supervisor::on_message, this,
+                std::placeholders::_1);
+        consumer.run(on_msg);
+    }
+    catch (L1::ConsumerError& e) { exit(-1); }
+    catch (std::exception& e) {
+        LOG_CRT << e.what();
+        exit(-1);
+    }
+}
+
+void Supervisor::health_check(const YAML::Node& n) {
+    const size_t running = alive();
+    if (running < _workers.size()) {
+        LOG_WRN << "Only " << running << " of " << _workers.size()
+                << " workers are running";
+    }
+    _node->publish_ack(*_pub, n, running == _workers.size());
+}
+
+void Supervisor::xfer_params(const YAML::Node& n) {
+    try {
+        _node->publish_ack(*_pub, n);
+
+        auto locations = n["XFER_PARAMS"]["RAFT_CCD_LIST"]
+                .as<std::vector<std::string>>();
+        size_t handled = 0;
+        for (size_t i = 0; i < _workers.size(); i++) {
+            const std::vector<std::string> ours = share(locations,
+                    _workers[i].locations);
+            if (ours.empty()) {
+                continue;
+            }
+            YAML::Node params = YAML::Clone(n);
+            params["XFER_PARAMS"]["RAFT_CCD_LIST"] = ours;
+            send(i, YAML::Dump(params));
+            handled += ours.size();
+        }
+
+        if (handled < locations.size()) {
+            std::ostringstream loc_str;
+            for (auto&& loc : locations) {
+                loc_str << loc << " ";
+            }
+            LOG_CRT << "Locations provided by xfer_params " << loc_str.str()
+                    << " are not all handled by a worker";
+        }
+    }
+    catch (std::exception& e) {
+        LOG_CRT << e.what();
+    }
+}
+
+void Supervisor::broadcast(const YAML::Node& n) {
+    // workers without XFER_PARAMS of the image ignore it
+    _node->publish_ack(*_pub, n);
+    const std::string message = YAML::Dump(n);
+    for (size_t i = 0; i < _workers.size(); i++) {
+        send(i, message);
+    }
+}
+
+void Supervisor::process_ack(const YAML::Node& n) {
+    try {
+        const std::string msg_type = n["MSG_TYPE"].as<std::string>();
+        LOG_INF << "Got ack for message type " << msg_type;
+    }
+    catch (std::exception& e) {
+        LOG_CRT << e.what();
+    }
+}
+
+void Supervisor::associated(const YAML::Node& n) {
+    try {
+        const std::string key = n["ASSOCIATION_KEY"].as<std::string>();
+        const std::string reply_q = n["REPLY_QUEUE"].as<std::string>();
+        const std::string ack_id = n["ACK_ID"].as<std::string>();
+        const std::string msg = _builder.build_associated_ack(
+                _node->association_key(), ack_id);
+
+        _pub->publish_message(reply_q, msg);
+
+        heartbeat_params params = _node->heartbeat(*_remote);
+        params.key = key;
+        _watcher->start(params);
+
+        // workers start their DAQ stream
+        const std::string message = YAML::Dump(n);
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            _association = message;
+        }
+        for (size_t i = 0; i < _workers.size(); i++) {
+            send(i, message);
+        }
+    }
+    catch(std::exception& e) {
+        LOG_CRT << e.what();
+    }
+}
+
+void Supervisor::scan(const YAML::Node& n) {
+    // one worker reads the catalog for the node and acks
+    send(0, YAML::Dump(n));
+}
+
+size_t Supervisor::alive() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return std::count_if(_workers.begin(), _workers.end(),
+            [](const worker& w) { return w.pid > 0; });
+}
+
+std::vector<int> Supervisor::parse_cpus(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        int first, last;
+        char dash, rest;
+        std::istringstream r(range);
+        if (!(r >> first)) {
+            return std::vector<int>();
+        }
+        last = first;
+        if (r >> dash && (dash != '-' || !(r >> last))) {
+            return std::vector<int>();
+        }
+        if (r >> rest || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return std::vector<int>();
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::string> Supervisor::share(
+        const std::vector<std::string>& locations,
+        const std::vector<std::string>& group) {
+    std::vector<std::string> ours;
+    for (auto&& location : locations) {
+        if (std::find(group.begin(), group.end(), location) != group.end()) {
+            ours.push_back(location);
+        }
+    }
+    return ours;
+}
+
+void Supervisor::spawn(const size_t index) {
+    worker& w = _workers[index];
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) {
+        LOG_CRT << "Cannot create pipe for worker " << index << " because "
+                << std::strerror(errno);
+        return;
+    }
+
+    // everything the child needs is prepared before fork, other threads may
+    // hold locks, so it only makes async-signal-safe calls until exec
+    const std::string index_str = std::to_string(index);
+    const std::string fd_str = std::to_string(fds[1]);
+    char* const argv[] = {
+        const_cast<char*>("dm_forwarder"),
+        const_cast<char*>("--worker"),
+        const_cast<char*>(index_str.c_str()),
+        const_cast<char*>(fd_str.c_str()),
+        nullptr
+    };
+    // redis, AMQP and metrics sockets of the supervisor must not outlive it
+    // in a worker, which keeps only its end of the pair
+    const int max_fd = sysconf(_SC_OPEN_MAX);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto&& cpu : w.cpus) {
+        CPU_SET(cpu, &cpus);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // affinity is kept across exec and inherited by every thread the
+        // worker starts, whose memory is then first touched on their node
+        if (!w.cpus.empty()) {
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+        }
+        for (int fd = STDERR_FILENO + 1; fd < max_fd; fd++) {
+            if (fd != fds[1]) {
+                close(fd);
+            }
+        }
+        fcntl(fds[1], F_SETFD, 0);
+        execv("/proc/self/exe", argv);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    if (pid < 0) {
+        LOG_CRT << "Cannot start worker " << index << " because "
+                << std::strerror(errno);
+        close(fds[0]);
+        return;
+    }
+
+    w.pid = pid;
+    w.started = std::chrono::steady_clock::now();
+    w.pipe = std::make_shared<MessagePipe>(fds[0]);
+    w.relay = std::thread(&Supervisor::relay, this, w.pipe);
+    LOG_INF << "Started worker " << index << " with pid " << pid;
+}
+
+void Supervisor::reap() {
+    Metrics& metrics = Metrics::instance();
+    std::lock_guard<std::mutex> lk(_mutex);
+    for (size_t i = 0; i < _workers.size(); i++) {
+        worker& w = _workers[i];
+        int status = 0;
+        if (w.pid > 0 && waitpid(w.pid, &status, WNOHANG) != w.pid) {
+            continue;
+        }
+
+        if (w.pid > 0) {
+            if (WIFSIGNALED(status)) {
+                LOG_CRT << "Worker " << i << " with pid " << w.pid
+                        << " was killed by signal " << WTERMSIG(status);
+            }
+            else {
+                LOG_CRT << "Worker " << i << " with pid " << w.pid
+                        << " exited with status " << WEXITSTATUS(status);
+            }
+            metrics.counter("restarts", "worker").add();
+
+            // the relay sees the pipe close with the worker
+            if (w.relay.joinable()) {
+                w.relay.join();
+            }
+            w.pid = 0;
+            w.pipe.reset();
+
+            // a worker that fails on its configuration fails again
+            if (std::chrono::steady_clock::now() - w.started <
+                    std::chrono::seconds(SV_STABLE_UPTIME)) {
+                failed(i);
+            }
+            else {
+                w.failures = 0;
+            }
+        }
+
+        if (w.failures >= SV_MAX_FAST_EXITS ||
+                std::chrono::steady_clock::now() < w.retry) {
+            continue;
+        }
+        spawn(i);
+        if (!w.pid) {
+            failed(i);
+        }
+
+        if (w.pid > 0 && !_association.empty()) {
+            try {
+                w.pipe->publish_message(_node->consume_q(), _association);
+            }
+            catch (L1::PublisherError& e) { }
+        }
+    }
+
+    int64_t running = std::count_if(_workers.begin(), _workers.end(),
+            [](const worker& w) { return w.pid > 0; });
+    metrics.gauge("workers", "alive").set(running);
+}
+
+void Supervisor::failed(const size_t index) {
+    worker& w = _workers[index];
+    w.failures++;
+    if (w.failures >= SV_MAX_FAST_EXITS) {
+        LOG_CRT << "Worker " << index << " failed " << w.failures
+                << " times in a row, leaving it down";
+        return;
+    }
+
+    // 2, 4, 8, ... reap intervals
+    w.retry = std::chrono::steady_clock::now() +
+        std::chrono::seconds(SV_REAP_INTERVAL << w.failures);
+    LOG_WRN << "Restarting worker " << index << " in "
+            << (SV_REAP_INTERVAL << w.failures) << " seconds";
+}
+
+void Supervisor::relay(std::shared_ptr<MessagePipe> pipe) {
+    std::string queue, body;
+    while (pipe->get(queue, body)) {
+        try {
+            _pub->publish_message(queue, body);
+        }
+        catch (L1::PublisherError& e) { }
+    }
+}
+
+void Supervisor::send(const size_t index, const std::string& message) {
+    std::shared_ptr<MessagePipe> pipe;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        pipe = _workers[index].pipe;
+    }
+    if (!pipe) {
+        LOG_WRN << "Worker " << index << " is down, dropping message";
+        return;
+    }
+    try {
+        pipe->publish_message(_node->consume_q(), message);
+    }
+    catch (L1::PublisherError& e) { }
+}
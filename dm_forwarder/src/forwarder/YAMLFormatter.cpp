@@ -21,6 +21,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
 #include <core/SimpleLogger.h>
 #include <core/Exceptions.h>
 #include <forwarder/Formatter.h>
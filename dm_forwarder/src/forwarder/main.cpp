@@ -22,16 +22,45 @@
  */
 
 #include <signal.h>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include "core/SimpleLogger.h"
+#include "core/MessagePipe.h"
 #include "forwarder/miniforwarder.h"
+#include "forwarder/Supervisor.h"
 
 void signal_handler(int signum) {
     LOG_CRT << "Received CTRL-C";
     exit(-1);
 }
 
-int main() {
+/**
+ * usage: dm_forwarder
+ *        dm_forwarder --supervisor
+ *        dm_forwarder --worker <index> <fd>
+ *
+ * A supervisor starts a worker for each group of WORKERS, the worker form is
+ * only run by the supervisor.
+ */
+int main(int argc, char* argv[]) {
     signal(SIGINT, signal_handler);
+
+    if (argc == 4 && std::strcmp(argv[1], "--worker") == 0) {
+        const int worker = std::atoi(argv[2]);
+        auto pipe = std::make_shared<MessagePipe>(std::atoi(argv[3]));
+        miniforwarder fwd("ForwarderCfg.yaml",
+                "Forwarder_worker" + std::to_string(worker), pipe, worker);
+        fwd.serve(*pipe);
+        return 0;
+    }
+
+    if (argc == 2 && std::strcmp(argv[1], "--supervisor") == 0) {
+        Supervisor supervisor("ForwarderCfg.yaml", "Forwarder");
+        supervisor.run();
+        return 0;
+    }
+
     miniforwarder fwd("ForwarderCfg.yaml", "Forwarder");
     fwd.run();
     return 0;
@@ -22,8 +22,6 @@
  */
 
 #include <cstdio>
-#include <unistd.h> // gethostname
-#include <netdb.h>
 #include <future>
 
 #include <ims/Store.hh>
@@ -31,24 +29,106 @@
 #include <core/Exceptions.h>
 #include <core/Consumer.h>
 #include <core/SimpleLogger.h>
+#include <core/SimplePublisher.h>
+#include <core/Metrics.h>
+#include <core/Tracer.h>
 #include <core/RedisConnection.h>
+#include <core/RedisPool.h>
 #include <daq/Scanner.h>
 #include <forwarder/Board.h>
-#include <forwarder/YAMLFormatter.h>
+#include <forwarder/ImageCost.h>
 #include <forwarder/miniforwarder.h>
 
 #define MF_TIMEOUT 15*1000*1000
+#define MF_IMAGES_IN_FLIGHT 2
+#define MF_ARRIVAL_INDEX_SIZE 256
+#define MF_DECLUTTER_THREADS 4
+#define MF_PIXEL_POOL_BYTES (uint64_t(2) << 30)
+#define MF_PIXEL_POOL_PAGES "transparent"
+
+// one science ccd of 576 x 2048 samples with 16 segments of 4 bytes
+#define MF_ADMIT_CCD_BYTES (uint64_t(576) * 2048 * 16 * 4)
+#define MF_SCOREBOARD_TTL 24*60*60
+
+// milliseconds after END_READOUT a live image of each sensor type is due
+#define MF_DEADLINE_MS_WAVEFRONT 2000
+#define MF_DEADLINE_MS_GUIDE 1000
+#define MF_DEADLINE_MS_SCIENCE 10000
+#define MF_CATCHUP_SHARE 0.25
+#define MF_CATCHUP_CONCURRENCY 4
+#define MF_SCAN_THREADS 4
+
+// seconds between periodic maintenance tasks
+#define MF_SCOREBOARD_SWEEP 60
+#define MF_REDIS_REPORT 10*60
+#define MF_METRICS_INTERVAL 10
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+/**
+ * Runs done when the scope is left, by return or by exception, unless the
+ * work was handed on with dismiss
+ */
+struct scope_exit {
+    std::function<void ()> done;
+
+    scope_exit(std::function<void ()> f) : done(f) { }
+
+    ~scope_exit() {
+        if (done) {
+            done();
+        }
+    }
+
+    void dismiss() {
+        done = nullptr;
+    }
+};
+
+}
+
 miniforwarder::miniforwarder(const std::string& config,
-                             const std::string& log) : IIPBase(config, log)
+                             const std::string& log,
+                             std::shared_ptr<Publisher> pub,
+                             const int worker) :
+                                 IIPBase(config, log)
+                                 , _worker(worker)
+                                 , _pub(pub)
                                  , _hdr()
                                  , _readoutpattern(_config_root) {
-    std::string work_dir, ip_host, redis_host_remote,
-            redis_host_local, xfer_option;
-    int redis_port_remote, redis_db_remote, redis_port_local, redis_db_local;
+    std::string work_dir, ip_host, redis_host_local, xfer_option;
+    int redis_port_local, redis_db_local;
     int _barrier_timeout = MF_TIMEOUT;
+    int images_in_flight = MF_IMAGES_IN_FLIGHT;
+    int declutter_threads = MF_DECLUTTER_THREADS;
+    uint64_t pixel_pool_bytes = MF_PIXEL_POOL_BYTES;
+    std::string pixel_pool_pages = MF_PIXEL_POOL_PAGES;
+    uint64_t admit_memory_bytes = 0, admit_spool_bytes = 0;
+    uint64_t link_bytes_per_second = 0;
+    double catchup_share = MF_CATCHUP_SHARE;
+    int catchup_concurrency = MF_CATCHUP_CONCURRENCY;
+    std::string catchup_checkpoint;
+    std::string scan_index;
+    _scan_threads = MF_SCAN_THREADS;
+    _budgets = {
+        { DAQ::Sensor::Type::WAVEFRONT,
+            std::chrono::milliseconds(MF_DEADLINE_MS_WAVEFRONT) },
+        { DAQ::Sensor::Type::GUIDE,
+            std::chrono::milliseconds(MF_DEADLINE_MS_GUIDE) },
+        { DAQ::Sensor::Type::SCIENCE,
+            std::chrono::milliseconds(MF_DEADLINE_MS_SCIENCE) }
+    };
+    _ccd_bytes = MF_ADMIT_CCD_BYTES;
+    int arrival_index_size = MF_ARRIVAL_INDEX_SIZE;
+    _speculative_fetch = false;
+    bool scoreboard_write_behind = true;
+    int scoreboard_ttl = MF_SCOREBOARD_TTL;
+    std::string metrics_file;
+    int metrics_port = 0;
+    int metrics_interval = MF_METRICS_INTERVAL;
+    bool trace = false;
     YAML::Node pattern;
     try {
         int val = _config_root["BARRIER_TIMEOUT"].as<int>();
@@ -56,10 +136,6 @@ miniforwarder::miniforwarder(const std::string& config,
 
         work_dir = _config_root["WORK_DIR"].as<std::string>();
         ip_host = _config_root["BASE_BROKER_ADDR"].as<std::string>();
-        redis_host_remote = _config_root["REDIS"]["REMOTE"]["HOST"]
-                .as<std::string>();
-        redis_port_remote = _config_root["REDIS"]["REMOTE"]["PORT"].as<int>();
-        redis_db_remote = _config_root["REDIS"]["REMOTE"]["DB"].as<int>();
         redis_host_local = _config_root["REDIS"]["LOCAL"]["HOST"]
                 .as<std::string>();
         redis_port_local = _config_root["REDIS"]["LOCAL"]["PORT"].as<int>();
@@ -71,18 +147,144 @@ miniforwarder::miniforwarder(const std::string& config,
         _folder = _config_root["FOLDER"].as<std::string>();
 
         // Forwarder configurations
-        _name = get_name();
+        _node = std::unique_ptr<ForwarderNode>(new ForwarderNode(
+                    _config_root));
         _daq_locations = _config_root[_partition]
                 .as<std::vector<std::string>>();
-        _consume_q = _config_root["CONSUME_QUEUE"].as<std::string>();
+
+        // a supervised worker handles the locations of its group, in a
+        // work directory of its own
+        if (_worker >= 0) {
+            _daq_locations = _config_root["WORKERS"][_worker]["LOCATIONS"]
+                .as<std::vector<std::string>>();
+            work_dir = (fs::path(work_dir) /
+                    fs::path("worker" + std::to_string(_worker))).string();
+        }
         _archive_q = _config_root["ARCHIVE_QUEUE"].as<std::string>();
         _telemetry_q = _config_root["TELEMETRY_QUEUE"].as<std::string>();
-        _seconds_to_update = _config_root["SECONDS_TO_UPDATE"].as<int>();
-        _seconds_to_expire = _config_root["SECONDS_TO_EXPIRE"].as<int>();
 
         // ReadoutPattern
         pattern = _config_root["PATTERN"];
 
+        // number of images each pipeline stage holds
+        if (_config_root["IMAGES_IN_FLIGHT"]) {
+            images_in_flight = _config_root["IMAGES_IN_FLIGHT"].as<int>();
+        }
+
+        // threads shared by all locations to declutter a ccd in parallel
+        if (_config_root["DECLUTTER_THREADS"]) {
+            declutter_threads = _config_root["DECLUTTER_THREADS"].as<int>();
+        }
+
+        // decode and pixel buffers kept across images
+        if (_config_root["PIXEL_POOL_BYTES"]) {
+            pixel_pool_bytes = _config_root["PIXEL_POOL_BYTES"]
+                .as<uint64_t>();
+        }
+        if (_config_root["PIXEL_POOL_PAGES"]) {
+            pixel_pool_pages = _config_root["PIXEL_POOL_PAGES"]
+                .as<std::string>();
+        }
+
+        // budgets images are admitted within, no limit if not set
+        if (_config_root["ADMIT_MEMORY_BYTES"]) {
+            admit_memory_bytes = _config_root["ADMIT_MEMORY_BYTES"]
+                .as<uint64_t>();
+        }
+        if (_config_root["ADMIT_SPOOL_BYTES"]) {
+            admit_spool_bytes = _config_root["ADMIT_SPOOL_BYTES"]
+                .as<uint64_t>();
+        }
+        if (_config_root["ADMIT_CCD_BYTES"]) {
+            _ccd_bytes = _config_root["ADMIT_CCD_BYTES"].as<uint64_t>();
+        }
+
+        // live images are due a budget per sensor type after END_READOUT
+        if (_config_root["DEADLINE_MS"]) {
+            for (auto&& budget : _budgets) {
+                const YAML::Node ms = _config_root["DEADLINE_MS"][
+                    DAQ::Sensor::encode(budget.first)];
+                if (ms) {
+                    budget.second = std::chrono::milliseconds(ms.as<int>());
+                }
+            }
+        }
+
+        // catch-up transfers are paced to a share of the link
+        if (_config_root["LINK_BYTES_PER_SECOND"]) {
+            link_bytes_per_second = _config_root["LINK_BYTES_PER_SECOND"]
+                .as<uint64_t>();
+        }
+        if (_config_root["CATCHUP_SHARE"]) {
+            catchup_share = _config_root["CATCHUP_SHARE"].as<double>();
+        }
+
+        // catch-up images archived at the same time, oldest first, and
+        // the file that remembers which are still pending
+        if (_config_root["CATCHUP_CONCURRENCY"]) {
+            catchup_concurrency = _config_root["CATCHUP_CONCURRENCY"]
+                .as<int>();
+        }
+        catchup_checkpoint = (fs::path(work_dir) /
+                fs::path("catchup.checkpoint")).string();
+        if (_config_root["CATCHUP_CHECKPOINT"]) {
+            catchup_checkpoint = _config_root["CATCHUP_CHECKPOINT"]
+                .as<std::string>();
+        }
+
+        // DAQ catalog entries already scanned, and threads new entries
+        // are read on
+        scan_index = (fs::path(work_dir) / fs::path("scan.index")).string();
+        if (_config_root["SCAN_INDEX"]) {
+            scan_index = _config_root["SCAN_INDEX"].as<std::string>();
+        }
+        if (_config_root["SCAN_THREADS"]) {
+            _scan_threads = _config_root["SCAN_THREADS"].as<int>();
+        }
+
+        // number of images the DAQ stream listener remembers
+        if (_config_root["ARRIVAL_INDEX_SIZE"]) {
+            arrival_index_size = _config_root["ARRIVAL_INDEX_SIZE"].as<int>();
+        }
+
+        // mirror scoreboard to local redis
+        if (_config_root["SCOREBOARD_WRITE_BEHIND"]) {
+            scoreboard_write_behind = _config_root["SCOREBOARD_WRITE_BEHIND"]
+                    .as<bool>();
+        }
+
+        // seconds an incomplete image is kept in the scoreboard
+        if (_config_root["SCOREBOARD_TTL"]) {
+            scoreboard_ttl = _config_root["SCOREBOARD_TTL"].as<int>();
+        }
+
+        // start pixel fetch as soon as DAQ completes the image
+        if (_config_root["SPECULATIVE_FETCH"]) {
+            _speculative_fetch = _config_root["SPECULATIVE_FETCH"].as<bool>();
+        }
+
+        // stage latencies in Prometheus text, rewritten every
+        // METRICS_INTERVAL seconds and served on METRICS_PORT
+        if (_config_root["METRICS_FILE"]) {
+            metrics_file = _config_root["METRICS_FILE"].as<std::string>();
+        }
+        if (_config_root["METRICS_PORT"]) {
+            metrics_port = _config_root["METRICS_PORT"].as<int>();
+        }
+        if (_config_root["METRICS_INTERVAL"]) {
+            metrics_interval = _config_root["METRICS_INTERVAL"].as<int>();
+        }
+
+        // record pipeline spans from startup, TRACE messages turn tracing
+        // on and off at runtime
+        if (_config_root["TRACE"]) {
+            trace = _config_root["TRACE"].as<bool>();
+        }
+        _trace_file = (fs::path(work_dir) / fs::path("trace.json")).string();
+        if (_config_root["TRACE_FILE"]) {
+            _trace_file = _config_root["TRACE_FILE"].as<std::string>();
+        }
+
         // mode
         std::string mode_str = _config_root["MODE"].as<std::string>();
         _mode = Info::encode(mode_str);
@@ -100,11 +302,30 @@ miniforwarder::miniforwarder(const std::string& config,
         LOG_CRT << "YAML bad conversion for int";
         exit(EXIT_FAILURE);
     }
+    catch (YAML::TypedBadConversion<bool>& e) {
+        LOG_CRT << "YAML bad conversion for bool";
+        exit(EXIT_FAILURE);
+    }
     catch (YAML::TypedBadConversion<std::vector<std::string>>& e) {
         LOG_CRT << "YAML bad conversion for vector<string>";
         exit(EXIT_FAILURE);
     }
 
+    // workers share the local redis, so their scoreboards stay in memory,
+    // and export metrics next to the supervisor's
+    if (_worker >= 0) {
+        scoreboard_write_behind = false;
+        const std::string suffix = "_worker" + std::to_string(_worker);
+        if (!metrics_file.empty()) {
+            const fs::path path(metrics_file);
+            metrics_file = (path.parent_path() / fs::path(path.stem().string()
+                        + suffix + path.extension().string())).string();
+        }
+        if (metrics_port > 0) {
+            metrics_port += _worker + 1;
+        }
+    }
+
     const std::string user = _credentials->get_user("service_user");
     const std::string passwd = _credentials->get_user("service_passwd");
     _amqp_url = "amqp://" + user + ":" + passwd + "@" + ip_host;
@@ -120,82 +341,202 @@ miniforwarder::miniforwarder(const std::string& config,
     }
 
     // const std::string redis_pwd = _credentials -> get_redis_passwd();
-    const std::string redis_pwd = "meh";
+    const std::string redis_pwd = "";
     _redis_params.host = redis_host_local;
     _redis_params.port = redis_port_local;
     _redis_params.db = redis_db_local;
     _redis_params.passwd = redis_pwd;
-
-    _actions = {
-        { "AT_FWDR_HEALTH_CHECK", std::bind(&miniforwarder::health_check,
-                this, std::placeholders::_1) },
-        { "AT_FWDR_XFER_PARAMS", std::bind(&miniforwarder::xfer_params,
-                this, std::placeholders::_1) },
-        { "AT_FWDR_HEADER_READY", std::bind(&miniforwarder::header_ready,
-                this, std::placeholders::_1) },
-        { "AT_FWDR_END_READOUT", std::bind(&miniforwarder::end_readout,
-                this, std::placeholders::_1) },
-
-        { "CC_FWDR_HEALTH_CHECK", std::bind(&miniforwarder::health_check,
-                this, std::placeholders::_1) },
-        { "CC_FWDR_XFER_PARAMS", std::bind(&miniforwarder::xfer_params,
-                this, std::placeholders::_1) },
-        { "CC_FWDR_HEADER_READY", std::bind(&miniforwarder::header_ready,
-                this, std::placeholders::_1) },
-        { "CC_FWDR_END_READOUT", std::bind(&miniforwarder::end_readout,
-                this, std::placeholders::_1) },
-
-        { "CATCHUP_FWDR_HEALTH_CHECK", std::bind(&miniforwarder::health_check,
-                this, std::placeholders::_1) },
-        { "CATCHUP_FWDR_XFER_PARAMS", std::bind(&miniforwarder::xfer_params,
-                this, std::placeholders::_1) },
-        { "CATCHUP_FWDR_HEADER_READY", std::bind(&miniforwarder::header_ready,
-                this, std::placeholders::_1) },
-        { "CATCHUP_FWDR_END_READOUT", std::bind(&miniforwarder::end_readout,
-                this, std::placeholders::_1) },
-
-        { "FILE_TRANSFER_COMPLETED_ACK", std::bind(&miniforwarder::process_ack,
-                this, std::placeholders::_1) },
-        { "ASSOCIATED", std::bind(&miniforwarder::associated,
-                this, std::placeholders::_1) },
-        { "SCAN", std::bind(&miniforwarder::scan,
-                this, std::placeholders::_1) },
-    };
+    _redis_params.connect_timeout = _node->remote().connect_timeout;
+
+    ForwarderNode::handlers handlers;
+    handlers.health_check = std::bind(&miniforwarder::health_check, this,
+            std::placeholders::_1);
+    handlers.xfer_params = std::bind(&miniforwarder::xfer_params, this,
+            std::placeholders::_1);
+    handlers.header_ready = std::bind(&miniforwarder::header_ready, this,
+            std::placeholders::_1);
+    handlers.end_readout = std::bind(&miniforwarder::end_readout, this,
+            std::placeholders::_1);
+    handlers.process_ack = std::bind(&miniforwarder::process_ack, this,
+            std::placeholders::_1);
+    handlers.associated = std::bind(&miniforwarder::associated, this,
+            std::placeholders::_1);
+    handlers.scan = std::bind(&miniforwarder::scan, this,
+            std::placeholders::_1);
+    handlers.trace = std::bind(&miniforwarder::trace, this,
+            std::placeholders::_1);
+    _actions = ForwarderNode::actions(handlers);
 
     try {
-        _pub = std::unique_ptr<SimplePublisher>(new SimplePublisher(_amqp_url));
+        if (!_pub) {
+            _pub = std::make_shared<SimplePublisher>(_amqp_url);
+        }
     }
     catch (L1::PublisherError& e) {
         exit(EXIT_FAILURE);
     }
 
-    _db = std::unique_ptr<Scoreboard>(new Scoreboard(redis_host_local,
-                redis_port_local, redis_db_local, redis_pwd));
+    if (scoreboard_write_behind) {
+        _db = std::unique_ptr<Scoreboard>(new Scoreboard(_redis_params,
+                    scoreboard_ttl));
+    }
+    else {
+        _db = std::unique_ptr<Scoreboard>(new Scoreboard(scoreboard_ttl));
+    }
     _sender = std::unique_ptr<FileSender>(new FileSender(xfer_option));
+    const uint64_t catchup_rate = static_cast<uint64_t>(
+            link_bytes_per_second * catchup_share);
+    _catchup_bucket = std::unique_ptr<TokenBucket>(new TokenBucket(
+                catchup_rate, catchup_rate));
     _pattern = std::unique_ptr<ReadoutPattern>(new ReadoutPattern(pattern));
+    _governor = std::unique_ptr<ResourceGovernor>(new ResourceGovernor(
+                admit_memory_bytes, admit_spool_bytes));
+    _scan_index = std::unique_ptr<ScanIndex>(new ScanIndex(scan_index));
 
-    _forwarder_list = "forwarder_list";
-    _association_key = "f99_association";
+    // resolve sensor types of the partition and compile their header
+    // formatters once instead of per ccd
+    for (auto&& location : _daq_locations) {
+        try {
+            DAQ::Sensor::Type sensor = ReadoutPattern::sensor(location);
+            if (!_formatters.count(sensor)) {
+                _formatters[sensor] = std::make_shared<YAMLFormatter>(
+                        _pattern->data_segment_name(sensor));
+            }
+        }
+        catch (L1::InvalidLocation& e) {
+            LOG_CRT << "Partition location " << location << " is invalid";
+        }
+        catch (L1::InvalidReadoutPattern& e) {
+            LOG_CRT << "Readout pattern of " << location << " is invalid";
+        }
+    }
 
-    auto bound_register_fwd = std::bind(&miniforwarder::register_fwd, this);
-    _hb_params.seconds_to_expire = _seconds_to_expire;
-    _hb_params.seconds_to_update = _seconds_to_update;
-    _hb_params.key = _association_key;
-    _hb_params.redis_params.host = redis_host_remote;
-    _hb_params.redis_params.port = redis_port_remote;
-    _hb_params.redis_params.db = redis_db_remote;
-    _hb_params.action = bound_register_fwd;
+    _remote = std::unique_ptr<AsyncRedis>(new AsyncRedis(_node->remote()));
+
+    // heartbeats, liveness checks and maintenance share one thread and the
+    // remote redis connection
+    _scheduler = std::unique_ptr<Scheduler>(new Scheduler());
+    if (_worker < 0) {
+        _node->register_fwd(*_remote);
+        _beacon = std::unique_ptr<Beacon>(new Beacon(*_scheduler, *_remote,
+                    _node->heartbeat(*_remote)));
+        _watcher = std::unique_ptr<Watcher>(new Watcher(*_scheduler,
+                    *_remote));
+    }
+    _scheduler->every(std::chrono::seconds(MF_SCOREBOARD_SWEEP),
+            [this, scoreboard_ttl]() {
+        _db->expire();
+        ImageCost::instance().expire(std::chrono::seconds(scoreboard_ttl));
+        _governor->expire(std::chrono::seconds(scoreboard_ttl));
+        expire_speculative(std::chrono::seconds(scoreboard_ttl));
+    });
+    _scheduler->every(std::chrono::seconds(MF_REDIS_REPORT), []() {
+        RedisPool::instance().report();
+    });
+
+    if (!metrics_file.empty()) {
+        _scheduler->every(std::chrono::seconds(metrics_interval),
+                [metrics_file]() {
+            try {
+                Metrics::instance().dump(metrics_file);
+            }
+            catch (L1::MetricsError& e) { }
+        });
+    }
+    if (metrics_port > 0) {
+        try {
+            _metrics = std::unique_ptr<MetricsServer>(
+                    new MetricsServer(metrics_port));
+        }
+        catch (L1::MetricsError& e) { }
+    }
 
-    register_fwd();
+    _notification = std::unique_ptr<Notification>(
+            new Notification(_partition.c_str(), _barrier_timeout,
+                arrival_index_size));
 
-    _beacon = std::unique_ptr<Beacon>(new Beacon(_hb_params));
-    _watcher = std::unique_ptr<Watcher>(new Watcher());
+    if (trace) {
+        Tracer::instance().start();
+    }
 
-    _notification = std::unique_ptr<Notification>(
-            new Notification(_partition.c_str(), _barrier_timeout));
+    _declutter_pool = std::unique_ptr<WorkerPool>(new WorkerPool("declutter",
+                declutter_threads));
+    if (pixel_pool_bytes) {
+        _pixel_pool = std::unique_ptr<PixelPool>(new PixelPool(
+                    pixel_pool_bytes, PixelPool::pages(pixel_pool_pages)));
+    }
+    _pipeline = std::unique_ptr<Pipeline>(new Pipeline(images_in_flight));
+
+    if (catchup_concurrency > 0) {
+        try {
+            _catchup = std::unique_ptr<CatchupEngine>(new CatchupEngine(
+                        catchup_concurrency, catchup_checkpoint));
+        }
+        catch (L1::CannotOpenFile& e) {
+            exit(EXIT_FAILURE);
+        }
+
+        // pick up images of the previous run whose XFER_PARAMS the
+        // scoreboard restored, the others wait for their messages
+        for (auto&& image_id : _catchup->pending()) {
+            readout_info readout = _db->get(image_id);
+            if (readout.xfer.locations.empty()) {
+                continue;
+            }
+            LOG_INF << "Resuming catch-up image " << image_id;
+            if (!readout.fetched) {
+                _catchup->run(image_id, std::bind(&miniforwarder::fetch, this,
+                            image_id));
+            }
+            else {
+                assemble(image_id);
+            }
+        }
+    }
+
+    if (_mode == Info::MODE::LIVE) {
+        if (_speculative_fetch) {
+            _notification->listen(std::bind(&miniforwarder::on_image, this,
+                        std::placeholders::_1, std::placeholders::_2));
+        }
+        else {
+            _notification->listen(nullptr);
+        }
+    }
 }
 
 miniforwarder::~miniforwarder() {
+    // stop heartbeats, replies of checks already sent are ignored
+    _beacon.reset();
+    if (_watcher) {
+        _watcher->clear();
+    }
+    _metrics.reset();
+
+    // drain in flight images and stop the stream listener before the
+    // members they use go away. Pipeline jobs may hand catch-up images to
+    // the engine, whose queued jobs resume from the checkpoint.
+    _pipeline.reset();
+    _catchup.reset();
+    _notification.reset();
+
+    if (Tracer::instance().enabled()) {
+        Tracer::instance().stop();
+        try {
+            Tracer::instance().dump(_trace_file);
+        }
+        catch (L1::CannotOpenFile& e) { }
+    }
+
+    // replies still in flight publish through _pub
+    _remote.reset();
+    _watcher.reset();
+
+    // maintenance tasks use the members below
+    _scheduler.reset();
+
+    std::lock_guard<std::mutex> lk(_speculative_mutex);
+    _speculative.clear();
 }
 
 void miniforwarder::on_message(const std::string& message) {
@@ -212,7 +553,7 @@ void miniforwarder::on_message(const std::string& message) {
 
 void miniforwarder::run() {
     try {
-        Consumer consumer(_amqp_url, _consume_q);
+        Consumer consumer(_amqp_url, _node->consume_q());
         auto on_msg = bind(&miniforwarder::on_message, this,
                 std::placeholders::_1);
         consumer.run(on_msg);
@@ -224,6 +565,14 @@ void miniforwarder::run() {
     }
 }
 
+void miniforwarder::serve(MessagePipe& pipe) {
+    std::string queue, body;
+    while (pipe.get(queue, body)) {
+        on_message(body);
+    }
+    LOG_INF << "Supervisor closed pipe of worker " << _worker;
+}
+
 void miniforwarder::health_check(const YAML::Node& n) {
     publish_ack(n);
 }
@@ -255,8 +604,14 @@ void miniforwarder::xfer_params(const YAML::Node& n) {
         xfer.session_id = n["SESSION_ID"].as<std::string>();
         xfer.job_num = n["JOB_NUM"].as<std::string>();
         xfer.locations = locations;
+        xfer.mode = mode_of(n["MSG_TYPE"].as<std::string>());
 
         _db->add_xfer(image_id, xfer);
+
+        // DAQ may have completed the image before XFER_PARAMS arrived
+        if (_speculative_fetch && _notification->ready(image_id, _folder)) {
+            speculate(image_id);
+        }
     }
     catch (std::exception& e) {
         LOG_CRT << e.what();
@@ -278,11 +633,22 @@ void miniforwarder::header_ready(const YAML::Node& n) {
         return;
     }
 
+    if (!ours(image_id)) {
+        return;
+    }
+
     try {
+        CpuTimer cpu(image_id);
         fs::path header = _header_path / fs::path(image_id);
         _hdr.fetch(filename, header);
         _db->add_header(image_id, header.string());
 
+        boost::system::error_code ec;
+        uintmax_t size = fs::file_size(header, ec);
+        if (!ec) {
+            ImageCost::instance().add_written(image_id, size);
+        }
+
         assemble(image_id);
     }
     catch (L1::CannotFetchHeader& e) {
@@ -310,25 +676,132 @@ void miniforwarder::end_readout(const YAML::Node& n) {
         return;
     }
 
+    if (!ours(image_id)) {
+        return;
+    }
+
+    // stages run live images by deadline, catch-up images have none
+    const xfer_info xfer = _db->get_xfer(image_id);
+    if (by_engine(xfer)) {
+        _catchup->run(image_id, std::bind(&miniforwarder::fetch, this,
+                    image_id));
+        return;
+    }
+
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (xfer.mode != Info::MODE::CATCHUP) {
+        deadline = due(xfer.locations);
+        _db->set_deadline(image_id, deadline);
+    }
+    _pipeline->fetch(std::bind(&miniforwarder::fetch, this, image_id),
+            deadline);
+}
+
+void miniforwarder::fetch(const std::string& image_id) {
+    Metrics& metrics = Metrics::instance();
+    StageTimer timer(metrics.latency("fetch"));
+    TraceSpan span("fetch", image_id);
+    CpuTimer cpu(image_id);
+    const xfer_info xfer = _db->get_xfer(image_id);
     try {
-        _notification->block(_mode, image_id, _folder);
+        StageTimer block_timer(metrics.latency("block"));
+        TraceSpan block_span("block", image_id);
+        _notification->block(xfer.mode, image_id, _folder);
     } catch (L1::CannotFetchPixel& e) {
         LOG_CRT << "Block failed because exception occurred.";
+        metrics.counter("errors", "block").add();
+        if (by_engine(xfer)) {
+            _catchup->done(image_id);
+        }
         return;
     }
 
-    std::vector<std::pair<std::string, std::future<void>>> tasks;
-    std::vector<std::string> locations = _db->locations(image_id);
+    // the stream listener completes the image before it calls on_image,
+    // claim the image so that speculate does not start a second fetch. An
+    // image claimed without a running fetch is being or was fetched, the
+    // DAQ keeps it complete so a duplicate END_READOUT gets this far. A
+    // failed fetch drops its claim so that a retry fetches again.
+    std::shared_future<void> speculative;
+    {
+        std::lock_guard<std::mutex> lk(_speculative_mutex);
+        auto it = _speculative.find(image_id);
+        if (it != _speculative.end() && !it->second.pixels.valid()) {
+            LOG_WRN << "Ignoring duplicate END_READOUT for " << image_id;
+            metrics.counter("duplicates", "fetch").add();
+            if (by_engine(xfer)) {
+                _catchup->done(image_id);
+            }
+            return;
+        }
+        speculative_fetch& claim = _speculative[image_id];
+        speculative = claim.pixels;
+        claim.pixels = std::shared_future<void>();
+        claim.claimed = std::chrono::steady_clock::now();
+    }
+
+    // failures of single locations are reported by fetch_pixels, anything
+    // else ends the image
+    try {
+        if (speculative.valid()) {
+            LOG_INF << "Joining speculative fetch for " << image_id;
+            TraceSpan wait_span("wait_speculative", image_id);
+            speculative.get();
+        }
+        else {
+            fetch_pixels(image_id);
+        }
+    }
+    catch (std::exception& e) {
+        LOG_CRT << "Fetch of " << image_id << " failed because " << e.what();
+        metrics.counter("errors", "fetch").add();
+        {
+            std::lock_guard<std::mutex> lk(_speculative_mutex);
+            _speculative.erase(image_id);
+        }
+
+        int error_code = 5611;
+        publish_image_retrieval_for_archiving(error_code, image_id, "", "", "",
+                e.what());
+        if (by_engine(xfer)) {
+            _catchup->done(image_id);
+        }
+        return;
+    }
+
+    assemble(image_id);
+}
+
+void miniforwarder::fetch_pixels(const std::string& image_id) {
+    std::vector<std::pair<std::string,
+        std::future<std::vector<std::string>>>> tasks;
+    const xfer_info xfer = _db->get_xfer(image_id);
+    const std::vector<std::string>& locations = xfer.locations;
+
+    // pixels are held twice while decoded and decluttered, fitsfiles take
+    // about the size of the pixels. Sensor type is the number of ccds.
+    uint64_t ccds = 0;
+    for (auto&& location : locations) {
+        ccds += ReadoutPattern::sensor(location);
+    }
+    _governor->admit(image_id, 2 * ccds * _ccd_bytes, ccds * _ccd_bytes,
+            xfer.mode);
+    // an image whose fetch throws gives its budget back
+    scope_exit admitted([this, &image_id]() {
+        _governor->release(image_id);
+    });
+
     for (auto&& location : locations) {
         // get sensor type
-        DAQ::Sensor::Type sensor = _pattern->sensor(location);
-        std::vector<int> data_segment = _pattern->data_segment(sensor);
-        int xor_pattern = _pattern->get_xor(sensor);
+        DAQ::Sensor::Type sensor = ReadoutPattern::sensor(location);
 
         std::unique_ptr<DAQFetcher> daq = std::unique_ptr<DAQFetcher>(
-                new DAQFetcher(_partition, _folder, data_segment,
-                    _redis_params, xor_pattern));
-        std::future<void> job = std::async(std::launch::async,
+                new DAQFetcher(_partition, _folder,
+                    _pattern->data_segment(sensor),
+                    _pattern->get_xor(sensor),
+                    _declutter_pool.get(),
+                    _pixel_pool.get()));
+        std::future<std::vector<std::string>> job = std::async(
+                std::launch::async,
                 &DAQFetcher::fetch,
                 std::move(daq),
                 _fits_path,
@@ -339,10 +812,14 @@ void miniforwarder::end_readout(const YAML::Node& n) {
 
     for (auto&& task : tasks) {
         try {
-            task.second.get();
+            TraceSpan span("wait_fetch", image_id, task.first);
+            for (auto&& ccd : task.second.get()) {
+                _db->add_ccd(image_id, ccd);
+            }
         }
         catch (L1::RedisError& e) {
             LOG_CRT << e.what();
+            Metrics::instance().counter("errors", "fetch").add();
 
             int error_code = 5611;
             L1::Board board = L1::Board::decode_location(task.first);
@@ -351,6 +828,7 @@ void miniforwarder::end_readout(const YAML::Node& n) {
         }
         catch (L1::CannotFetchPixel& e) {
             LOG_CRT << e.what();
+            Metrics::instance().counter("errors", "fetch").add();
 
             int error_code = 5611;
             L1::Board board = L1::Board::decode_location(task.first);
@@ -359,7 +837,60 @@ void miniforwarder::end_readout(const YAML::Node& n) {
         }
     }
 
-    assemble(image_id);
+    // ccds of every location are in, HEADER_READY may assemble from now on
+    _db->set_fetched(image_id);
+
+    admitted.dismiss();
+    _governor->release_memory(image_id);
+    _governor->set_spool(image_id,
+            ImageCost::instance().get(image_id).written_bytes);
+}
+
+void miniforwarder::on_image(const std::string& image_id,
+                             const std::string& folder) {
+    if (folder != _folder) {
+        return;
+    }
+
+    // without XFER_PARAMS there are no locations to fetch yet, xfer_params
+    // starts the fetch when it arrives
+    if (_db->locations(image_id).empty()) {
+        LOG_DBG << "No XFER_PARAMS for " << image_id << " yet";
+        return;
+    }
+    speculate(image_id);
+}
+
+void miniforwarder::speculate(const std::string& image_id) {
+    std::lock_guard<std::mutex> lk(_speculative_mutex);
+    // already started, or claimed by fetch
+    if (_speculative.count(image_id)) {
+        return;
+    }
+
+    LOG_INF << "Starting speculative fetch for " << image_id;
+    speculative_fetch& started = _speculative[image_id];
+    started.pixels = std::async(std::launch::async,
+            &miniforwarder::fetch_pixels, this, image_id).share();
+    started.claimed = std::chrono::steady_clock::now();
+}
+
+void miniforwarder::expire_speculative(const std::chrono::seconds age) {
+    auto oldest = std::chrono::steady_clock::now() - age;
+    std::lock_guard<std::mutex> lk(_speculative_mutex);
+    for (auto it = _speculative.begin(); it != _speculative.end(); ) {
+        // dropping the last future of a running fetch would wait for it
+        const std::shared_future<void>& pixels = it->second.pixels;
+        bool running = pixels.valid() &&
+            pixels.wait_for(std::chrono::seconds(0)) !=
+                std::future_status::ready;
+        if (it->second.claimed < oldest && !running) {
+            it = _speculative.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
 }
 
 void miniforwarder::process_ack(const YAML::Node& n) {
@@ -373,16 +904,22 @@ void miniforwarder::process_ack(const YAML::Node& n) {
 }
 
 void miniforwarder::associated(const YAML::Node& n) {
+    // the supervisor acks and watches the association for its workers
+    if (_worker >= 0) {
+        _notification->start();
+        return;
+    }
+
     try {
         const std::string key = n["ASSOCIATION_KEY"].as<std::string>();
         const std::string reply_q = n["REPLY_QUEUE"].as<std::string>();
         const std::string ack_id = n["ACK_ID"].as<std::string>();
-        const std::string msg = _builder.build_associated_ack(_association_key,
-                ack_id);
+        const std::string msg = _builder.build_associated_ack(
+                _node->association_key(), ack_id);
 
         _pub->publish_message(reply_q, msg);
 
-        heartbeat_params params = _hb_params;
+        heartbeat_params params = _node->heartbeat(*_remote);
         params.key = key;
         _watcher->start(params);
 
@@ -422,45 +959,75 @@ void miniforwarder::scan(const YAML::Node& n) {
             return;
         }
 
-        Scanner scanner(_partition, minutes);
+        WorkerPool pool("scan", _scan_threads);
+        Scanner scanner(_partition, minutes, _scan_index.get(), &pool);
         folder.traverse(scanner);
         std::vector<std::string> images = scanner.get_images();
-
-        const std::string host = _hb_params.redis_params.host;
-        const int port = _hb_params.redis_params.port;
-        const int db = _hb_params.redis_params.db;
+        // a worker leaves images to their CATCHUP_ messages, it would keep
+        // pending the ones without locations of its own
+        if (_catchup && _worker < 0) {
+            _catchup->add(images);
+        }
 
         const std::string daq_key = n["KEY"].as<std::string>();
 
-        RedisConnection con(host, port, db);
-        con.lpush(daq_key, images);
-        con.exec();
-
         const std::string reply_q = n["REPLY_QUEUE"].as<std::string>();
-        const std::string msg = _builder.build_scan_ack();
-        _pub->publish_message(reply_q, msg);
 
-        LOG_INF << "Published ack for SCAN with values: " << msg;
+        // ack once archiver can see the images
+        std::vector<std::string> args{ "lpush", daq_key };
+        args.insert(args.end(), images.begin(), images.end());
+        _remote->send(std::move(args), [this, reply_q](
+                    const std::string& error, const Reply& reply) {
+            if (!error.empty()) {
+                LOG_CRT << "Cannot push scanned images because " << error;
+                return;
+            }
+            const std::string msg = _builder.build_scan_ack();
+            _pub->publish_message(reply_q, msg);
+            LOG_INF << "Published ack for SCAN with values: " << msg;
+        });
+
         LOG_INF << "Finished scanning images from DAQ catalog";
     }
     catch (L1::ScannerError& e) { }
 }
 
-void miniforwarder::publish_ack(const YAML::Node& n) {
+void miniforwarder::trace(const YAML::Node& n) {
+    bool enable;
     try {
-        const std::string msg_type = n["MSG_TYPE"].as<std::string>();
-        const std::string image_id = n["IMAGE_ID"].as<std::string>();
-        const std::string ack_id = n["ACK_ID"].as<std::string>();
-        const std::string reply_q = n["REPLY_QUEUE"].as<std::string>();
-        const std::string msg = _builder.build_ack(msg_type, image_id, _name,
-                ack_id, "True");
-        _pub->publish_message(reply_q, msg);
-        LOG_DBG << "Published ack for " << msg_type << " with values: " << msg;
+        enable = n["ENABLE"].as<bool>();
     }
-    catch (L1::PublisherError& e) { }
-    catch (std::exception& e) {
-        LOG_CRT << e.what();
+    catch (YAML::InvalidNode& e) {
+        LOG_CRT << "RabbitMQ message has missing param - ENABLE";
+        return;
+    }
+    catch (YAML::TypedBadConversion<bool>& e) {
+        LOG_CRT << "RabbitMQ message has invalid param "
+                << "- ENABLE, expecting as bool";
+        return;
+    }
+
+    Tracer& tracer = Tracer::instance();
+    if (enable) {
+        tracer.start();
+        return;
+    }
+
+    // stopping writes what was recorded so far
+    tracer.stop();
+    try {
+        tracer.dump(_trace_file);
+    }
+    catch (L1::CannotOpenFile& e) { }
+}
+
+void miniforwarder::publish_ack(const YAML::Node& n) {
+    // the supervisor acks for its workers
+    if (_worker >= 0) {
+        return;
     }
+
+    _node->publish_ack(*_pub, n);
 }
 
 void miniforwarder::publish_xfer_complete(const std::string& obsid,
@@ -471,7 +1038,8 @@ void miniforwarder::publish_xfer_complete(const std::string& obsid,
                                           const std::string& job_num) {
     try {
         const std::string msg = _builder.build_xfer_complete(to, obsid, raft,
-                ccd, session_id, job_num, _consume_q);
+                ccd, session_id, job_num, _node->consume_q());
+        StageTimer timer(Metrics::instance().latency("publish"));
         _pub->publish_message(_archive_q, msg);
     }
     catch (L1::PublisherError& e) { }
@@ -494,43 +1062,157 @@ void miniforwarder::publish_image_retrieval_for_archiving(
             ccd,
             filename,
             desc);
+    publish_telemetry(msg);
+}
+
+void miniforwarder::publish_image_retrieval_for_archiving(
+        const int& error_code,
+        const std::string& obsid,
+        const std::string& raft,
+        const std::string& ccd,
+        const std::string& filename,
+        const std::string& desc,
+        const image_cost& cost) {
+    const std::string msg = _builder.build_image_retrieval_for_archiving(
+            error_code,
+            obsid,
+            raft,
+            ccd,
+            filename,
+            desc,
+            cost);
+    publish_telemetry(msg);
+}
+
+void miniforwarder::publish_telemetry(const std::string& msg) {
     try {
+        StageTimer timer(Metrics::instance().latency("publish"));
         _pub->publish_message(_telemetry_q, msg);
     }
     catch (L1::PublisherError& e) {}
 }
 
 void miniforwarder::assemble(const std::string& image_id) {
-    if (_db->ready(image_id)) {
+    // header_ready and end_readout race to assemble the same image from
+    // different threads. Only the first one that sees it ready hands it over.
+    {
+        std::lock_guard<std::mutex> lk(_assemble_mutex);
+        if (_assembling.count(image_id) || !_db->ready(image_id)) {
+            return;
+        }
+        _assembling.insert(image_id);
+    }
 
-        xfer_info params = _db->get_xfer(image_id);
-        std::string session_id = params.session_id;
-        std::string job_num = params.job_num;
-        std::string to = params.target;
+    auto job = std::bind(&miniforwarder::format, this, image_id);
+    readout_info readout = _db->get(image_id);
+    if (by_engine(readout.xfer)) {
+        _catchup->run(image_id, job);
+        return;
+    }
+    _pipeline->format(job, readout.deadline);
+}
 
-        std::string header = _db->header(image_id);
-        std::vector<std::string> ccds = _db->ccds(image_id);
+void miniforwarder::format(const std::string& image_id) {
+    // a stage drops the job of a throwing image, which must not stay
+    // assembling until the process exits
+    readout_info readout = _db->get(image_id);
+    scope_exit finished(std::bind(&miniforwarder::finish, this, image_id,
+                by_engine(readout.xfer)));
+    StageTimer timer(Metrics::instance().latency("format"));
+    TraceSpan span("format", image_id);
+    CpuTimer cpu(image_id);
+
+    // format file with header
+    format_with_header(readout.ccds, readout.header);
+
+    timer.stop();
+    span.stop();
+    cpu.stop();
+    finished.dismiss();
+    // catch-up images stay on their engine thread
+    auto job = std::bind(&miniforwarder::transfer, this, image_id);
+    if (by_engine(readout.xfer)) {
+        job();
+        return;
+    }
+    _pipeline->transfer(job, readout.deadline);
+}
 
-        // format file with header
-        format_with_header(ccds, header);
+void miniforwarder::transfer(const std::string& image_id) {
+    readout_info readout = _db->get(image_id);
+    // declared before the CPU timer so that its time is added before the
+    // cost of the image is dropped
+    scope_exit finished(std::bind(&miniforwarder::finish, this, image_id,
+                by_engine(readout.xfer)));
+    Metrics& metrics = Metrics::instance();
+    StageTimer timer(metrics.latency("transfer"));
+    TraceSpan span("transfer", image_id);
+    CpuTimer cpu(image_id);
+    ImageCost& cost = ImageCost::instance();
+    std::string session_id = readout.xfer.session_id;
+    std::string job_num = readout.xfer.job_num;
+    std::string to = readout.xfer.target;
+
+    std::string header = readout.header;
+    std::vector<std::string>& ccds = readout.ccds;
+
+    uint64_t bytes = 0;
+    for (auto&& ccd : ccds) {
+        boost::system::error_code ec;
+        uintmax_t size = fs::file_size(ccd, ec);
+        if (!ec) {
+            bytes += size;
+        }
+    }
 
-        // send file
-        try {
+    // send file
+    try {
+        // pacing sleeps, which only engine threads can afford. On the
+        // transfer stage it would hold up the live images queued behind.
+        if (by_engine(readout.xfer)) {
+            StageTimer pace_timer(metrics.latency("pace"));
+            TraceSpan pace_span("pace", image_id);
+            _catchup_bucket->take(bytes);
+        }
+        {
+            StageTimer send_timer(metrics.latency("send"));
+            TraceSpan send_span("send", image_id);
             _sender->send(ccds, fs::path(to));
-            publish_completed_msgs(image_id, to, ccds, session_id, job_num);
-            cleanup(image_id, ccds, header);
-            LOG_INF << "********* READOUT COMPLETE for " << image_id;
         }
-        catch (L1::CannotCopyFile& e) {
-            LOG_CRT << e.what();
-
-            int error_code = 5612;
-            publish_image_retrieval_for_archiving(error_code, image_id, "", "",
-                    "", e.what());
+        cost.add_sent(image_id, bytes);
+        if (std::chrono::steady_clock::now() > readout.deadline) {
+            metrics.counter("deadline_missed", "transfer").add();
         }
+
+        // cost is final once the image is sent, publishing is not counted
+        cpu.stop();
+        publish_completed_msgs(image_id, to, ccds, session_id, job_num);
+        cleanup(image_id, ccds, header);
+        metrics.counter("images", "transfer").add();
+        LOG_INF << "********* READOUT COMPLETE for " << image_id;
+    }
+    catch (L1::CannotCopyFile& e) {
+        LOG_CRT << e.what();
+        metrics.counter("errors", "send").add();
+
+        int error_code = 5612;
+        publish_image_retrieval_for_archiving(error_code, image_id, "", "",
+                "", e.what());
     }
 }
 
+void miniforwarder::finish(const std::string& image_id, const bool engine) {
+    ImageCost::instance().remove(image_id);
+    _governor->release(image_id);
+    // a failed catch-up image is reported, not retried from the checkpoint
+    if (engine) {
+        _catchup->done(image_id);
+    }
+
+    std::lock_guard<std::mutex> lk(_assemble_mutex);
+    _assembling.erase(image_id);
+}
+
 void miniforwarder::format_with_header(std::vector<std::string>& ccds,
                                        const std::string header) {
     std::vector<std::pair<std::string, std::future<void>>> tasks;
@@ -538,21 +1220,35 @@ void miniforwarder::format_with_header(std::vector<std::string>& ccds,
         L1::Board board = L1::Board::decode_filename(ccd);
         DAQ::Sensor::Type sensor = ReadoutPattern::sensor(board.bay_board);
 
-        std::vector<std::string> mapping = _pattern->data_segment_name(sensor);
-        auto fmt = std::unique_ptr<YAMLFormatter>(
-                new YAMLFormatter(mapping));
+        std::shared_ptr<YAMLFormatter> fmt;
+        auto found = _formatters.find(sensor);
+        if (found != _formatters.end()) {
+            fmt = found->second;
+        }
+        else {
+            fmt = std::make_shared<YAMLFormatter>(
+                    _pattern->data_segment_name(sensor));
+        }
+
+        Histogram& latency = Metrics::instance().latency("write_header",
+                DAQ::Sensor::encode(sensor), board.bay_board);
         std::future<void> job = std::async(
                 std::launch::async,
-                &YAMLFormatter::write_header,
-                std::move(fmt),
-                fs::path(ccd),
-                fs::path(header)
+                [fmt, ccd, header, board, &latency]() {
+                    StageTimer timer(latency);
+                    TraceSpan span("write_header", board.obsid,
+                            board.bay_board);
+                    CpuTimer cpu(board.obsid);
+                    fmt->write_header(fs::path(ccd), fs::path(header));
+                }
             );
         tasks.push_back(make_pair(ccd, std::move(job)));
     }
 
     for (auto&& task : tasks) {
         try {
+            L1::Board board = L1::Board::decode_filename(task.first);
+            TraceSpan span("wait_header", board.obsid, board.bay_board);
             task.second.get();
         }
         catch (L1::RedisError& e) {
@@ -565,6 +1261,7 @@ void miniforwarder::format_with_header(std::vector<std::string>& ccds,
         }
         catch (L1::CannotFormatFitsfile& e) {
             LOG_CRT << e.what();
+            Metrics::instance().counter("errors", "write_header").add();
 
             int error_code = 5611;
             L1::Board board = L1::Board::decode_filename(task.first);
@@ -579,7 +1276,10 @@ void miniforwarder::publish_completed_msgs(const std::string image_id,
                                            std::vector<std::string>& ccds,
                                            const std::string session_id,
                                            const std::string job_num){
-    for (auto&& ccd : ccds) {
+    TraceSpan span("publish", image_id);
+    const image_cost cost = ImageCost::instance().get(image_id);
+    for (size_t i = 0; i < ccds.size(); i++) {
+        const std::string& ccd = ccds[i];
         // to: ARC@xxx.xxx.xxx.xxx:/tmp/data
         // to_dir: /tmp/data
         // to_fullpath: /tmp/data/xxx.fits
@@ -594,8 +1294,15 @@ void miniforwarder::publish_completed_msgs(const std::string image_id,
 
         publish_xfer_complete(image_id, board.raft, board.ccd,
                 to_fullpath, session_id, job_num);
-        publish_image_retrieval_for_archiving(0, image_id, board.raft,
-                board.ccd, to_fullpath, msg.str());
+        // the last message of the image carries what the image cost
+        if (i == ccds.size() - 1) {
+            publish_image_retrieval_for_archiving(0, image_id, board.raft,
+                    board.ccd, to_fullpath, msg.str(), cost);
+        }
+        else {
+            publish_image_retrieval_for_archiving(0, image_id, board.raft,
+                    board.ccd, to_fullpath, msg.str());
+        }
     }
 }
 
@@ -628,47 +1335,37 @@ fs::path miniforwarder::create_dir(const fs::path& file_path) {
     return file_path;
 }
 
-std::string miniforwarder::get_name(){
-    char hostname[HOST_NAME_MAX];
-    gethostname(hostname, HOST_NAME_MAX);
-
-    std::unique_ptr<struct addrinfo, decltype(&freeaddrinfo)> infoptr(nullptr,
-            &freeaddrinfo);
-
-    addrinfo *temp;
-    int response = getaddrinfo(hostname, NULL, NULL, &temp);
-    infoptr.reset(temp);
-    if (response) {
-        LOG_CRT << "Cannot get hostname";
-        throw L1::L1Exception("Cannot get hostname");
+Info::MODE miniforwarder::mode_of(const std::string& msg_type) {
+    // a catch-up forwarder catches up every image, a live one the images of
+    // CATCHUP_ messages
+    if (_mode != Info::MODE::LIVE) {
+        return _mode;
     }
-
-    char host[256];
-
-    getnameinfo(infoptr->ai_addr, infoptr->ai_addrlen, host, sizeof(host),
-            NULL, 0, NI_NUMERICHOST);
-
-    _hostname = hostname;
-    _ip_addr = host;
-    return static_cast<std::string>(host) + ":" + hostname;
+    if (msg_type.compare(0, 8, "CATCHUP_") == 0) {
+        return Info::MODE::CATCHUP;
+    }
+    return Info::MODE::LIVE;
 }
 
-void miniforwarder::register_fwd() {
-    // set forwarder in archiver database
-    const std::string msg = _builder.build_fwd_info(_hostname, _ip_addr,
-            _consume_q);
-
-    std::string redis_host = _hb_params.redis_params.host;
-    int port = _hb_params.redis_params.port;
-    int db = _hb_params.redis_params.db;
+bool miniforwarder::by_engine(const xfer_info& xfer) {
+    return _catchup && xfer.mode == Info::MODE::CATCHUP;
+}
 
-    try {
-        RedisConnection con(redis_host, port, db);
-        con.lpush(_forwarder_list, { msg });
-        con.exec();
-        LOG_INF << "Set forwarder in redis list";
+std::chrono::steady_clock::time_point miniforwarder::due(
+        const std::vector<std::string>& locations) {
+    // an image is due by the shortest budget of its sensors
+    auto budget = std::chrono::milliseconds::max();
+    for (auto&& location : locations) {
+        try {
+            budget = std::min(budget,
+                    _budgets[ReadoutPattern::sensor(location)]);
+        }
+        catch (L1::InvalidLocation& e) { }
+    }
+    if (budget == std::chrono::milliseconds::max()) {
+        budget = _budgets[DAQ::Sensor::Type::SCIENCE];
     }
-    catch (L1::RedisError& e) { }
+    return std::chrono::steady_clock::now() + budget;
 }
 
 bool miniforwarder::check_valid_board(const std::vector<std::string>& locs) {
@@ -681,3 +1378,7 @@ bool miniforwarder::check_valid_board(const std::vector<std::string>& locs) {
     }
     return true;
 }
+
+bool miniforwarder::ours(const std::string& image_id) {
+    return _worker < 0 || !_db->get_xfer(image_id).locations.empty();
+}
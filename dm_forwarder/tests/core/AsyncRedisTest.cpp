@@ -0,0 +1,101 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <future>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Exceptions.h>
+#include <core/AsyncRedis.h>
+
+struct AsyncRedisFixture : IIPBase {
+
+    std::string _log_dir;
+    redis_connection_params _params;
+
+    AsyncRedisFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup AsyncRedisTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+
+        _params.host = _config_root["REDIS"]["LOCAL"]["HOST"].as<std::string>();
+        _params.port = _config_root["REDIS"]["LOCAL"]["PORT"].as<int>();
+        _params.db = _config_root["REDIS"]["LOCAL"]["DB"].as<int>();
+    }
+
+    ~AsyncRedisFixture() {
+        BOOST_TEST_MESSAGE("TearDown AsyncRedisTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(AsyncRedisTest, AsyncRedisFixture);
+
+BOOST_AUTO_TEST_CASE(unreachable) {
+    // nothing listens on the discard port
+    redis_connection_params params = _params;
+    params.host = "127.0.0.1";
+    params.port = 9;
+    params.connect_timeout = 200;
+
+    AsyncRedis con(params);
+    auto start = std::chrono::steady_clock::now();
+    std::future<Reply> reply = con.call({ "ping" });
+    BOOST_CHECK_THROW(reply.get(), L1::RedisError);
+
+    auto waited = std::chrono::steady_clock::now() - start;
+    BOOST_CHECK(waited < std::chrono::seconds(2));
+}
+
+BOOST_AUTO_TEST_CASE(call) {
+    AsyncRedis con(_params);
+    con.send({ "set", "AsyncRedisTest", "1" });
+    std::future<Reply> value = con.call({ "get", "AsyncRedisTest" });
+    std::future<Reply> deleted = con.call({ "del", "AsyncRedisTest" });
+
+    BOOST_CHECK_EQUAL(value.get().str, "1");
+    BOOST_CHECK_EQUAL(deleted.get().integer, 1);
+    BOOST_CHECK_THROW(con.call({ "nosuchcommand" }).get(), L1::RedisError);
+}
+
+BOOST_AUTO_TEST_CASE(order) {
+    std::vector<int> done;
+    {
+        AsyncRedis con(_params);
+        for (int i = 0; i < 100; i++) {
+            con.send({ "ping" }, [&done, i](const std::string& error,
+                                            const Reply& reply) {
+                done.push_back(i);
+            });
+        }
+        con.flush();
+    }
+
+    BOOST_CHECK_EQUAL(done.size(), 100);
+    for (int i = 0; i < done.size(); i++) {
+        BOOST_CHECK_EQUAL(done[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
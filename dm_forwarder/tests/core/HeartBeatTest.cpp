@@ -0,0 +1,82 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/HeartBeat.h>
+
+struct HeartBeatFixture : IIPBase {
+
+    std::string _log_dir;
+    heartbeat_params _hb;
+
+    HeartBeatFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup HeartBeatTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+
+        _hb.redis_params.host = _config_root["REDIS"]["LOCAL"]["HOST"]
+            .as<std::string>();
+        _hb.redis_params.port = _config_root["REDIS"]["LOCAL"]["PORT"]
+            .as<int>();
+        _hb.redis_params.db = _config_root["REDIS"]["LOCAL"]["DB"].as<int>();
+        _hb.key = "HeartBeatTest";
+        _hb.seconds_to_expire = 1;
+        _hb.seconds_to_update = 1;
+    }
+
+    ~HeartBeatFixture() {
+        BOOST_TEST_MESSAGE("TearDown HeartBeatTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(HeartBeatTest, HeartBeatFixture);
+
+BOOST_AUTO_TEST_CASE(beacon_keeps_watcher_quiet) {
+    Scheduler scheduler;
+    AsyncRedis redis(_hb.redis_params);
+    std::atomic<int> lost(0);
+    _hb.action = [&lost]() { lost++; };
+
+    Beacon beacon(scheduler, redis, _hb);
+    redis.flush();
+    Watcher watcher(scheduler, redis);
+    watcher.start(_hb);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    BOOST_CHECK_EQUAL(lost.load(), 0);
+
+    // key expires once the beacon stops, action runs exactly once
+    beacon.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+    BOOST_CHECK_EQUAL(lost.load(), 1);
+
+    watcher.clear();
+    redis.flush();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/LocalBroker.h>
+
+struct LocalBrokerFixture : IIPBase {
+
+    std::string _log_dir;
+
+    LocalBrokerFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup LocalBrokerTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~LocalBrokerFixture() {
+        BOOST_TEST_MESSAGE("TearDown LocalBrokerTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(LocalBrokerTest, LocalBrokerFixture);
+
+BOOST_AUTO_TEST_CASE(queues) {
+    LocalBroker broker;
+    Publisher& pub = broker;
+    pub.publish_message("a", "1");
+    pub.publish_message("b", "x");
+    pub.publish_message("a", "2");
+    BOOST_CHECK_EQUAL(broker.size("a"), 2);
+    BOOST_CHECK_EQUAL(broker.size("missing"), 0);
+
+    std::string body;
+    std::chrono::milliseconds timeout(0);
+    BOOST_CHECK(broker.get("a", body, timeout));
+    BOOST_CHECK_EQUAL(body, "1");
+    BOOST_CHECK(broker.get("a", body, timeout));
+    BOOST_CHECK_EQUAL(body, "2");
+    BOOST_CHECK(!broker.get("a", body, timeout));
+    BOOST_CHECK(broker.get("b", body, timeout));
+    BOOST_CHECK_EQUAL(body, "x");
+}
+
+BOOST_AUTO_TEST_CASE(run) {
+    LocalBroker broker;
+    std::vector<std::string> received;
+    std::thread consumer([&broker, &received]() {
+        broker.run("consume", [&received](const std::string& body) {
+            received.push_back(body);
+        });
+    });
+
+    for (int i = 0; i < 100; i++) {
+        broker.publish_message("consume", std::to_string(i));
+    }
+    while (broker.size("consume")) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    broker.stop();
+    consumer.join();
+
+    BOOST_CHECK_EQUAL(received.size(), 100);
+    for (size_t i = 0; i < received.size(); i++) {
+        BOOST_CHECK_EQUAL(received[i], std::to_string(i));
+    }
+
+    // stopped broker hands out nothing
+    std::string body;
+    broker.publish_message("consume", "late");
+    BOOST_CHECK(!broker.get("consume", body, std::chrono::milliseconds(10)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Exceptions.h>
+#include <core/MessagePipe.h>
+
+struct MessagePipeFixture : IIPBase {
+
+    std::string _log_dir;
+
+    MessagePipeFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup MessagePipeTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~MessagePipeFixture() {
+        BOOST_TEST_MESSAGE("TearDown MessagePipeTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(MessagePipeTest, MessagePipeFixture);
+
+BOOST_AUTO_TEST_CASE(frames) {
+    int fds[2];
+    BOOST_REQUIRE(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    MessagePipe supervisor(fds[0]);
+    MessagePipe worker(fds[1]);
+
+    // larger than a socket buffer, read while it is written
+    const std::string large(1 << 20, 'x');
+    std::thread writer([&worker, &large]() {
+        Publisher& pub = worker;
+        pub.publish_message("reply", "ack");
+        pub.publish_message("", "");
+        pub.publish_message("archive", large);
+    });
+
+    std::string queue, body;
+    BOOST_CHECK(supervisor.get(queue, body));
+    BOOST_CHECK_EQUAL(queue, "reply");
+    BOOST_CHECK_EQUAL(body, "ack");
+    BOOST_CHECK(supervisor.get(queue, body));
+    BOOST_CHECK(queue.empty());
+    BOOST_CHECK(body.empty());
+    BOOST_CHECK(supervisor.get(queue, body));
+    BOOST_CHECK_EQUAL(queue, "archive");
+    BOOST_CHECK(body == large);
+    writer.join();
+
+    // both directions
+    supervisor.publish_message("consume", "message");
+    BOOST_CHECK(worker.get(queue, body));
+    BOOST_CHECK_EQUAL(body, "message");
+}
+
+BOOST_AUTO_TEST_CASE(shutdown) {
+    int fds[2];
+    BOOST_REQUIRE(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    MessagePipe supervisor(fds[0]);
+    std::unique_ptr<MessagePipe> worker(new MessagePipe(fds[1]));
+
+    // what was sent before shutdown is still read
+    supervisor.publish_message("consume", "last");
+    supervisor.shutdown();
+    std::string queue, body;
+    BOOST_CHECK(worker->get(queue, body));
+    BOOST_CHECK_EQUAL(body, "last");
+    BOOST_CHECK(!worker->get(queue, body));
+
+    // the worker can still answer until it goes away
+    worker->publish_message("reply", "done");
+    BOOST_CHECK(supervisor.get(queue, body));
+    BOOST_CHECK_EQUAL(body, "done");
+    worker.reset();
+    BOOST_CHECK(!supervisor.get(queue, body));
+    BOOST_CHECK_THROW(supervisor.publish_message("consume", "lost"),
+            L1::PublisherError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Metrics.h>
+
+struct MetricsFixture : IIPBase {
+
+    std::string _log_dir;
+
+    MetricsFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup MetricsTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        Metrics::instance().clear();
+    }
+
+    ~MetricsFixture() {
+        BOOST_TEST_MESSAGE("TearDown MetricsTest fixture");
+        Metrics::instance().clear();
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(MetricsTest, MetricsFixture);
+
+BOOST_AUTO_TEST_CASE(buckets) {
+    // every value lands in a bucket whose upper bound is within 12.5%
+    for (uint64_t us : { 0ULL, 1ULL, 7ULL, 8ULL, 9ULL, 100ULL, 1000ULL,
+            123456ULL, 1ULL << 40, ~0ULL }) {
+        size_t b = Histogram::bucket(us);
+        BOOST_CHECK(b < METRICS_BUCKETS);
+        BOOST_CHECK(Histogram::upper(b) >= us);
+        BOOST_CHECK(Histogram::upper(b) - us <= us / METRICS_SUB_BUCKETS);
+        if (b > 0) {
+            BOOST_CHECK(Histogram::upper(b - 1) < us);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(percentile) {
+    Histogram hist;
+    BOOST_CHECK_EQUAL(hist.percentile(0.5), 0);
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        hist.record(i * 1000);
+    }
+    BOOST_CHECK_EQUAL(hist.count(), 1000);
+    BOOST_CHECK_EQUAL(hist.max(), 1000000);
+    BOOST_CHECK_EQUAL(hist.sum(), 500500000);
+
+    uint64_t p50 = hist.percentile(0.5);
+    uint64_t p99 = hist.percentile(0.99);
+    BOOST_CHECK(p50 >= 500000 && p50 <= 500000 * 9 / 8);
+    BOOST_CHECK(p99 >= 990000 && p99 <= 1000000);
+    BOOST_CHECK_EQUAL(hist.percentile(1.0), 1000000);
+    BOOST_CHECK_EQUAL(hist.count_below(511), 0);
+    BOOST_CHECK_EQUAL(hist.count_below(1000000), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(render) {
+    Metrics& metrics = Metrics::instance();
+    metrics.latency("decode", "SCIENCE", "22/0").record(300);
+    metrics.latency("decode", "SCIENCE", "22/0").record(5000);
+    metrics.counter("errors", "send").add(2);
+    metrics.gauge("pixel_pool_bytes", "resident").set(4096);
+    metrics.gauge("pixel_pool_bytes", "resident").add(-1024);
+
+    const std::string text = metrics.render();
+    const std::string labels = "stage=\"decode\",sensor=\"SCIENCE\","
+        "location=\"22/0\"";
+    BOOST_CHECK(text.find("# TYPE dm_forwarder_stage_seconds histogram")
+            != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_stage_seconds_bucket{" + labels
+                + ",le=\"0.000256\"} 0") != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_stage_seconds_bucket{" + labels
+                + ",le=\"0.001024\"} 1") != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_stage_seconds_bucket{" + labels
+                + ",le=\"+Inf\"} 2") != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_stage_seconds_count{" + labels
+                + "} 2") != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_errors_total{stage=\"send\","
+                "sensor=\"\",location=\"\"} 2") != std::string::npos);
+    BOOST_CHECK(text.find("# TYPE dm_forwarder_pixel_pool_bytes gauge")
+            != std::string::npos);
+    BOOST_CHECK(text.find("dm_forwarder_pixel_pool_bytes{stage=\"resident\","
+                "sensor=\"\",location=\"\"} 3072") != std::string::npos);
+
+    auto series = metrics.latencies();
+    BOOST_CHECK_EQUAL(series.size(), 1);
+    BOOST_CHECK_EQUAL(series[0].first.stage, "decode");
+    BOOST_CHECK_EQUAL(series[0].first.location, "22/0");
+    BOOST_CHECK_EQUAL(series[0].second->count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(server) {
+    Metrics::instance().latency("send").record(42);
+    MetricsServer server(0);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(server.port());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    BOOST_REQUIRE(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    BOOST_REQUIRE(write(fd, request.data(), request.size()) > 0);
+
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        response.append(buf, n);
+    }
+    close(fd);
+
+    BOOST_CHECK(response.find("HTTP/1.0 200 OK") == 0);
+    BOOST_CHECK(response.find("dm_forwarder_stage_seconds_count{"
+                "stage=\"send\",sensor=\"\",location=\"\"} 1")
+            != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Exceptions.h>
+#include <core/RedisPool.h>
+
+struct RedisPoolFixture : IIPBase {
+
+    std::string _log_dir;
+    redis_connection_params _params;
+
+    RedisPoolFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup RedisPoolTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+
+        _params.host = _config_root["REDIS"]["LOCAL"]["HOST"].as<std::string>();
+        _params.port = _config_root["REDIS"]["LOCAL"]["PORT"].as<int>();
+        _params.db = _config_root["REDIS"]["LOCAL"]["DB"].as<int>();
+    }
+
+    ~RedisPoolFixture() {
+        BOOST_TEST_MESSAGE("TearDown RedisPoolTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(RedisPoolTest, RedisPoolFixture);
+
+BOOST_AUTO_TEST_CASE(reuse) {
+    RedisConnection* first;
+    {
+        RedisPool::Lease con = RedisPool::instance().lease(_params);
+        first = &*con;
+    }
+    RedisPool::Lease con = RedisPool::instance().lease(_params);
+    BOOST_CHECK_EQUAL(&*con, first);
+}
+
+BOOST_AUTO_TEST_CASE(transaction) {
+    RedisPool::Lease con = RedisPool::instance().lease(_params);
+    con->set("RedisPoolTest", "1");
+    con->get("RedisPoolTest");
+    con->del({ "RedisPoolTest" });
+    std::vector<Reply> replies = con->transaction();
+
+    BOOST_CHECK_EQUAL(replies.size(), 3);
+    BOOST_CHECK_EQUAL(replies[1].str, "1");
+    BOOST_CHECK_EQUAL(replies[2].integer, 1);
+
+    std::map<std::string, redis_command_stats> stats =
+        RedisPool::instance().stats().begin()->second;
+    BOOST_CHECK(stats["exec"].count > 0);
+}
+
+BOOST_AUTO_TEST_CASE(error_keeps_sync) {
+    RedisPool::Lease con = RedisPool::instance().lease(_params);
+    con->set("RedisPoolTest", "1");
+    con->lpush("RedisPoolTest", { "wrong type" });
+    BOOST_CHECK_THROW(con->exec(), L1::RedisError);
+
+    // reply of the failed pipeline is not returned here
+    con->get("RedisPoolTest");
+    con->del({ "RedisPoolTest" });
+    std::vector<Reply> replies = con->exec();
+    BOOST_CHECK_EQUAL(replies[0].str, "1");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/RedisProtocol.h>
+
+struct RedisProtocolFixture : IIPBase {
+
+    std::string _log_dir;
+
+    RedisProtocolFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup RedisProtocolTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~RedisProtocolFixture() {
+        BOOST_TEST_MESSAGE("TearDown RedisProtocolTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(RedisProtocolTest, RedisProtocolFixture);
+
+BOOST_AUTO_TEST_CASE(encode) {
+    RedisEncoder encoder;
+    encoder.command(3);
+    encoder.arg("set");
+    encoder.arg("key");
+    encoder.arg(std::string(12, 'x'));
+    encoder.command(1);
+    encoder.arg("flushdb");
+
+    BOOST_CHECK_EQUAL(encoder.data(),
+            "*3\r\n$3\r\nset\r\n$3\r\nkey\r\n$12\r\nxxxxxxxxxxxx\r\n"
+            "*1\r\n$7\r\nflushdb\r\n");
+
+    encoder.clear();
+    BOOST_CHECK(encoder.data().empty());
+}
+
+BOOST_AUTO_TEST_CASE(parse) {
+    char a[] = "a";
+    char b[] = "bc";
+    redisReply elements[2];
+    std::memset(elements, 0, sizeof(elements));
+    elements[0].type = REDIS_REPLY_STRING;
+    elements[0].str = a;
+    elements[0].len = 1;
+    elements[1].type = REDIS_REPLY_INTEGER;
+    elements[1].integer = 7;
+    redisReply* ptrs[2] = { &elements[0], &elements[1] };
+
+    redisReply array;
+    std::memset(&array, 0, sizeof(array));
+    array.type = REDIS_REPLY_ARRAY;
+    array.elements = 2;
+    array.element = ptrs;
+
+    redisReply status;
+    std::memset(&status, 0, sizeof(status));
+    status.type = REDIS_REPLY_STATUS;
+    status.str = b;
+    status.len = 2;
+
+    RedisReplies replies;
+    replies.parse(&array);
+    replies.parse(&status);
+
+    BOOST_CHECK_EQUAL(replies.size(), 2);
+    BOOST_CHECK_EQUAL(replies[0].size, 2);
+    BOOST_CHECK_EQUAL(replies.element(replies[0], 0).str, "a");
+    BOOST_CHECK_EQUAL(replies.element(replies[0], 1).integer, 7);
+    BOOST_CHECK_EQUAL(replies[1].str, "bc");
+
+    Reply copy = replies.copy(replies[0]);
+    BOOST_CHECK_EQUAL(copy.elements.size(), 2);
+    BOOST_CHECK_EQUAL(copy.elements[0].str, "a");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
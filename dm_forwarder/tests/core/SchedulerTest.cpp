@@ -0,0 +1,125 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Scheduler.h>
+
+namespace chr = std::chrono;
+
+struct SchedulerFixture : IIPBase {
+
+    std::string _log_dir;
+
+    SchedulerFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup SchedulerTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~SchedulerFixture() {
+        BOOST_TEST_MESSAGE("TearDown SchedulerTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SchedulerTest, SchedulerFixture);
+
+BOOST_AUTO_TEST_CASE(after) {
+    Scheduler scheduler;
+    std::atomic<bool> fired(false);
+    auto start = chr::steady_clock::now();
+    std::atomic<long> waited(0);
+
+    scheduler.after(chr::milliseconds(50), [&]() {
+        waited = chr::duration_cast<chr::milliseconds>(
+                chr::steady_clock::now() - start).count();
+        fired = true;
+    });
+
+    std::this_thread::sleep_for(chr::milliseconds(300));
+    BOOST_CHECK(fired.load());
+    BOOST_CHECK(waited.load() >= 50);
+    BOOST_CHECK(waited.load() < 200);
+    BOOST_CHECK_EQUAL(scheduler.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(every) {
+    Scheduler scheduler;
+    std::atomic<int> runs(0);
+    Scheduler::timer_id id = scheduler.every(chr::milliseconds(20), [&]() {
+        runs++;
+    }, chr::milliseconds(0));
+
+    std::this_thread::sleep_for(chr::milliseconds(205));
+    scheduler.cancel(id);
+    const int seen = runs.load();
+
+    // first run is immediate, then one per period without drift
+    BOOST_CHECK(seen >= 9);
+    BOOST_CHECK(seen <= 12);
+
+    std::this_thread::sleep_for(chr::milliseconds(100));
+    BOOST_CHECK_EQUAL(runs.load(), seen);
+}
+
+BOOST_AUTO_TEST_CASE(cancel) {
+    Scheduler scheduler;
+    std::atomic<bool> fired(false);
+    Scheduler::timer_id id = scheduler.after(chr::milliseconds(50), [&]() {
+        fired = true;
+    });
+    scheduler.cancel(id);
+
+    std::this_thread::sleep_for(chr::milliseconds(150));
+    BOOST_CHECK(!fired.load());
+    BOOST_CHECK_EQUAL(scheduler.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(cascade) {
+    // with 1 ms ticks these deadlines sit on the second and third level
+    Scheduler scheduler(chr::milliseconds(1));
+    std::vector<int> delays{ 5, 100, 70, 300, 4200 };
+    std::vector<std::atomic<long>> waited(delays.size());
+    auto start = chr::steady_clock::now();
+
+    for (size_t i = 0; i < delays.size(); i++) {
+        waited[i] = -1;
+        scheduler.after(chr::milliseconds(delays[i]), [&, i]() {
+            waited[i] = chr::duration_cast<chr::milliseconds>(
+                    chr::steady_clock::now() - start).count();
+        });
+    }
+
+    std::this_thread::sleep_for(chr::milliseconds(4400));
+    for (size_t i = 0; i < delays.size(); i++) {
+        BOOST_CHECK(waited[i].load() >= delays[i]);
+        BOOST_CHECK(waited[i].load() < delays[i] + 50);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
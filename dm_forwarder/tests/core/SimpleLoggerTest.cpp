@@ -0,0 +1,110 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/SimpleLogger.h>
+
+struct SimpleLoggerFixture : IIPBase {
+
+    std::string _log_dir;
+
+    SimpleLoggerFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup SimpleLoggerTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~SimpleLoggerFixture() {
+        BOOST_TEST_MESSAGE("TearDown SimpleLoggerTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+
+    // lines of the log file containing needle
+    std::vector<std::string> grep(const std::string& needle) {
+        flush_log();
+        std::ifstream log(_log_dir + "/test.log.0");
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(log, line)) {
+            if (line.find(needle) != std::string::npos) {
+                lines.push_back(line);
+            }
+        }
+        return lines;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SimpleLoggerTest, SimpleLoggerFixture);
+
+BOOST_AUTO_TEST_CASE(record) {
+    LOG_WRN << "record " << 42 << " " << -7 << " " << 2.5 << " "
+            << std::string("done");
+
+    std::vector<std::string> lines = grep("record 42 -7 2.5 done");
+    BOOST_CHECK_EQUAL(lines.size(), 1);
+    BOOST_CHECK_EQUAL(lines[0].find("warning"), 0);
+    BOOST_CHECK(lines[0].find("SimpleLoggerTest.cpp") != std::string::npos);
+    BOOST_CHECK(lines[0].find("test_method") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(truncate) {
+    LOG_INF << "truncate " << std::string(2 * LOG_MESSAGE_SIZE, 'x');
+
+    std::vector<std::string> lines = grep("truncate ");
+    BOOST_CHECK_EQUAL(lines.size(), 1);
+    BOOST_CHECK(lines[0].find("x...") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(sampled) {
+    for (int i = 0; i < 100; i++) {
+        LOG_EVERY_N(info, 10) << "sampled " << i;
+        LOG_EVERY_MS(info, 60000) << "limited " << i;
+    }
+
+    BOOST_CHECK_EQUAL(grep("sampled ").size(), 10);
+    BOOST_CHECK_EQUAL(grep("limited ").size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([t]() {
+            for (int i = 0; i < 100; i++) {
+                LOG_INF << "thread " << t << " line " << i;
+            }
+        }));
+    }
+    for (auto&& t : threads) {
+        t.join();
+    }
+
+    // rings of exited threads are still written out
+    BOOST_CHECK_EQUAL(grep("thread ").size(), 400);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/TokenBucket.h>
+
+struct TokenBucketFixture : IIPBase {
+
+    std::string _log_dir;
+
+    TokenBucketFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup TokenBucketTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~TokenBucketFixture() {
+        BOOST_TEST_MESSAGE("TearDown TokenBucketTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(TokenBucketTest, TokenBucketFixture);
+
+BOOST_AUTO_TEST_CASE(unlimited) {
+    TokenBucket bucket(0, 0);
+    BOOST_CHECK_EQUAL(bucket.take(uint64_t(1) << 40), 0);
+}
+
+BOOST_AUTO_TEST_CASE(rate) {
+    // 1000 tokens per second, starts with a burst of 100
+    TokenBucket bucket(1000, 100);
+    BOOST_CHECK_EQUAL(bucket.take(100), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t waited = bucket.take(200);
+    waited += bucket.take(100);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    // 300 tokens of debt take 300 ms to pay off
+    BOOST_CHECK_GE(waited, 250000);
+    BOOST_CHECK_LE(waited, 310000);
+    BOOST_CHECK_GE(elapsed, 250);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Tracer.h>
+
+struct TracerFixture : IIPBase {
+
+    std::string _log_dir;
+    std::string _trace;
+
+    TracerFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup TracerTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        _trace = _log_dir + "/trace.json";
+    }
+
+    ~TracerFixture() {
+        BOOST_TEST_MESSAGE("TearDown TracerTest fixture");
+        Tracer::instance().stop();
+        std::remove(_trace.c_str());
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+
+    std::string read_trace() {
+        Tracer::instance().dump(_trace);
+        std::ifstream f(_trace);
+        std::stringstream ss;
+        ss << f.rdbuf();
+        return ss.str();
+    }
+
+    size_t count(const std::string& text, const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos;
+                pos = text.find(needle, pos + 1)) {
+            n++;
+        }
+        return n;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(TracerTest, TracerFixture);
+
+BOOST_AUTO_TEST_CASE(disabled) {
+    Tracer::instance().start();
+    Tracer::instance().stop();
+    {
+        TraceSpan span("ignored", "AT_O_20200101_000001", "22/0");
+    }
+    BOOST_CHECK_EQUAL(count(read_trace(), "\"ignored\""), 0);
+}
+
+BOOST_AUTO_TEST_CASE(spans) {
+    Tracer::instance().start();
+    std::thread worker([]() {
+        Tracer::instance().name_thread("worker");
+        TraceSpan outer("outer", "AT_O_20200101_000001", "22/0");
+        TraceSpan inner("inner", "AT_O_20200101_000001", "22/\"1\"");
+    });
+    worker.join();
+    {
+        TraceSpan span("main", "AT_O_20200101_000001");
+    }
+    Tracer::instance().stop();
+
+    const std::string text = read_trace();
+    BOOST_CHECK(text.find("{\"traceEvents\":[") == 0);
+    BOOST_CHECK_EQUAL(count(text, "\"ph\":\"X\""), 3);
+    BOOST_CHECK_EQUAL(count(text, "\"thread_name\""), 1);
+    BOOST_CHECK(text.find("\"args\":{\"name\":\"worker\"}") !=
+            std::string::npos);
+    BOOST_CHECK(text.find("\"location\":\"22/\\\"1\\\"\"") !=
+            std::string::npos);
+    BOOST_CHECK(text.find("\"args\":{\"image\":\"AT_O_20200101_000001\","
+                "\"location\":\"\"}") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(restart) {
+    Tracer::instance().start();
+    {
+        TraceSpan span("first");
+    }
+    Tracer::instance().start();
+    {
+        TraceSpan span("second");
+    }
+    Tracer::instance().stop();
+
+    const std::string text = read_trace();
+    BOOST_CHECK_EQUAL(count(text, "\"first\""), 0);
+    BOOST_CHECK_EQUAL(count(text, "\"second\""), 1);
+
+    // buffers of threads that ended are gone after a restart
+    BOOST_CHECK_EQUAL(count(text, "\"worker\""), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/WorkerPool.h>
+
+struct WorkerPoolFixture : IIPBase {
+
+    std::string _log_dir;
+
+    WorkerPoolFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup WorkerPoolTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~WorkerPoolFixture() {
+        BOOST_TEST_MESSAGE("TearDown WorkerPoolTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(WorkerPoolTest, WorkerPoolFixture);
+
+BOOST_AUTO_TEST_CASE(run) {
+    for (int threads = 0; threads < 4; threads++) {
+        WorkerPool pool("test", threads);
+        BOOST_CHECK_EQUAL(pool.size(), threads);
+
+        std::vector<int> out(100, 0);
+        std::vector<std::function<void ()>> tasks;
+        for (int i = 0; i < 100; i++) {
+            tasks.push_back([&out, i]() { out[i] = i * 2; });
+        }
+        pool.run(tasks);
+        for (int i = 0; i < 100; i++) {
+            BOOST_CHECK_EQUAL(out[i], i * 2);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(callers) {
+    // more callers than workers, each waits only for its own tasks
+    WorkerPool pool("test", 2);
+    std::atomic<int> done(0);
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 4; c++) {
+        callers.push_back(std::thread([&pool, &done]() {
+            std::vector<std::function<void ()>> tasks;
+            for (int i = 0; i < 50; i++) {
+                tasks.push_back([&done]() { done++; });
+            }
+            pool.run(tasks);
+        }));
+    }
+    for (auto&& caller : callers) {
+        caller.join();
+    }
+    BOOST_CHECK_EQUAL(done.load(), 200);
+}
+
+BOOST_AUTO_TEST_CASE(error) {
+    WorkerPool pool("test", 2);
+    std::atomic<int> done(0);
+    std::vector<std::function<void ()>> tasks;
+    for (int i = 0; i < 10; i++) {
+        tasks.push_back([&done, i]() {
+            done++;
+            if (i == 3) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    }
+    BOOST_CHECK_THROW(pool.run(tasks), std::runtime_error);
+    BOOST_CHECK_EQUAL(done.load(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
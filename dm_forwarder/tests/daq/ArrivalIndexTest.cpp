@@ -0,0 +1,101 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <daq/ArrivalIndex.h>
+
+struct ArrivalIndexFixture : IIPBase {
+
+    std::string _log_dir;
+
+    ArrivalIndexFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ArrivalIndexTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~ArrivalIndexFixture() {
+        BOOST_TEST_MESSAGE("TearDown ArrivalIndexTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ArrivalIndexTest, ArrivalIndexFixture);
+
+BOOST_AUTO_TEST_CASE(out_of_order) {
+    ArrivalIndex index(8);
+    index.arrived("AT_O_20190101_000001", "raw");
+    index.complete("AT_O_20190101_000001", "raw");
+    index.arrived("AT_O_20190101_000002", "raw");
+    index.complete("AT_O_20190101_000002", "raw");
+
+    // END_READOUT for the second image first, then the first
+    std::chrono::microseconds timeout(0);
+    BOOST_CHECK(index.wait("AT_O_20190101_000002", "raw", timeout));
+    BOOST_CHECK(index.wait("AT_O_20190101_000001", "raw", timeout));
+    BOOST_CHECK(!index.wait("AT_O_20190101_000001", "other", timeout));
+}
+
+BOOST_AUTO_TEST_CASE(wait) {
+    ArrivalIndex index(8);
+    index.arrived("AT_O_20190101_000001", "raw");
+    BOOST_CHECK(!index.ready("AT_O_20190101_000001", "raw"));
+
+    std::thread listener([&index]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        index.complete("AT_O_20190101_000001", "raw");
+    });
+    BOOST_CHECK(index.wait("AT_O_20190101_000001", "raw",
+                std::chrono::seconds(5)));
+    listener.join();
+    BOOST_CHECK(index.ready("AT_O_20190101_000001", "raw"));
+}
+
+BOOST_AUTO_TEST_CASE(failed) {
+    ArrivalIndex index(8);
+    index.arrived("AT_O_20190101_000001", "raw");
+    index.failed("AT_O_20190101_000001", "raw");
+
+    // barrier timeout is reported without waiting again
+    auto start = std::chrono::steady_clock::now();
+    BOOST_CHECK(!index.wait("AT_O_20190101_000001", "raw",
+                std::chrono::seconds(5)));
+    BOOST_CHECK(std::chrono::steady_clock::now() - start
+            < std::chrono::seconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(eviction) {
+    ArrivalIndex index(2);
+    index.complete("AT_O_20190101_000001", "raw");
+    index.complete("AT_O_20190101_000002", "raw");
+    index.complete("AT_O_20190101_000003", "raw");
+
+    BOOST_CHECK_EQUAL(index.size(), 2);
+    BOOST_CHECK(!index.ready("AT_O_20190101_000001", "raw"));
+    BOOST_CHECK(index.ready("AT_O_20190101_000003", "raw"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
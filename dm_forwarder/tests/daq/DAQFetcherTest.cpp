@@ -181,8 +181,8 @@ BOOST_AUTO_TEST_CASE(declutter) {
     // Valid
     Data d(_sensors, _samples, _arr, _meta);
     std::vector<Data> vec {d, d, d};
-    BOOST_CHECK_NO_THROW(_daq->declutter(vec, 300,
-        DAQ::Sensor::Type::SCIENCE));
+    BOOST_CHECK_NO_THROW(_daq->declutter(vec, 300));
+    BOOST_CHECK_EQUAL(_daq->declutter(vec, 300).d1(), _sensors);
 }
 
 BOOST_AUTO_TEST_CASE(naxes) {
@@ -0,0 +1,176 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/WorkerPool.h>
+#include <daq/Declutter.h>
+#include <daq/Pixel3d.h>
+
+struct DeclutterFixture : IIPBase {
+
+    std::string _log_dir;
+
+    DeclutterFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup DeclutterTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~DeclutterFixture() {
+        BOOST_TEST_MESSAGE("TearDown DeclutterTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+
+    // pixel of ccd, sample and segment as the DAQ would hand it over
+    static int32_t pixel(int ccd, int sample, int segment) {
+        return ccd * 100000 + sample * DECLUTTER_SEGMENTS + segment;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(DeclutterTest, DeclutterFixture);
+
+BOOST_AUTO_TEST_CASE(chunks) {
+    const int ccds = 3;
+    const int samples = 10;
+    const int32_t xor_pattern = 0x1FFFF;
+
+    // two chunks of 6 and 4 samples
+    std::vector<std::vector<int32_t>> first(ccds), second(ccds);
+    for (int i = 0; i < ccds; i++) {
+        for (int j = 0; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                (j < 6 ? first : second)[i].push_back(pixel(i, j, k));
+            }
+        }
+    }
+
+    Pixel3d pixels(ccds, DECLUTTER_SEGMENTS, samples);
+    std::vector<const int32_t*> stripes(ccds);
+    for (int i = 0; i < ccds; i++) {
+        stripes[i] = first[i].data();
+    }
+    declutter_stripes(pixels.get(), stripes.data(), ccds, 6, 0, xor_pattern);
+    for (int i = 0; i < ccds; i++) {
+        stripes[i] = second[i].data();
+    }
+    declutter_stripes(pixels.get(), stripes.data(), ccds, 4, 6, xor_pattern);
+
+    int32_t*** pix = pixels.get();
+    for (int i = 0; i < ccds; i++) {
+        for (int j = 0; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                BOOST_CHECK_EQUAL(pix[i][k][j], xor_pattern ^ pixel(i, j, k));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kernels) {
+    // chunks that are not a multiple of the tile
+    const int samples = 3 * DECLUTTER_TILE + 5;
+    const int chunk = DECLUTTER_TILE + 3;
+    const int32_t xor_pattern = 0x200000;
+
+    for (int ccds = 1; ccds <= 3; ccds++) {
+        declutter_kernel kernel = declutter_for(ccds);
+        BOOST_REQUIRE(kernel != nullptr);
+
+        std::vector<std::vector<int32_t>> data(ccds);
+        for (int i = 0; i < ccds; i++) {
+            for (int j = 0; j < samples; j++) {
+                for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                    data[i].push_back(pixel(i, j, k));
+                }
+            }
+        }
+
+        Pixel3d pixels(ccds, DECLUTTER_SEGMENTS, samples);
+        std::vector<const int32_t*> stripes(ccds);
+        for (int offset = 0; offset < samples; offset += chunk) {
+            int n = std::min(chunk, samples - offset);
+            for (int i = 0; i < ccds; i++) {
+                stripes[i] = data[i].data() + offset * DECLUTTER_SEGMENTS;
+            }
+            kernel(pixels.get(), stripes.data(), n, offset, xor_pattern);
+        }
+
+        int32_t*** pix = pixels.get();
+        for (int i = 0; i < ccds; i++) {
+            for (int j = 0; j < samples; j++) {
+                for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                    BOOST_CHECK_EQUAL(pix[i][k][j],
+                            xor_pattern ^ pixel(i, j, k));
+                }
+            }
+        }
+    }
+
+    BOOST_CHECK(declutter_for(4) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(parallel) {
+    // blocks cross chunk boundaries and the last block is a partial tile
+    const int ccds = 2;
+    const int64_t samples = 3 * DECLUTTER_TASK_SAMPLES + 5;
+    const int64_t chunk = 50000;
+    const int32_t xor_pattern = 0x1FFFF;
+
+    std::vector<std::vector<int32_t>> data(ccds);
+    for (int i = 0; i < ccds; i++) {
+        for (int64_t j = 0; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                data[i].push_back(pixel(i, j, k));
+            }
+        }
+    }
+
+    std::vector<stripe_chunk> chunks;
+    for (int64_t offset = 0; offset < samples; offset += chunk) {
+        stripe_chunk c;
+        for (int i = 0; i < ccds; i++) {
+            c.stripes.push_back(data[i].data() + offset * DECLUTTER_SEGMENTS);
+        }
+        c.samples = std::min(chunk, samples - offset);
+        chunks.push_back(c);
+    }
+
+    WorkerPool pool("declutter", 3);
+    Pixel3d pixels(ccds, DECLUTTER_SEGMENTS, samples);
+    declutter_chunks(pixels.get(), chunks, ccds, xor_pattern, &pool);
+
+    int32_t*** pix = pixels.get();
+    int64_t wrong = 0;
+    for (int i = 0; i < ccds; i++) {
+        for (int64_t j = 0; j < samples; j++) {
+            for (int k = 0; k < DECLUTTER_SEGMENTS; k++) {
+                wrong += pix[i][k][j] != (xor_pattern ^ pixel(i, j, k));
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(wrong, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
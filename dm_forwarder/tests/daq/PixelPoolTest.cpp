@@ -0,0 +1,125 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Exceptions.h>
+#include <core/Metrics.h>
+#include <daq/PixelPool.h>
+#include <daq/Pixel3d.h>
+
+struct PixelPoolFixture : IIPBase {
+
+    std::string _log_dir;
+
+    PixelPoolFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup PixelPoolTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        Metrics::instance().clear();
+    }
+
+    ~PixelPoolFixture() {
+        BOOST_TEST_MESSAGE("TearDown PixelPoolTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(PixelPoolTest, PixelPoolFixture);
+
+BOOST_AUTO_TEST_CASE(reuse) {
+    PixelPool pool(1 << 20, PixelPages::TRANSPARENT);
+    void* a = pool.acquire(10000);
+    BOOST_CHECK_EQUAL(pool.resident(), 12288);
+    pool.release(a, 10000);
+    BOOST_CHECK_EQUAL(pool.resident(), 12288);
+
+    // same size comes back prefaulted, other sizes get their own buffer
+    void* b = pool.acquire(10000);
+    BOOST_CHECK(a == b);
+    void* c = pool.acquire(5000);
+    BOOST_CHECK(c != b);
+    BOOST_CHECK_EQUAL(pool.resident(), 12288 + 8192);
+    pool.release(b, 10000);
+    pool.release(c, 5000);
+
+    Metrics& metrics = Metrics::instance();
+    BOOST_CHECK_EQUAL(metrics.counter("pixel_pool", "hit").value(), 1);
+    BOOST_CHECK_EQUAL(metrics.counter("pixel_pool", "miss").value(), 2);
+    BOOST_CHECK_EQUAL(metrics.gauge("pixel_pool_bytes", "resident").value(),
+            12288 + 8192);
+}
+
+BOOST_AUTO_TEST_CASE(cap) {
+    PixelPool pool(16384, PixelPages::NORMAL);
+    void* a = pool.acquire(8192);
+    pool.release(a, 8192);
+
+    // idle buffer of another size is unmapped to make room
+    void* b = pool.acquire(16384);
+    BOOST_CHECK_EQUAL(pool.resident(), 16384);
+
+    // over the cap while b is in use, released instead of kept
+    void* c = pool.acquire(4096);
+    BOOST_CHECK_EQUAL(pool.resident(), 20480);
+    pool.release(c, 4096);
+    BOOST_CHECK_EQUAL(pool.resident(), 16384);
+    pool.release(b, 16384);
+    BOOST_CHECK_EQUAL(pool.resident(), 16384);
+}
+
+BOOST_AUTO_TEST_CASE(pixel3d) {
+    PixelPool pool(1 << 24, PixelPages::TRANSPARENT);
+    int32_t* first;
+    {
+        Pixel3d p(3, 16, 1000, &pool);
+        int32_t*** arr = p.get();
+        first = arr[0][0];
+        arr[2][15][999] = 42;
+        BOOST_CHECK(arr[1][0] == first + 16 * 1000);
+    }
+
+    // next image of the sensor type reuses the buffer
+    Pixel3d p(3, 16, 1000, &pool);
+    BOOST_CHECK(p.get()[0][0] == first);
+    BOOST_CHECK_EQUAL(pool.resident(), 3 * 16 * 1000 * 4 + 512);
+
+    Pixel3d moved(std::move(p));
+    BOOST_CHECK(moved.get()[0][0] == first);
+    BOOST_CHECK(p.get() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(pages) {
+    BOOST_CHECK(PixelPool::pages("normal") == PixelPages::NORMAL);
+    BOOST_CHECK(PixelPool::pages("transparent") == PixelPages::TRANSPARENT);
+    BOOST_CHECK(PixelPool::pages("hugetlb") == PixelPages::HUGETLB);
+    BOOST_CHECK_THROW(PixelPool::pages("huge"), L1::YamlKeyError);
+
+    // hugetlb falls back when no pages are reserved
+    PixelPool pool(1 << 24, PixelPages::HUGETLB);
+    void* a = pool.acquire(1000);
+    BOOST_CHECK(a != nullptr);
+    pool.release(a, 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,104 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <daq/ScanIndex.h>
+
+struct ScanIndexFixture : IIPBase {
+
+    std::string _log_dir;
+    std::string _path;
+
+    ScanIndexFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ScanIndexTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        _path = _log_dir + "/scan.index";
+        std::remove(_path.c_str());
+    }
+
+    ~ScanIndexFixture() {
+        BOOST_TEST_MESSAGE("TearDown ScanIndexTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+        std::remove(_path.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ScanIndexTest, ScanIndexFixture);
+
+BOOST_AUTO_TEST_CASE(persist) {
+    {
+        ScanIndex index(_path);
+        BOOST_CHECK_EQUAL(index.size(), 0);
+        BOOST_CHECK_EQUAL(index.high_water(), 0);
+
+        index.put(7, scan_entry{ 1600000000, "MC_O_20200913_000001" });
+        index.put(3, scan_entry{ 1600000100, "" });
+        index.save();
+    }
+
+    ScanIndex index(_path);
+    BOOST_CHECK_EQUAL(index.size(), 2);
+    BOOST_CHECK_EQUAL(index.high_water(), 7);
+
+    scan_entry e;
+    BOOST_REQUIRE(index.find(7, e));
+    BOOST_CHECK_EQUAL(e.seconds, 1600000000);
+    BOOST_CHECK_EQUAL(e.name, "MC_O_20200913_000001");
+    BOOST_REQUIRE(index.find(3, e));
+    BOOST_CHECK(e.name.empty());
+    BOOST_CHECK(!index.find(5, e));
+}
+
+BOOST_AUTO_TEST_CASE(retain) {
+    ScanIndex index;
+    for (uint64_t id = 1; id <= 5; id++) {
+        index.put(id, scan_entry{ 0, "MC_O_20200913_00000" +
+                std::to_string(id) });
+    }
+
+    // removed from the catalog, the high-water mark stays
+    BOOST_CHECK_EQUAL(index.retain({ 1, 2, 3 }), 2);
+    BOOST_CHECK_EQUAL(index.size(), 3);
+    BOOST_CHECK_EQUAL(index.high_water(), 5);
+
+    // memory only index does not write
+    BOOST_CHECK_NO_THROW(index.save());
+}
+
+BOOST_AUTO_TEST_CASE(bad_file) {
+    {
+        std::ofstream out(_path);
+        out << "high_water 9\n1 1600000000 MC_O_20200913_000001\n2 oops\n";
+    }
+
+    // rebuilt by the next scan
+    ScanIndex index(_path);
+    BOOST_CHECK_EQUAL(index.size(), 0);
+    BOOST_CHECK_EQUAL(index.high_water(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
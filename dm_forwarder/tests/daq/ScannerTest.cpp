@@ -27,6 +27,7 @@
 #include <core/IIPBase.h>
 #include <core/Exceptions.h>
 #include <ims/Folder.hh>
+#include <daq/ScanIndex.h>
 #include <daq/Scanner.h>
 
 namespace fs = boost::filesystem;
@@ -81,4 +82,22 @@ BOOST_AUTO_TEST_CASE(get_images) {
     BOOST_CHECK_EQUAL(scanner2.get_images().size(), folder.length());
 }
 
+BOOST_AUTO_TEST_CASE(incremental) {
+    IMS::Store store(_partition.c_str());
+    IMS::Folder folder(_folder.c_str(), store.catalog);
+    ScanIndex index;
+
+    Scanner scanner(_partition, 60*24*730, &index);
+    folder.traverse(scanner);
+    std::vector<std::string> images = scanner.get_images();
+    BOOST_CHECK_EQUAL(index.size(), folder.length());
+
+    // answered from the index, oldest first as before
+    Scanner again(_partition, 60*24*730, &index);
+    folder.traverse(again);
+    std::vector<std::string> cached = again.get_images();
+    BOOST_CHECK_EQUAL_COLLECTIONS(images.begin(), images.end(),
+            cached.begin(), cached.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
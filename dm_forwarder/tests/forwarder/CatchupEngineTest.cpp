@@ -0,0 +1,137 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <forwarder/CatchupEngine.h>
+
+struct CatchupEngineFixture : IIPBase {
+
+    std::string _log_dir;
+    std::string _checkpoint;
+
+    CatchupEngineFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup CatchupEngineTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        _checkpoint = _log_dir + "/catchup.checkpoint";
+        std::remove(_checkpoint.c_str());
+    }
+
+    ~CatchupEngineFixture() {
+        BOOST_TEST_MESSAGE("TearDown CatchupEngineTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+        std::remove(_checkpoint.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(CatchupEngineTest, CatchupEngineFixture);
+
+BOOST_AUTO_TEST_CASE(oldest_first) {
+    BOOST_CHECK_EQUAL(CatchupEngine::age("MC_O_20201018_000042"),
+            "20201018_000042");
+
+    std::atomic<bool> release(false);
+    std::vector<std::string> done;
+    {
+        CatchupEngine engine(1, _checkpoint);
+        engine.run("AT_O_20190101_000009", [&release]() {
+            while (!release.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        for (auto&& id : { "AT_O_20190102_000001", "AT_O_20190101_000002",
+                "AT_O_20190101_000001" }) {
+            std::string image_id(id);
+            engine.run(image_id, [&done, &engine, image_id]() {
+                done.push_back(image_id);
+                engine.done(image_id);
+            });
+        }
+        release = true;
+        while (engine.size() > 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::vector<std::string> expected{ "AT_O_20190101_000001",
+        "AT_O_20190101_000002", "AT_O_20190102_000001" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(done.begin(), done.end(), expected.begin(),
+            expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(concurrency) {
+    std::atomic<int> running(0);
+    std::atomic<int> most(0);
+    {
+        CatchupEngine engine(3, _checkpoint);
+        for (int i = 0; i < 6; i++) {
+            engine.run("AT_O_20190101_00000" + std::to_string(i),
+                    [&running, &most]() {
+                int now = ++running;
+                int seen = most.load();
+                while (now > seen && !most.compare_exchange_weak(seen, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                running--;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    BOOST_CHECK_EQUAL(most.load(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint) {
+    {
+        CatchupEngine engine(1, _checkpoint);
+        engine.add({ "AT_O_20190101_000003", "AT_O_20190101_000001" });
+        engine.add({ "AT_O_20190101_000002", "AT_O_20190101_000001" });
+        BOOST_CHECK_EQUAL(engine.size(), 3);
+        engine.done("AT_O_20190101_000001");
+    }
+
+    // restart resumes pending images, oldest first
+    {
+        CatchupEngine engine(1, _checkpoint);
+        std::vector<std::string> pending = engine.pending();
+        std::vector<std::string> expected{ "AT_O_20190101_000002",
+            "AT_O_20190101_000003" };
+        BOOST_CHECK_EQUAL_COLLECTIONS(pending.begin(), pending.end(),
+                expected.begin(), expected.end());
+
+        engine.done("AT_O_20190101_000002");
+        engine.done("AT_O_20190101_000003");
+    }
+
+    CatchupEngine engine(1, _checkpoint);
+    BOOST_CHECK_EQUAL(engine.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
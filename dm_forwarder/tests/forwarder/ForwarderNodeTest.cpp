@@ -0,0 +1,125 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <chrono>
+#include <unistd.h>
+#include <climits>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/LocalBroker.h>
+#include <forwarder/ForwarderNode.h>
+
+struct ForwarderNodeFixture : IIPBase {
+
+    std::string _log_dir;
+
+    ForwarderNodeFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ForwarderNodeTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~ForwarderNodeFixture() {
+        BOOST_TEST_MESSAGE("TearDown ForwarderNodeTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+
+    YAML::Node build_health_check() {
+        YAML::Node n;
+        n["MSG_TYPE"] = "AT_FWDR_HEALTH_CHECK";
+        n["IMAGE_ID"] = "AT_O_20191205_000001";
+        n["ACK_ID"] = "ack_1";
+        n["REPLY_QUEUE"] = "at_foreman_ack_publish";
+        return n;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ForwarderNodeTest, ForwarderNodeFixture);
+
+BOOST_AUTO_TEST_CASE(name) {
+    char hostname[HOST_NAME_MAX];
+    gethostname(hostname, HOST_NAME_MAX);
+
+    ForwarderNode node(_config_root);
+    const std::string suffix = ":" + std::string(hostname);
+    BOOST_CHECK(node.name().size() > suffix.size());
+    BOOST_CHECK_EQUAL(node.name().substr(node.name().size() - suffix.size()),
+            suffix);
+    BOOST_CHECK_EQUAL(node.consume_q(),
+            _config_root["CONSUME_QUEUE"].as<std::string>());
+}
+
+BOOST_AUTO_TEST_CASE(publish_ack) {
+    ForwarderNode node(_config_root);
+    LocalBroker broker;
+    std::chrono::milliseconds timeout(0);
+    std::string body;
+
+    node.publish_ack(broker, build_health_check());
+    BOOST_CHECK(broker.get("at_foreman_ack_publish", body, timeout));
+    YAML::Node ack = YAML::Load(body);
+    BOOST_CHECK_EQUAL(ack["MSG_TYPE"].as<std::string>(),
+            "AT_FWDR_HEALTH_CHECK_ACK");
+    BOOST_CHECK_EQUAL(ack["COMPONENT"].as<std::string>(), node.name());
+    BOOST_CHECK_EQUAL(ack["ACK_ID"].as<std::string>(), "ack_1");
+
+    // malformed messages are not acked
+    YAML::Node n = build_health_check();
+    n.remove("REPLY_QUEUE");
+    BOOST_CHECK_NO_THROW(node.publish_ack(broker, n, false));
+    BOOST_CHECK_EQUAL(broker.size("at_foreman_ack_publish"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(actions) {
+    std::string called;
+    auto record = [&called](const std::string& handler) {
+        return [&called, handler](const YAML::Node&) { called = handler; };
+    };
+    ForwarderNode::handlers h;
+    h.health_check = record("health_check");
+    h.xfer_params = record("xfer_params");
+    h.header_ready = record("header_ready");
+    h.end_readout = record("end_readout");
+    h.process_ack = record("process_ack");
+    h.associated = record("associated");
+    h.scan = record("scan");
+    h.trace = record("trace");
+
+    auto table = ForwarderNode::actions(h);
+    BOOST_CHECK_EQUAL(table.size(), 16);
+
+    YAML::Node n;
+    table["CATCHUP_FWDR_END_READOUT"](n);
+    BOOST_CHECK_EQUAL(called, "end_readout");
+    table["CC_FWDR_XFER_PARAMS"](n);
+    BOOST_CHECK_EQUAL(called, "xfer_params");
+    table["AT_FWDR_HEALTH_CHECK"](n);
+    BOOST_CHECK_EQUAL(called, "health_check");
+    table["FILE_TRANSFER_COMPLETED_ACK"](n);
+    BOOST_CHECK_EQUAL(called, "process_ack");
+    table["TRACE"](n);
+    BOOST_CHECK_EQUAL(called, "trace");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <yaml-cpp/yaml.h>
+#include <core/IIPBase.h>
+#include <forwarder/ImageCost.h>
+#include <forwarder/MessageBuilder.h>
+
+struct ImageCostFixture : IIPBase {
+
+    std::string _log_dir;
+
+    ImageCostFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ImageCostTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~ImageCostFixture() {
+        BOOST_TEST_MESSAGE("TearDown ImageCostTest fixture");
+        ImageCost::instance().remove("AT_O_20200101_000001");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ImageCostTest, ImageCostFixture);
+
+BOOST_AUTO_TEST_CASE(accounting) {
+    const std::string image = "AT_O_20200101_000001";
+    ImageCost& cost = ImageCost::instance();
+    BOOST_CHECK_EQUAL(cost.get(image).daq_bytes, 0);
+
+    cost.add_daq(image, 100);
+    cost.add_daq(image, 20);
+    cost.add_written(image, 300);
+    cost.add_sent(image, 400);
+
+    image_cost c = cost.get(image);
+    BOOST_CHECK_EQUAL(c.daq_bytes, 120);
+    BOOST_CHECK_EQUAL(c.written_bytes, 300);
+    BOOST_CHECK_EQUAL(c.sent_bytes, 400);
+
+    cost.expire(std::chrono::seconds(60));
+    BOOST_CHECK_EQUAL(cost.get(image).daq_bytes, 120);
+    cost.expire(std::chrono::seconds(0));
+    BOOST_CHECK_EQUAL(cost.get(image).daq_bytes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(peak_pixels) {
+    const std::string image = "AT_O_20200101_000001";
+    {
+        PixelCharge first(image, 1000);
+        {
+            PixelCharge second(image, 500);
+        }
+        PixelCharge third(image, 200);
+    }
+    PixelCharge fourth(image, 800);
+    BOOST_CHECK_EQUAL(ImageCost::instance().get(image).peak_pixel_bytes,
+            1500);
+}
+
+BOOST_AUTO_TEST_CASE(cpu) {
+    const std::string image = "AT_O_20200101_000001";
+
+    // sleeping threads do not burn cpu, spinning ones do
+    std::thread idle([&image]() {
+        CpuTimer cpu(image);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    idle.join();
+    BOOST_CHECK(ImageCost::instance().get(image).cpu_us < 20000);
+
+    std::thread busy([&image]() {
+        CpuTimer cpu(image);
+        uint64_t start = ImageCost::thread_cpu();
+        volatile uint64_t x = 0;
+        while (ImageCost::thread_cpu() - start < 50000) {
+            x++;
+        }
+    });
+    busy.join();
+    BOOST_CHECK(ImageCost::instance().get(image).cpu_us >= 50000);
+}
+
+BOOST_AUTO_TEST_CASE(message) {
+    MessageBuilder builder;
+    image_cost cost{ 1, 2, 3, 4, 5 };
+    YAML::Node n = YAML::Load(builder.build_image_retrieval_for_archiving(
+            0, "AT_O_20200101_000001", "00", "00", "/tmp/a.fits", "ok",
+            cost));
+    BOOST_CHECK_EQUAL(n["MSG_TYPE"].as<std::string>(),
+            "IMAGE_RETRIEVAL_FOR_ARCHIVING");
+    BOOST_CHECK_EQUAL(n["CPU_US"].as<uint64_t>(), 1);
+    BOOST_CHECK_EQUAL(n["PEAK_PIXEL_BYTES"].as<uint64_t>(), 2);
+    BOOST_CHECK_EQUAL(n["DAQ_BYTES"].as<uint64_t>(), 3);
+    BOOST_CHECK_EQUAL(n["WRITTEN_BYTES"].as<uint64_t>(), 4);
+    BOOST_CHECK_EQUAL(n["SENT_BYTES"].as<uint64_t>(), 5);
+
+    YAML::Node plain = YAML::Load(builder.build_image_retrieval_for_archiving(
+            0, "AT_O_20200101_000001", "00", "00", "/tmp/a.fits", "ok"));
+    BOOST_CHECK(!plain["CPU_US"]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <forwarder/Pipeline.h>
+
+struct PipelineFixture : IIPBase {
+
+    std::string _log_dir;
+
+    PipelineFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup PipelineTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~PipelineFixture() {
+        BOOST_TEST_MESSAGE("TearDown PipelineTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(PipelineTest, PipelineFixture);
+
+BOOST_AUTO_TEST_CASE(order) {
+    std::vector<int> done;
+    {
+        Stage stage("order", 4);
+        for (int i = 0; i < 10; i++) {
+            stage.push([&done, i]() { done.push_back(i); });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(done.size(), 10);
+    for (size_t i = 0; i < done.size(); i++) {
+        BOOST_CHECK_EQUAL(done[i], static_cast<int>(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(backpressure) {
+    std::atomic<bool> release(false);
+    Stage stage("backpressure", 1);
+
+    // first job occupies the worker, second fills the queue
+    stage.push([&release]() {
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    stage.push([]() {});
+
+    std::atomic<bool> pushed(false);
+    std::thread producer([&stage, &pushed]() {
+        stage.push([]() {});
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    BOOST_CHECK_EQUAL(pushed.load(), false);
+
+    release = true;
+    producer.join();
+    BOOST_CHECK_EQUAL(pushed.load(), true);
+}
+
+BOOST_AUTO_TEST_CASE(deadline) {
+    std::atomic<bool> release(false);
+    std::vector<std::string> done;
+    auto now = std::chrono::steady_clock::now();
+    {
+        Stage stage("deadline", 2);
+        stage.push([&release]() {
+            while (!release.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // catch-up jobs fill the stage, live jobs still get in ahead of them
+        stage.push([&done]() { done.push_back("catchup1"); });
+        stage.push([&done]() { done.push_back("catchup2"); });
+        stage.push([&done]() { done.push_back("science"); },
+                now + std::chrono::seconds(10));
+        stage.push([&done]() { done.push_back("guide"); },
+                now + std::chrono::seconds(1));
+        release = true;
+    }
+
+    std::vector<std::string> expected{ "guide", "science", "catchup1",
+        "catchup2" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(done.begin(), done.end(), expected.begin(),
+            expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(overlap) {
+    // fetch of the second image should start before the first image is done
+    // transferring
+    std::atomic<int> fetched(0);
+    std::atomic<int> fetched_during_transfer(-1);
+    {
+        Pipeline pipeline(2);
+        for (int i = 0; i < 2; i++) {
+            pipeline.fetch([&pipeline, &fetched, &fetched_during_transfer]() {
+                fetched++;
+                pipeline.transfer([&fetched, &fetched_during_transfer]() {
+                    std::this_thread::sleep_for(
+                            std::chrono::milliseconds(200));
+                    if (fetched_during_transfer.load() < 0) {
+                        fetched_during_transfer = fetched.load();
+                    }
+                });
+            });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(fetched.load(), 2);
+    BOOST_CHECK_EQUAL(fetched_during_transfer.load(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -187,4 +187,37 @@ BOOST_AUTO_TEST_CASE(get_xor) {
     BOOST_CHECK_EQUAL(ptr3.get_xor(science), 0x22222);
 }
 
+BOOST_AUTO_TEST_CASE(compiled) {
+    DAQ::Sensor::Type science = DAQ::Sensor::Type::SCIENCE;
+    DAQ::Sensor::Type guide = DAQ::Sensor::Type::GUIDE;
+
+    // invalid guide pattern only throws when guide is looked up
+    YAML::Node n = YAML::Load("{ \
+            DATA_SEGMENT_NAME: { \
+                science: [ 10, 11, 12, 13, 14, 15, 16, 17, \
+                           07, 06, 05, 04, 03, 02, 01, 00 ], \
+                guide: [ 10, 11, 12 ] }, \
+            DATA_SEGMENT: { \
+                science: [ 8, 9, 10, 11, 12, 13, 14, 15, \
+                           7, 6, 5, 4, 3, 2, 1, 0 ] }, \
+            DATA_SENSOR: { science: [ 2, 1, 0 ] }, \
+            XOR: { science: 0x1FFFF } }");
+    ReadoutPattern pt(n);
+
+    BOOST_CHECK_EQUAL(pt.data_segment_name(science).size(), 16);
+    BOOST_CHECK_EQUAL(pt.data_segment_name(science)[8], "07");
+    BOOST_CHECK_EQUAL(pt.data_segment(science)[0], 8);
+    BOOST_CHECK_EQUAL(pt.sensor_order(science).size(), 3);
+    BOOST_CHECK_EQUAL(pt.get_xor(science), 0x1FFFF);
+    BOOST_CHECK_THROW(pt.data_segment_name(guide), L1::InvalidReadoutPattern);
+    BOOST_CHECK_THROW(pt.get_xor(guide), L1::InvalidReadoutPattern);
+
+    // lookups return the compiled table, not a copy
+    BOOST_CHECK_EQUAL(&pt.data_segment(science), &pt.data_segment(science));
+
+    // compiled once, later changes to the node are not seen
+    n["XOR"]["science"] = 0x22222;
+    BOOST_CHECK_EQUAL(pt.get_xor(science), 0x1FFFF);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
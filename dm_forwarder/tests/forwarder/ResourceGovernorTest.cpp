@@ -0,0 +1,141 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <core/Metrics.h>
+#include <forwarder/ResourceGovernor.h>
+
+struct ResourceGovernorFixture : IIPBase {
+
+    std::string _log_dir;
+
+    ResourceGovernorFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ResourceGovernorTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+        Metrics::instance().clear();
+    }
+
+    ~ResourceGovernorFixture() {
+        BOOST_TEST_MESSAGE("TearDown ResourceGovernorTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+
+    static void wait_for(std::atomic<int>& value, const int expected) {
+        for (int i = 0; i < 500 && value.load() != expected; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ResourceGovernorTest, ResourceGovernorFixture);
+
+BOOST_AUTO_TEST_CASE(budgets) {
+    ResourceGovernor gov(100, 1000);
+    gov.admit("a", 60, 400, Info::MODE::LIVE);
+    BOOST_CHECK_EQUAL(gov.memory(), 60);
+    BOOST_CHECK_EQUAL(gov.spool(), 400);
+
+    // b does not fit in memory until a's pixel buffers are freed
+    std::atomic<int> admitted(0);
+    std::thread t([&gov, &admitted]() {
+        gov.admit("b", 60, 400, Info::MODE::LIVE);
+        admitted++;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK_EQUAL(admitted.load(), 0);
+
+    gov.release_memory("a");
+    wait_for(admitted, 1);
+    t.join();
+    BOOST_CHECK_EQUAL(gov.memory(), 60);
+    BOOST_CHECK_EQUAL(gov.spool(), 800);
+
+    // actual bytes written replace the estimate
+    gov.set_spool("a", 100);
+    BOOST_CHECK_EQUAL(gov.spool(), 500);
+    gov.release("a");
+    gov.release("b");
+    BOOST_CHECK_EQUAL(gov.memory(), 0);
+    BOOST_CHECK_EQUAL(gov.spool(), 0);
+
+    // larger than the budget is admitted alone
+    gov.admit("c", 500, 5000, Info::MODE::LIVE);
+    BOOST_CHECK_EQUAL(gov.memory(), 500);
+    BOOST_CHECK_EQUAL(
+            Metrics::instance().gauge("governor_bytes", "spool").value(), 5000);
+    gov.release("c");
+
+    BOOST_CHECK_EQUAL(Metrics::instance().latency("admission").count(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(priority) {
+    ResourceGovernor gov(100, 0);
+    gov.admit("a", 100, 0, Info::MODE::LIVE);
+
+    std::vector<std::string> order;
+    std::mutex m;
+    std::atomic<int> done(0);
+    auto waiter = [&](const std::string& id, const Info::MODE mode) {
+        return std::thread([&, id, mode]() {
+            gov.admit(id, 100, 0, mode);
+            {
+                std::lock_guard<std::mutex> lk(m);
+                order.push_back(id);
+            }
+            done++;
+            gov.release(id);
+        });
+    };
+
+    // catch-up arrives first but live is admitted before it
+    std::thread c = waiter("catchup", Info::MODE::CATCHUP);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread l = waiter("live", Info::MODE::LIVE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    gov.release("a");
+    wait_for(done, 2);
+    c.join();
+    l.join();
+    BOOST_REQUIRE_EQUAL(order.size(), 2);
+    BOOST_CHECK_EQUAL(order[0], "live");
+    BOOST_CHECK_EQUAL(order[1], "catchup");
+}
+
+BOOST_AUTO_TEST_CASE(expire) {
+    ResourceGovernor gov(100, 100);
+    gov.admit("a", 100, 100, Info::MODE::LIVE);
+    gov.expire(std::chrono::seconds(60));
+    BOOST_CHECK_EQUAL(gov.memory(), 100);
+    gov.expire(std::chrono::seconds(0));
+    BOOST_CHECK_EQUAL(gov.memory(), 0);
+    BOOST_CHECK_EQUAL(gov.spool(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <forwarder/Scoreboard.h>
+
+struct ScoreboardFixture : IIPBase {
+
+    std::string _log_dir;
+
+    ScoreboardFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup ScoreboardTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~ScoreboardFixture() {
+        BOOST_TEST_MESSAGE("TearDown ScoreboardTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ScoreboardTest, ScoreboardFixture);
+
+BOOST_AUTO_TEST_CASE(ready) {
+    Scoreboard db(60);
+    const std::string image_id = "AT_O_20190101_000001";
+
+    xfer_info xfer;
+    xfer.target = "ARC@127.0.0.1:/tmp/data";
+    xfer.session_id = "session_1";
+    xfer.job_num = "job_1";
+    xfer.locations = { "00/0" };
+    xfer.mode = Info::MODE::CATCHUP;
+    db.add_xfer(image_id, xfer);
+    BOOST_CHECK(!db.ready(image_id));
+    BOOST_CHECK(db.get(image_id).deadline ==
+            std::chrono::steady_clock::time_point::max());
+
+    db.add_ccd(image_id, "/tmp/" + image_id + "-R00S00.fits");
+    BOOST_CHECK(!db.ready(image_id));
+
+    db.add_header(image_id, "/tmp/header/" + image_id);
+    BOOST_CHECK(!db.ready(image_id));
+
+    db.set_fetched(image_id);
+    BOOST_CHECK(db.ready(image_id));
+
+    xfer_info got = db.get_xfer(image_id);
+    BOOST_CHECK_EQUAL(got.target, xfer.target);
+    BOOST_CHECK_EQUAL(got.session_id, xfer.session_id);
+    BOOST_CHECK_EQUAL(got.job_num, xfer.job_num);
+    BOOST_CHECK(got.mode == Info::MODE::CATCHUP);
+    BOOST_CHECK_EQUAL(db.locations(image_id).size(), 1);
+    BOOST_CHECK_EQUAL(db.header(image_id), "/tmp/header/" + image_id);
+
+    // redelivered XFER_PARAMS replace the locations
+    db.add_xfer(image_id, xfer);
+    BOOST_CHECK_EQUAL(db.locations(image_id).size(), 1);
+
+    auto deadline = std::chrono::steady_clock::now();
+    db.set_deadline(image_id, deadline);
+    BOOST_CHECK(db.get(image_id).deadline == deadline);
+
+    db.remove(image_id);
+    BOOST_CHECK(!db.ready(image_id));
+    BOOST_CHECK(db.ccds(image_id).empty());
+    BOOST_CHECK(db.locations(image_id).empty());
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_ccds) {
+    Scoreboard db(60);
+    const std::string image_id = "AT_O_20190101_000001";
+
+    std::vector<std::thread> fetchers;
+    for (int i = 0; i < 8; i++) {
+        fetchers.push_back(std::thread([&db, &image_id, i]() {
+            for (int j = 0; j < 100; j++) {
+                db.add_ccd(image_id, std::to_string(i) + "/" +
+                        std::to_string(j));
+            }
+        }));
+    }
+    for (auto&& t : fetchers) {
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(db.ccds(image_id).size(), 800);
+}
+
+BOOST_AUTO_TEST_CASE(partial_fetch) {
+    Scoreboard db(60);
+    const std::string image_id = "AT_O_20190101_000001";
+
+    // HEADER_READY on the consumer thread lands between the locations
+    // written by the fetch thread
+    std::thread fetch([&db, &image_id]() {
+        for (int i = 0; i < 9; i++) {
+            db.add_ccd(image_id, "/tmp/" + std::to_string(i) + ".fits");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    db.add_header(image_id, "/tmp/header/" + image_id);
+    while (db.ccds(image_id).size() < 9) {
+        BOOST_CHECK(!db.ready(image_id));
+    }
+    fetch.join();
+    BOOST_CHECK(!db.ready(image_id));
+
+    db.set_fetched(image_id);
+    BOOST_CHECK(db.ready(image_id));
+    BOOST_CHECK_EQUAL(db.ccds(image_id).size(), 9);
+}
+
+BOOST_AUTO_TEST_CASE(ttl) {
+    Scoreboard db(0);
+    const std::string image_id = "AT_O_20190101_000001";
+    db.add_header(image_id, "/tmp/header/" + image_id);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // new images sweep expired ones out of their stripe
+    for (int i = 0; i < 1000; i++) {
+        db.add_header(std::to_string(i), "/tmp/header/" + std::to_string(i));
+    }
+    BOOST_CHECK(db.header(image_id).empty());
+}
+
+BOOST_AUTO_TEST_CASE(restore) {
+    redis_connection_params params;
+    params.host = _config_root["REDIS"]["LOCAL"]["HOST"].as<std::string>();
+    params.port = _config_root["REDIS"]["LOCAL"]["PORT"].as<int>();
+    params.db = _config_root["REDIS"]["LOCAL"]["DB"].as<int>();
+    const std::string image_id = "AT_O_20190101_000002";
+
+    {
+        Scoreboard db(params, 60);
+        xfer_info xfer;
+        xfer.target = "ARC@127.0.0.1:/tmp/data";
+        xfer.locations = { "00/0", "00/1" };
+        xfer.mode = Info::MODE::CATCHUP;
+        db.add_xfer(image_id, xfer);
+        db.add_ccd(image_id, "/tmp/" + image_id + "-R00S00.fits");
+        db.set_fetched(image_id);
+        db.flush();
+    }
+
+    Scoreboard db(params, 60);
+    readout_info info = db.get(image_id);
+    BOOST_CHECK_EQUAL(info.xfer.target, "ARC@127.0.0.1:/tmp/data");
+    BOOST_CHECK_EQUAL(info.xfer.locations.size(), 2);
+    BOOST_CHECK(info.xfer.mode == Info::MODE::CATCHUP);
+    BOOST_CHECK_EQUAL(info.ccds.size(), 1);
+    BOOST_CHECK(info.fetched);
+
+    db.remove(image_id);
+    db.flush();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+/*
+ * This file is part of dm_forwarder
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <core/IIPBase.h>
+#include <forwarder/Supervisor.h>
+
+struct SupervisorFixture : IIPBase {
+
+    std::string _log_dir;
+
+    SupervisorFixture() : IIPBase("ForwarderCfg.yaml", "test") {
+        BOOST_TEST_MESSAGE("Setup SupervisorTest fixture");
+        _log_dir = _config_root["LOGGING_DIR"].as<std::string>();
+    }
+
+    ~SupervisorFixture() {
+        BOOST_TEST_MESSAGE("TearDown SupervisorTest fixture");
+        std::string log = _log_dir + "/test.log.0";
+        std::remove(log.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SupervisorTest, SupervisorFixture);
+
+BOOST_AUTO_TEST_CASE(parse_cpus) {
+    std::vector<int> expected{ 0, 1, 2, 3, 8, 10, 11 };
+    std::vector<int> cpus = Supervisor::parse_cpus("0-3,8,10-11");
+    BOOST_CHECK_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(),
+            expected.begin(), expected.end());
+
+    // sysfs cpulist ends with a newline
+    BOOST_CHECK_EQUAL(Supervisor::parse_cpus("4-5\n").size(), 2);
+
+    BOOST_CHECK(Supervisor::parse_cpus("").empty());
+    BOOST_CHECK(Supervisor::parse_cpus("a").empty());
+    BOOST_CHECK(Supervisor::parse_cpus("3-1").empty());
+    BOOST_CHECK(Supervisor::parse_cpus("1:2").empty());
+    BOOST_CHECK(Supervisor::parse_cpus("0-3,").size() == 4);
+    BOOST_CHECK(Supervisor::parse_cpus("-1").empty());
+}
+
+BOOST_AUTO_TEST_CASE(share) {
+    const std::vector<std::string> locations{ "22/2", "22/0", "00/0" };
+    const std::vector<std::string> group{ "22/0", "22/1", "22/2" };
+
+    std::vector<std::string> expected{ "22/2", "22/0" };
+    std::vector<std::string> ours = Supervisor::share(locations, group);
+    BOOST_CHECK_EQUAL_COLLECTIONS(ours.begin(), ours.end(),
+            expected.begin(), expected.end());
+
+    BOOST_CHECK(Supervisor::share(locations, { "44/0" }).empty());
+    BOOST_CHECK(Supervisor::share({}, group).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
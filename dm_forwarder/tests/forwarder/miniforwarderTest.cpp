@@ -136,7 +136,7 @@ BOOST_AUTO_TEST_CASE(set_name) {
     result2 += buffer2.data();
 
     std::string name = result + ":" + result2;
-    BOOST_CHECK_EQUAL(name, _fwd->get_name());
+    BOOST_CHECK_EQUAL(name, ForwarderNode(_config_root).name());
 }
 
 BOOST_AUTO_TEST_CASE(run) {